@@ -11,7 +11,6 @@ var show_rect: bool = true
 var main_color: Color = Color.GREEN_YELLOW
 var secondary_color: Color = Color.RED
 var grid_color: Color = Color.WHITE
-var border_color: Color = Color.BLUE
 
 
 func _init() -> void:
@@ -32,7 +31,7 @@ func _redraw() -> void:
 
 	if show_rect:
 		var modulate: Color = main_color if !use_secondary_color else secondary_color
-		if abs(region_position.x) > 8 or abs(region_position.y) > 8:
+		if abs(region_position.x) > Terrain3DStorage.REGION_OFFSET_MAX or abs(region_position.y) > Terrain3DStorage.REGION_OFFSET_MAX:
 			modulate = Color.GRAY
 		draw_rect(Vector2(region_size,region_size)*.5 + rect_position, region_size, selection_material, modulate)
 	
@@ -43,8 +42,6 @@ func _redraw() -> void:
 			continue
 			
 		draw_rect(Vector2(region_size,region_size)*.5 + grid_tile_position, region_size, material, grid_color)
-		
-	draw_rect(Vector2.ZERO, region_size * 16.0, material, border_color)
 
 
 func draw_rect(p_pos: Vector2, p_size: float, p_material: StandardMaterial3D, p_modulate: Color) -> void:
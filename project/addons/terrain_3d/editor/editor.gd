@@ -9,6 +9,7 @@ const RegionGizmo: Script = preload("res://addons/terrain_3d/editor/components/r
 const ASSET_DOCK: String = "res://addons/terrain_3d/editor/components/asset_dock.tscn"
 const PS_DOCK_POSITION: String = "terrain3d/config/dock_position"
 const PS_DOCK_PINNED: String = "terrain3d/config/dock_pinned"
+const PS_UNDO_MEMORY_BUDGET: String = "terrain3d/config/undo_memory_budget_mb"
 
 var terrain: Terrain3D
 var nav_region: NavigationRegion3D
@@ -37,6 +38,8 @@ var _prev_enable_state: int = -1
 
 func _enter_tree() -> void:
 	editor = Terrain3DEditor.new()
+	if ProjectSettings.has_setting(PS_UNDO_MEMORY_BUDGET):
+		editor.set_undo_memory_budget(ProjectSettings.get_setting(PS_UNDO_MEMORY_BUDGET))
 	ui = UI.new()
 	ui.plugin = self
 	add_child(ui)
@@ -0,0 +1,256 @@
+@tool
+extends EditorScript
+## Micro benchmarks for Terrain3D CPU queries.
+## Open a scene with a Terrain3D node that has regions, then run with File > Run (Ctrl+Shift+X).
+## Results are printed to the Output panel. The benchmarks only read the terrain. The concurrency
+## stress test modifies its data, so it runs on its own storage in stress_test.gd.
+
+
+const QUERIES: int = 100000
+
+
+func _run() -> void:
+	var terrain: Terrain3D = _find_terrain(get_editor_interface().get_edited_scene_root())
+	if not terrain or not terrain.storage or terrain.storage.get_region_count() == 0:
+		push_error("Benchmark requires an open scene with a Terrain3D that has at least one region")
+		return
+	var storage: Terrain3DStorage = terrain.storage
+	var points: PackedVector3Array = _random_points(storage, terrain.mesh_vertex_spacing, QUERIES)
+	print("Terrain3D benchmark: %d regions, %d queries" % [ storage.get_region_count(), QUERIES ])
+	bench_queries(storage, points, terrain.mesh_vertex_spacing)
+	bench_batch_queries(storage, points)
+	bench_raycasts(storage, points)
+	bench_compression(storage)
+	bench_control_decode(storage, terrain.mesh_vertex_spacing)
+	bench_import()
+	bench_min_max(storage)
+	bench_snapshot(storage)
+
+
+## Compares the native queries against the Image.get_pixel() path they replaced
+func bench_queries(p_storage: Terrain3DStorage, p_points: PackedVector3Array, p_spacing: float) -> void:
+	var start: int = Time.get_ticks_usec()
+	for p in p_points:
+		p_storage.get_height(p)
+	_report("get_height()", start, p_points.size())
+
+	start = Time.get_ticks_usec()
+	for p in p_points:
+		_get_height_via_image(p_storage, p, p_spacing)
+	_report("get_height() via Image.get_pixel", start, p_points.size())
+
+	start = Time.get_ticks_usec()
+	for p in p_points:
+		p_storage.get_control(p)
+	_report("get_control()", start, p_points.size())
+
+	start = Time.get_ticks_usec()
+	for p in p_points:
+		p_storage.get_normal(p)
+	_report("get_normal()", start, p_points.size())
+
+	start = Time.get_ticks_usec()
+	for p in p_points:
+		p_storage.get_texture_id(p)
+	_report("get_texture_id()", start, p_points.size())
+
+	start = Time.get_ticks_usec()
+	for p in p_points:
+		p_storage.get_mesh_vertex(0, Terrain3DStorage.HEIGHT_FILTER_NEAREST, p)
+	_report("get_mesh_vertex()", start, p_points.size())
+
+
+## Compares the batched, threaded queries against the same number of single calls
+func bench_batch_queries(p_storage: Terrain3DStorage, p_points: PackedVector3Array) -> void:
+	var start: int = Time.get_ticks_usec()
+	p_storage.get_heights(p_points)
+	_report("get_heights()", start, p_points.size())
+
+	start = Time.get_ticks_usec()
+	p_storage.get_normals(p_points)
+	_report("get_normals()", start, p_points.size())
+
+	start = Time.get_ticks_usec()
+	p_storage.get_controls(p_points)
+	_report("get_controls()", start, p_points.size())
+
+
+## Casts slanted rays down from 500m above random points
+func bench_raycasts(p_storage: Terrain3DStorage, p_points: PackedVector3Array) -> void:
+	var from := PackedVector3Array()
+	var dirs := PackedVector3Array()
+	from.resize(p_points.size())
+	dirs.resize(p_points.size())
+	for i in p_points.size():
+		from[i] = p_points[i] + Vector3(0, 500, 0)
+		dirs[i] = Vector3(randf_range(-1, 1), -1, randf_range(-1, 1)).normalized()
+
+	var start: int = Time.get_ticks_usec()
+	for i in from.size():
+		p_storage.raycast(from[i], dirs[i])
+	_report("raycast()", start, from.size())
+
+	start = Time.get_ticks_usec()
+	p_storage.raycasts(from, dirs)
+	_report("raycasts()", start, from.size())
+
+
+## Compares the parallel region codec used by save_compressed against the regular compressed save
+func bench_compression(p_storage: Terrain3DStorage) -> void:
+	var raw_size: int = 0
+	for type in Terrain3DStorage.TYPE_MAX:
+		for map in p_storage.get_maps(type):
+			raw_size += map.get_data().size()
+
+	var path: String = "user://terrain3d_benchmark.res"
+	var start: int = Time.get_ticks_usec()
+	ResourceSaver.save(p_storage, path, ResourceSaver.FLAG_COMPRESS)
+	var elapsed: int = Time.get_ticks_usec() - start
+	var file_size: int = FileAccess.get_file_as_bytes(path).size()
+	DirAccess.remove_absolute(path)
+	_report_compression("ResourceSaver FLAG_COMPRESS", elapsed, raw_size, file_size)
+
+	start = Time.get_ticks_usec()
+	var regions: Array = p_storage.compress_regions()
+	elapsed = Time.get_ticks_usec() - start
+	var packed_size: int = 0
+	for data in regions:
+		packed_size += data.size()
+	_report_compression("compress_regions()", elapsed, raw_size, packed_size)
+
+
+## Compares decoding a region of control texels in bulk against per texel queries and helpers
+func bench_control_decode(p_storage: Terrain3DStorage, p_spacing: float) -> void:
+	var size: int = p_storage.get_region_size()
+	var offset: Vector2i = p_storage.get_region_offsets()[0]
+	var origin := Vector3(offset.x, 0, offset.y) * size * p_spacing
+	var count: int = size * size
+
+	var start: int = Time.get_ticks_usec()
+	var lanes: Dictionary = p_storage.decode_control_rect(origin, Vector2i(size, size))
+	_report("decode_control_rect()", start, count)
+
+	start = Time.get_ticks_usec()
+	for z in size:
+		for x in size:
+			var control: int = p_storage.get_control(origin + Vector3(x, 0, z) * p_spacing)
+			Terrain3DUtil.get_base(control)
+			Terrain3DUtil.get_overlay(control)
+			Terrain3DUtil.get_blend(control)
+			Terrain3DUtil.is_hole(control)
+			Terrain3DUtil.is_nav(control)
+			Terrain3DUtil.is_auto(control)
+	_report("get_control() + Terrain3DUtil getters", start, count)
+
+	# Encoding writes, so the lanes are written to a blank region in a new storage
+	var scratch := Terrain3DStorage.new()
+	scratch.set_region_size(size)
+	scratch.add_region(Vector3.ZERO)
+	start = Time.get_ticks_usec()
+	scratch.encode_control_rect(Vector3.ZERO, lanes)
+	_report("encode_control_rect() into a new storage", start, count)
+
+
+## Imports a synthetic heightmap into a new storage, so the open scene isn't modified
+func bench_import() -> void:
+	var size: int = 4096
+	var height := Image.create(size, size, false, Image.FORMAT_RF)
+	height.fill(Color(0.5, 0, 0, 1))
+	var images: Array[Image] = [ height, null, null ]
+	var storage := Terrain3DStorage.new()
+	var start: int = Time.get_ticks_usec()
+	storage.import_images(images, Vector3(-size / 2, 0, -size / 2), 0.0, 100.0)
+	var elapsed: int = Time.get_ticks_usec() - start
+	print("  %-40s %8.1f ms, %8.1f megapixels/s, %d regions" % [ "import_images() %dx%d" % [ size, size ],
+		elapsed / 1000.0, size * size / maxf(elapsed, 1.0), storage.get_region_count() ])
+
+
+## Compares the native min/max and stats of the first height map against a get_pixel() loop
+func bench_min_max(p_storage: Terrain3DStorage) -> void:
+	var map: Image = p_storage.get_map_region(Terrain3DStorage.TYPE_HEIGHT, 0)
+	var count: int = map.get_width() * map.get_height()
+
+	var start: int = Time.get_ticks_usec()
+	Terrain3DUtil.get_min_max(map)
+	_report("Terrain3DUtil.get_min_max()", start, count)
+
+	start = Time.get_ticks_usec()
+	Terrain3DUtil.get_stats(map)
+	_report("Terrain3DUtil.get_stats()", start, count)
+
+	start = Time.get_ticks_usec()
+	var min_max := Vector2(0, 0)
+	for y in map.get_height():
+		for x in map.get_width():
+			var height: float = map.get_pixel(x, y).r
+			min_max = Vector2(minf(min_max.x, height), maxf(min_max.y, height))
+	_report("min/max via Image.get_pixel", start, count)
+
+
+## Compares taking a snapshot against copying the maps
+func bench_snapshot(p_storage: Terrain3DStorage) -> void:
+	var start: int = Time.get_ticks_usec()
+	for type in Terrain3DStorage.TYPE_MAX:
+		p_storage.get_maps_copy(type)
+	var elapsed: int = Time.get_ticks_usec() - start
+	print("  %-40s %8.1f ms" % [ "get_maps_copy() of all map types", elapsed / 1000.0 ])
+
+	start = Time.get_ticks_usec()
+	p_storage.create_snapshot()
+	elapsed = Time.get_ticks_usec() - start
+	print("  %-40s %8.1f ms" % [ "create_snapshot()", elapsed / 1000.0 ])
+
+
+func _report_compression(p_name: String, p_usec: int, p_raw_size: int, p_packed_size: int) -> void:
+	var mb: float = p_raw_size / 1048576.0
+	print("  %-40s %8.1f ms, %8.1f MB/s, ratio %5.2f:1 (%.1f MB to %.1f MB)" % [ p_name, p_usec / 1000.0,
+		mb / maxf(p_usec / 1000000.0, 0.000001), float(p_raw_size) / maxi(p_packed_size, 1), mb, p_packed_size / 1048576.0 ])
+
+
+## Reference implementation of the previous lookup: region index, map fetch and
+## Image.get_pixel() for the hole check and each of the 4 bilinear taps.
+func _get_height_via_image(p_storage: Terrain3DStorage, p_pos: Vector3, p_spacing: float) -> float:
+	var size: int = p_storage.get_region_size()
+	var pos := Vector2(p_pos.x, p_pos.z) / p_spacing
+	var taps: Array[Vector2] = [ pos, pos.floor(), pos.floor() + Vector2(0, 1),
+		pos.floor() + Vector2(1, 0), pos.floor() + Vector2(1, 1) ]
+	var values: Array[float] = []
+	for i in taps.size():
+		var index: int = p_storage.get_region_index(Vector3(taps[i].x, 0, taps[i].y) * p_spacing)
+		if index < 0:
+			return NAN
+		var type: int = Terrain3DStorage.TYPE_CONTROL if i == 0 else Terrain3DStorage.TYPE_HEIGHT
+		var map: Image = p_storage.get_map_region(type, index)
+		var offset: Vector2i = p_storage.get_region_offsets()[index] * size
+		var px: Vector2i = (Vector2i(taps[i].floor()) - offset).clamp(Vector2i.ZERO, Vector2i(size - 1, size - 1))
+		values.append(map.get_pixelv(px).r)
+	var f: Vector2 = pos - pos.floor()
+	return lerpf(lerpf(values[1], values[3], f.x), lerpf(values[2], values[4], f.x), f.y)
+
+
+func _random_points(p_storage: Terrain3DStorage, p_spacing: float, p_count: int) -> PackedVector3Array:
+	var offsets: Array = p_storage.get_region_offsets()
+	var size: float = p_storage.get_region_size() * p_spacing
+	var points := PackedVector3Array()
+	points.resize(p_count)
+	for i in p_count:
+		var offset: Vector2i = offsets[randi() % offsets.size()]
+		points[i] = Vector3((offset.x + randf()) * size, 0, (offset.y + randf()) * size)
+	return points
+
+
+func _report(p_name: String, p_start_usec: int, p_count: int) -> void:
+	var elapsed: int = Time.get_ticks_usec() - p_start_usec
+	print("  %-40s %8.1f ms, %8.1f ns/query" % [ p_name, elapsed / 1000.0, elapsed * 1000.0 / p_count ])
+
+
+func _find_terrain(p_node: Node) -> Terrain3D:
+	if not p_node:
+		return null
+	if p_node is Terrain3D:
+		return p_node
+	for child in p_node.get_children():
+		var terrain: Terrain3D = _find_terrain(child)
+		if terrain:
+			return terrain
+	return null
@@ -49,6 +49,14 @@ func start_import(p_value: bool) -> void:
 		if not storage:
 			storage = Terrain3DStorage.new()
 
+		# Stream r16 heightmaps from disk, rather than loading the whole file
+		var ext: String = height_file_name.get_extension().to_lower()
+		if (ext == "r16" or ext == "raw") and not control_file_name and not color_file_name:
+			var height_range := r16_range * import_scale + Vector2(import_offset, import_offset)
+			var err: int = storage.import_r16(height_file_name, import_position, height_range, r16_size)
+			print("Terrain3DImporter: Import finished, error status: ", err, " ", error_string(err))
+			return
+
 		var imported_images: Array[Image]
 		imported_images.resize(Terrain3DStorage.TYPE_MAX)
 		var min_max := Vector2(0, 1)
@@ -80,3 +88,24 @@ func start_export(p_value: bool) -> void:
 	var err: int = storage.export_image(file_name_out, map_type)
 	print("Terrain3DImporter: Export error status: ", err, " ", error_string(err))
 	
+
+
+@export_group("Export Regions")
+## Directory for region files or a region container, used as Terrain3DStorage.streaming_directory
+@export_dir var regions_directory: String = ""
+@export var container_name: String = "regions.t3dc"
+@export var run_save_region_files: bool = false : set = start_save_region_files
+@export var run_save_container: bool = false : set = start_save_container
+
+func start_save_region_files(p_value: bool) -> void:
+	if p_value and storage:
+		var err: int = storage.save_region_files(regions_directory)
+		print("Terrain3DImporter: Save region files error status: ", err, " ", error_string(err))
+
+
+func start_save_container(p_value: bool) -> void:
+	if p_value and storage:
+		var start: int = Time.get_ticks_msec()
+		var err: int = storage.save_region_container(regions_directory.path_join(container_name))
+		print("Terrain3DImporter: Save region container error status: ", err, " ", error_string(err),
+			", ", Time.get_ticks_msec() - start, " ms")
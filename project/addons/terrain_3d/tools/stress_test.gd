@@ -0,0 +1,132 @@
+extends SceneTree
+## Stress test of the Terrain3DStorage concurrency model. It builds its own storage in memory, so no
+## scene or data is touched. Run headless from the project directory:
+##   godot --headless --script res://addons/terrain_3d/tools/stress_test.gd
+## Exits with code 1 if any check fails.
+
+
+const REGION_SIZE: int = 256
+const REGIONS: int = 2 # Per axis
+const QUERIES: int = 100000
+const SEED: int = 3
+
+
+func _initialize() -> void:
+	var storage: Terrain3DStorage = _create_storage()
+	var points: PackedVector3Array = _query_points(QUERIES)
+	print("Terrain3D stress test: %d regions, %d queries" % [ storage.get_region_count(), QUERIES ])
+	var passed: bool = test_pattern(storage, points)
+	passed = test_concurrent_queries(storage, points) and passed
+	passed = test_snapshot(storage) and passed
+	print("Terrain3D stress test %s" % [ "passed" if passed else "FAILED" ])
+	quit(0 if passed else 1)
+
+
+## Checks single threaded queries against the pattern before any threads are involved
+func test_pattern(p_storage: Terrain3DStorage, p_points: PackedVector3Array) -> bool:
+	var failed: int = 0
+	for p in p_points:
+		if not _is_expected(p_storage, p):
+			failed += 1
+	return _report("pattern", failed)
+
+
+## Worker threads query heights and normals and check them against the pattern, while the main
+## thread rewrites heights with their own values and adds and removes a spare region, both
+## immediately and deferred. Readers must never see a torn or missing value.
+func test_concurrent_queries(p_storage: Terrain3DStorage, p_points: PackedVector3Array) -> bool:
+	# Leave threads free for the storage's own tasks, eg. color mipmaps when regions change
+	var tasks: int = maxi(1, OS.get_processor_count() / 2)
+	var per_task: int = p_points.size() / tasks
+	var failures: Array = []
+	failures.resize(tasks)
+	failures.fill(0)
+	var reader := func(p_task: int) -> void:
+		var failed: int = 0
+		for i in range(p_task * per_task, (p_task + 1) * per_task):
+			if not _is_expected(p_storage, p_points[i]):
+				failed += 1
+		failures[p_task] = failed
+
+	var spare := Vector3((REGIONS + 1.5) * REGION_SIZE, 0, 0.5 * REGION_SIZE)
+	var start: int = Time.get_ticks_usec()
+	var group: int = WorkerThreadPool.add_group_task(reader, tasks)
+	var edits: int = 0
+	var region_changes: int = 0
+	while not WorkerThreadPool.is_group_task_completed(group):
+		var p: Vector3 = p_points[edits % p_points.size()].floor()
+		p_storage.set_height(p, _get_pattern(p))
+		edits += 1
+		if edits % 256 == 0:
+			var update: bool = region_changes % 2 == 0
+			p_storage.add_region(spare, [], update)
+			p_storage.remove_region(spare, update)
+			if not update:
+				p_storage.force_update_maps()
+			region_changes += 1
+	WorkerThreadPool.wait_for_group_task_completion(group)
+	var elapsed: int = Time.get_ticks_usec() - start
+
+	var failed: int = 0
+	for count in failures:
+		failed += count
+	var queries: int = per_task * tasks * 2
+	print("  %-40s %8.1f ms, %8.1f ns/query, %d threads, %d edits, %d region changes" % [
+		"concurrent queries", elapsed / 1000.0, elapsed * 1000.0 / maxi(queries, 1), tasks, edits, region_changes ])
+	return _report("concurrent queries", failed)
+
+
+## Checks an edit after taking a snapshot doesn't show in it
+func test_snapshot(p_storage: Terrain3DStorage) -> bool:
+	var p := Vector3(REGION_SIZE / 2, 0, REGION_SIZE / 2)
+	var snapshot: Terrain3DSnapshot = p_storage.create_snapshot()
+	p_storage.set_height(p, _get_pattern(p) + 1.0)
+	var failed: int = 0
+	if snapshot.get_pixel(Terrain3DStorage.TYPE_HEIGHT, p).r != _get_pattern(p):
+		failed += 1
+	if snapshot.get_version() == p_storage.get_data_version():
+		failed += 1
+	p_storage.set_height(p, _get_pattern(p))
+	return _report("snapshot isolation", failed)
+
+
+## Imports a sloped plane covering REGIONS x REGIONS regions from the origin
+func _create_storage() -> Terrain3DStorage:
+	var size: int = REGION_SIZE * REGIONS
+	var height := Image.create(size, size, false, Image.FORMAT_RF)
+	for z in size:
+		for x in size:
+			height.set_pixel(x, z, Color(_get_pattern(Vector3(x, 0, z)), 0, 0, 1))
+	var storage := Terrain3DStorage.new()
+	storage.set_region_size(REGION_SIZE)
+	storage.import_images([ height, null, null ], Vector3.ZERO, 0.0, 1.0)
+	return storage
+
+
+## Heights are exact in half floats, so the test also holds for 16-bit storage.
+## Bilinear interpolation of a plane is the plane, and its normal is constant.
+func _get_pattern(p_pos: Vector3) -> float:
+	return p_pos.x * 0.25 + p_pos.z * 0.5
+
+
+func _is_expected(p_storage: Terrain3DStorage, p_pos: Vector3) -> bool:
+	if not is_equal_approx(p_storage.get_height(p_pos), _get_pattern(p_pos)):
+		return false
+	return p_storage.get_normal(p_pos).is_equal_approx(Vector3(-0.25, 1, -0.5).normalized())
+
+
+## Random points, repeatable with SEED, kept a pixel inside the edges, as normals read a neighbor
+func _query_points(p_count: int) -> PackedVector3Array:
+	var rng := RandomNumberGenerator.new()
+	rng.seed = SEED
+	var size: float = REGION_SIZE * REGIONS
+	var points := PackedVector3Array()
+	points.resize(p_count)
+	for i in p_count:
+		points[i] = Vector3(rng.randf_range(1, size - 2), 0, rng.randf_range(1, size - 2))
+	return points
+
+
+func _report(p_name: String, p_failed: int) -> bool:
+	print("  %-40s %s" % [ p_name, "passed" if p_failed == 0 else "FAILED: %d" % p_failed ])
+	return p_failed == 0
@@ -19,6 +19,8 @@ RID GeneratedTexture::create(const TypedArray<Image> &p_layers) {
 			}
 		}
 		_rid = RS->texture_2d_layered_create(p_layers, RenderingServer::TEXTURE_LAYERED_2D_ARRAY);
+		_layer_count = p_layers.size();
+		_dirty_layers.clear();
 		_dirty = false;
 	} else {
 		clear();
@@ -44,5 +46,38 @@ void GeneratedTexture::clear() {
 		_image.unref();
 	}
 	_rid = RID();
+	_layer_count = 0;
+	_dirty_layers.clear();
 	_dirty = true;
+}
+
+// Queues a single layer for upload on the next update()
+void GeneratedTexture::set_layer_dirty(int p_layer) {
+	if (p_layer < 0 || p_layer >= _layer_count) {
+		_dirty = true;
+		return;
+	}
+	if (!_dirty_layers.has(p_layer)) {
+		_dirty_layers.push_back(p_layer);
+	}
+}
+
+/**
+ * Uploads only the dirty layers to the existing texture array, keeping the RID.
+ * The array is recreated only if it was cleared or the number of layers changed.
+ * Returns true if the array was recreated, meaning the RID changed.
+ */
+bool GeneratedTexture::update(const TypedArray<Image> &p_layers) {
+	if (needs_rebuild(p_layers.size())) {
+		clear();
+		create(p_layers);
+		return true;
+	}
+	for (int i = 0; i < _dirty_layers.size(); i++) {
+		int layer = _dirty_layers[i];
+		LOG(DEBUG_CONT, "RenderingServer updating Texture2DArray ", _rid, " layer: ", layer);
+		RS->texture_2d_update(_rid, p_layers[layer], layer);
+	}
+	_dirty_layers.clear();
+	return false;
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #define GENERATEDTEXTURE_CLASS_H
 
 #include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/templates/vector.hpp>
 
 #include "constants.h"
 
@@ -16,12 +17,19 @@ private:
 	RID _rid = RID();
 	Ref<Image> _image;
 	bool _dirty = false;
+	int _layer_count = 0;
+	Vector<int> _dirty_layers; // Layers to upload individually on update()
 
 public:
 	void clear();
 	bool is_dirty() { return _dirty; }
+	bool needs_update() const { return _dirty || !_dirty_layers.is_empty(); }
+	bool needs_rebuild(int p_layer_count) const { return _dirty || !_rid.is_valid() || p_layer_count != _layer_count; }
+	void set_layer_dirty(int p_layer);
+	Vector<int> get_dirty_layers() const { return _dirty_layers; }
 	RID create(const TypedArray<Image> &p_layers);
 	RID create(const Ref<Image> &p_image);
+	bool update(const TypedArray<Image> &p_layers);
 	Ref<Image> get_image() const { return _image; }
 	RID get_rid() { return _rid; }
 };
@@ -0,0 +1,181 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#include "height_pyramid.h"
+#include "logger.h"
+
+///////////////////////////
+// Private Functions
+///////////////////////////
+
+// Recalculates the level 0 nodes in p_leaves from the heights
+void HeightPyramid::_update_leaves(const Heights &p_heights, Rect2i p_leaves) {
+	Node *nodes = _nodes.ptrw();
+	int last = _size - 1;
+	for (int ly = p_leaves.position.y; ly < p_leaves.get_end().y; ly++) {
+		for (int lx = p_leaves.position.x; lx < p_leaves.get_end().x; lx++) {
+			Node node;
+			int x0 = lx * LEAF_SIZE;
+			int y0 = ly * LEAF_SIZE;
+			int x1 = MIN(x0 + LEAF_SIZE, last);
+			int y1 = MIN(y0 + LEAF_SIZE, last);
+			for (int y = y0; y <= y1; y++) {
+				int row = y * _size;
+				for (int x = x0; x <= x1; x++) {
+					float h = p_heights.get(row + x);
+					// Comparisons are false for NAN, so NAN is skipped
+					if (h < node.min) {
+						node.min = h;
+					}
+					if (h > node.max) {
+						node.max = h;
+					}
+				}
+			}
+			nodes[ly * _level_size[0] + lx] = node;
+		}
+	}
+}
+
+// Propagates changed level 0 nodes up through the parent levels
+void HeightPyramid::_update_parents(Rect2i p_leaves) {
+	Node *nodes = _nodes.ptrw();
+	Vector2i from = p_leaves.position;
+	Vector2i to = p_leaves.get_end() - Vector2i(1, 1);
+	for (int level = 1; level < _level_count; level++) {
+		from /= 2;
+		to /= 2;
+		const Node *child = nodes + _level_offset[level - 1];
+		int child_size = _level_size[level - 1];
+		Node *parent = nodes + _level_offset[level];
+		for (int y = from.y; y <= to.y; y++) {
+			for (int x = from.x; x <= to.x; x++) {
+				const Node &c00 = child[(y * 2) * child_size + x * 2];
+				const Node &c10 = child[(y * 2) * child_size + x * 2 + 1];
+				const Node &c01 = child[(y * 2 + 1) * child_size + x * 2];
+				const Node &c11 = child[(y * 2 + 1) * child_size + x * 2 + 1];
+				Node &node = parent[y * _level_size[level] + x];
+				node.min = MIN(MIN(c00.min, c10.min), MIN(c01.min, c11.min));
+				node.max = MAX(MAX(c00.max, c10.max), MAX(c01.max, c11.max));
+			}
+		}
+	}
+}
+
+///////////////////////////
+// Public Functions
+///////////////////////////
+
+// Builds the full pyramid for a p_size x p_size height map
+void HeightPyramid::build(const Heights &p_heights, int p_size) {
+	ERR_FAIL_COND(p_heights.data == nullptr);
+	ERR_FAIL_COND(p_size < LEAF_SIZE || (p_size & (p_size - 1)) != 0);
+	_size = p_size;
+	_level_count = 0;
+	int total = 0;
+	for (int nodes = p_size / LEAF_SIZE; nodes >= 1 && _level_count < MAX_LEVELS; nodes /= 2) {
+		_level_size[_level_count] = nodes;
+		_level_offset[_level_count] = total;
+		total += nodes * nodes;
+		_level_count++;
+	}
+	_nodes.resize(total);
+	Rect2i leaves = Rect2i(0, 0, _level_size[0], _level_size[0]);
+	_update_leaves(p_heights, leaves);
+	_update_parents(leaves);
+}
+
+// Updates the nodes affected by changed pixels in p_rect, in region pixel coordinates
+void HeightPyramid::update(const Heights &p_heights, Rect2i p_rect) {
+	if (_level_count == 0 || p_heights.data == nullptr) {
+		return;
+	}
+	p_rect = p_rect.intersection(Rect2i(0, 0, _size, _size));
+	if (!p_rect.has_area()) {
+		return;
+	}
+	// A pixel on a leaf boundary also belongs to the previous leaf
+	int last_leaf = _level_size[0] - 1;
+	Vector2i from = Vector2i(MAX(p_rect.position.x - 1, 0), MAX(p_rect.position.y - 1, 0)) / LEAF_SIZE;
+	Vector2i to = (p_rect.get_end() - Vector2i(1, 1)) / LEAF_SIZE;
+	to = Vector2i(MIN(to.x, last_leaf), MIN(to.y, last_leaf));
+	Rect2i leaves = Rect2i(from, to - from + Vector2i(1, 1));
+	_update_leaves(p_heights, leaves);
+	_update_parents(leaves);
+}
+
+void HeightPyramid::clear() {
+	_size = 0;
+	_level_count = 0;
+	_nodes.clear();
+}
+
+/**
+ * Returns the exact min/max of the heights in p_rect, in region pixel coordinates.
+ * Nodes fully inside the rectangle are used as is, so only the nodes along its border
+ * are descended, and only the leaves they reach are scanned.
+ * Returns min > max if the rectangle contains no valid heights.
+ */
+Vector2 HeightPyramid::get_min_max(const Heights &p_heights, Rect2i p_rect) const {
+	Node result;
+	if (_level_count == 0 || p_heights.data == nullptr) {
+		return Vector2(result.min, result.max);
+	}
+	p_rect = p_rect.intersection(Rect2i(0, 0, _size, _size));
+	if (!p_rect.has_area()) {
+		return Vector2(result.min, result.max);
+	}
+	Vector2i q0 = p_rect.position;
+	Vector2i q1 = p_rect.get_end() - Vector2i(1, 1); // Inclusive
+
+	struct Entry {
+		int level;
+		int x;
+		int y;
+	};
+	Entry stack[4 * MAX_LEVELS];
+	int top = 0;
+	stack[top++] = { _level_count - 1, 0, 0 };
+	int last = _size - 1;
+	const Node *nodes = _nodes.ptr();
+	while (top > 0) {
+		Entry e = stack[--top];
+		int ns = get_node_size(e.level);
+		// Node pixel extent, inclusive of the shared edge
+		int x0 = e.x * ns;
+		int y0 = e.y * ns;
+		int x1 = MIN(x0 + ns, last);
+		int y1 = MIN(y0 + ns, last);
+		if (x0 > q1.x || y0 > q1.y || x1 < q0.x || y1 < q0.y) {
+			continue;
+		}
+		if (x0 >= q0.x && y0 >= q0.y && x1 <= q1.x && y1 <= q1.y) {
+			const Node &node = nodes[_level_offset[e.level] + e.y * _level_size[e.level] + e.x];
+			result.min = MIN(result.min, node.min);
+			result.max = MAX(result.max, node.max);
+			continue;
+		}
+		if (e.level == 0) {
+			for (int y = MAX(y0, q0.y); y <= MIN(y1, q1.y); y++) {
+				int row = y * _size;
+				for (int x = MAX(x0, q0.x); x <= MIN(x1, q1.x); x++) {
+					float h = p_heights.get(row + x);
+					if (h < result.min) {
+						result.min = h;
+					}
+					if (h > result.max) {
+						result.max = h;
+					}
+				}
+			}
+			continue;
+		}
+		int child_level = e.level - 1;
+		int child_count = _level_size[child_level];
+		for (int cy = e.y * 2; cy <= MIN(e.y * 2 + 1, child_count - 1); cy++) {
+			for (int cx = e.x * 2; cx <= MIN(e.x * 2 + 1, child_count - 1); cx++) {
+				stack[top++] = { child_level, cx, cy };
+			}
+		}
+	}
+	return Vector2(result.min, result.max);
+}
@@ -0,0 +1,87 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#ifndef HEIGHTPYRAMID_CLASS_H
+#define HEIGHTPYRAMID_CLASS_H
+
+#include <cfloat>
+
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/templates/vector.hpp>
+#include <godot_cpp/variant/rect2i.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+
+#include "constants.h"
+
+using namespace godot;
+
+/**
+ * Min/max mip pyramid over one region's height map.
+ * Level 0 nodes cover LEAF_SIZE x LEAF_SIZE quads, ie. LEAF_SIZE + 1 pixels per side including the
+ * edge shared with the next node, so a node bounds every quad inside it. Each level above halves
+ * the nodes per side until a single node covers the region.
+ * Heights are read from the region's FORMAT_RF or FORMAT_RH image memory, passed in by the caller.
+ * NAN heights are ignored. A node with no valid heights has min > max.
+ */
+class HeightPyramid {
+	CLASS_NAME_STATIC("Terrain3DHeightPyramid");
+
+public:
+	static inline const int LEAF_SIZE = 8;
+	static inline const int MAX_LEVELS = 16;
+
+	struct Node {
+		float min = FLT_MAX;
+		float max = -FLT_MAX;
+	};
+
+	// Raw height map memory, 32-bit or 16-bit (half) floats
+	struct Heights {
+		const void *data = nullptr;
+		bool half = false;
+		float get(int p_index) const;
+	};
+
+private:
+	int _size = 0; // Region size in pixels
+	int _level_count = 0;
+	int _level_size[MAX_LEVELS] = {}; // Nodes per side
+	int _level_offset[MAX_LEVELS] = {}; // Index of the first node of each level in _nodes
+	Vector<Node> _nodes;
+
+	void _update_leaves(const Heights &p_heights, Rect2i p_leaves);
+	void _update_parents(Rect2i p_leaves);
+
+public:
+	void build(const Heights &p_heights, int p_size);
+	void update(const Heights &p_heights, Rect2i p_rect);
+	void clear();
+	bool is_valid() const { return _level_count > 0; }
+	int get_size() const { return _size; }
+	int get_level_count() const { return _level_count; }
+	int get_level_size(int p_level) const { return _level_size[p_level]; }
+	int get_node_size(int p_level) const { return LEAF_SIZE << p_level; }
+	Node get_node(int p_level, int p_x, int p_y) const;
+	Vector2 get_min_max() const;
+	Vector2 get_min_max(const Heights &p_heights, Rect2i p_rect) const;
+};
+
+// Inline Functions
+
+inline float HeightPyramid::Heights::get(int p_index) const {
+	return (half) ? Math::half_to_float(static_cast<const uint16_t *>(data)[p_index]) : static_cast<const float *>(data)[p_index];
+}
+
+inline HeightPyramid::Node HeightPyramid::get_node(int p_level, int p_x, int p_y) const {
+	return _nodes[_level_offset[p_level] + p_y * _level_size[p_level] + p_x];
+}
+
+// Returns the range of the whole region, or min > max if there are no valid heights
+inline Vector2 HeightPyramid::get_min_max() const {
+	if (_level_count == 0) {
+		return Vector2(FLT_MAX, -FLT_MAX);
+	}
+	Node top = _nodes[_level_offset[_level_count - 1]];
+	return Vector2(top.min, top.max);
+}
+
+#endif // HEIGHTPYRAMID_CLASS_H
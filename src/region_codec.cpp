@@ -0,0 +1,373 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#include <cstring>
+
+#include <godot_cpp/classes/file_access.hpp>
+
+#include "logger.h"
+#include "region_codec.h"
+#include "terrain_3d_util.h"
+
+///////////////////////////
+// Local Functions
+///////////////////////////
+
+static void write_32(uint8_t *&p_ptr, uint32_t p_value) {
+	for (int i = 0; i < 4; i++) {
+		*p_ptr++ = uint8_t(p_value >> (8 * i));
+	}
+}
+
+static void write_64(uint8_t *&p_ptr, uint64_t p_value) {
+	write_32(p_ptr, uint32_t(p_value));
+	write_32(p_ptr, uint32_t(p_value >> 32));
+}
+
+static uint32_t read_32(const uint8_t *&p_ptr) {
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++) {
+		value |= uint32_t(*p_ptr++) << (8 * i);
+	}
+	return value;
+}
+
+static uint64_t read_64(const uint8_t *&p_ptr) {
+	uint64_t low = read_32(p_ptr);
+	return low | (uint64_t(read_32(p_ptr)) << 32);
+}
+
+// Largest image Godot accepts, Image::MAX_PIXELS, which isn't exposed to extensions
+static const uint64_t MAX_PIXELS = 268435456;
+
+// Bytes per pixel a filter works on for this format, or 0 if the filter doesn't apply
+static int get_filter_pixel_size(RegionCodec::Filter p_filter, Image::Format p_format) {
+	switch (p_filter) {
+		case RegionCodec::FILTER_HEIGHT:
+			return (p_format == Image::FORMAT_RF) ? 4 : (p_format == Image::FORMAT_RH) ? 2 : 0;
+		case RegionCodec::FILTER_BITFIELD:
+			return (p_format == Image::FORMAT_RF) ? 4 : 0;
+		case RegionCodec::FILTER_BYTES:
+			switch (p_format) {
+				case Image::FORMAT_L8:
+				case Image::FORMAT_R8:
+					return 1;
+				case Image::FORMAT_LA8:
+				case Image::FORMAT_RG8:
+					return 2;
+				case Image::FORMAT_RGB8:
+					return 3;
+				case Image::FORMAT_RGBA8:
+					return 4;
+				default:
+					return 0;
+			}
+		default:
+			return 0;
+	}
+}
+
+// Maps float bits to unsigned integers that sort in the same order as the floats,
+// so neighboring heights of either sign have small differences
+template <typename T>
+static inline T to_ordered(T p_bits) {
+	const T sign = T(1) << (sizeof(T) * 8 - 1);
+	return (p_bits & sign) ? T(~p_bits) : T(p_bits | sign);
+}
+
+template <typename T>
+static inline T from_ordered(T p_ordered) {
+	const T sign = T(1) << (sizeof(T) * 8 - 1);
+	return (p_ordered & sign) ? T(p_ordered & ~sign) : T(~p_ordered);
+}
+
+// Gradient predictor, the plane through the left, upper and upper left neighbors
+template <typename T>
+static inline T predict(const T *p_values, int p_x, int p_y, int p_width) {
+	int i = p_y * p_width + p_x;
+	if (p_x == 0) {
+		return (p_y == 0) ? T(0) : p_values[i - p_width];
+	}
+	if (p_y == 0) {
+		return p_values[i - 1];
+	}
+	return T(p_values[i - 1] + p_values[i - p_width] - p_values[i - p_width - 1]);
+}
+
+// Interleaves negative and positive residuals, so small magnitudes have zero high bytes
+template <typename T>
+static inline T zigzag(T p_residual) {
+	return T(p_residual << 1) ^ T(T(0) - (p_residual >> (sizeof(T) * 8 - 1)));
+}
+
+template <typename T>
+static inline T unzigzag(T p_value) {
+	return T(p_value >> 1) ^ T(T(0) - (p_value & 1));
+}
+
+template <typename T>
+static void filter_height(int p_width, int p_height, const uint8_t *p_src, uint8_t *r_dst) {
+	int count = p_width * p_height;
+	const T *src = reinterpret_cast<const T *>(p_src);
+	Vector<T> ordered;
+	ordered.resize(count);
+	T *ord = ordered.ptrw();
+	for (int i = 0; i < count; i++) {
+		ord[i] = to_ordered(src[i]);
+	}
+	for (int y = 0; y < p_height; y++) {
+		for (int x = 0; x < p_width; x++) {
+			int i = y * p_width + x;
+			T value = zigzag(T(ord[i] - predict(ord, x, y, p_width)));
+			for (uint32_t b = 0; b < sizeof(T); b++) {
+				r_dst[b * count + i] = uint8_t(value >> (8 * b));
+			}
+		}
+	}
+}
+
+template <typename T>
+static void unfilter_height(int p_width, int p_height, const uint8_t *p_src, uint8_t *r_dst) {
+	int count = p_width * p_height;
+	T *dst = reinterpret_cast<T *>(r_dst);
+	Vector<T> ordered;
+	ordered.resize(count);
+	T *ord = ordered.ptrw();
+	for (int y = 0; y < p_height; y++) {
+		for (int x = 0; x < p_width; x++) {
+			int i = y * p_width + x;
+			T value = 0;
+			for (uint32_t b = 0; b < sizeof(T); b++) {
+				value |= T(T(p_src[b * count + i]) << (8 * b));
+			}
+			ord[i] = T(unzigzag(value) + predict(ord, x, y, p_width));
+			dst[i] = from_ordered(ord[i]);
+		}
+	}
+}
+
+///////////////////////////
+// Private Functions
+///////////////////////////
+
+// p_src and r_dst hold the base level of p_width * p_height pixels
+void RegionCodec::_filter(Filter p_filter, Image::Format p_format, int p_width, int p_height, const uint8_t *p_src, uint8_t *r_dst) {
+	int count = p_width * p_height;
+	int pixel_size = get_filter_pixel_size(p_filter, p_format);
+	switch (p_filter) {
+		case FILTER_HEIGHT: {
+			if (pixel_size == 4) {
+				filter_height<uint32_t>(p_width, p_height, p_src, r_dst);
+			} else {
+				filter_height<uint16_t>(p_width, p_height, p_src, r_dst);
+			}
+		} break;
+		case FILTER_BITFIELD: {
+			const uint32_t *src = reinterpret_cast<const uint32_t *>(p_src);
+			int plane_size = (count + 7) / 8;
+			memset(r_dst, 0, size_t(plane_size) * 32);
+			for (int i = 0; i < count; i++) {
+				uint32_t prev = (i % p_width) ? src[i - 1] : (i >= p_width) ? src[i - p_width] : 0;
+				uint32_t value = src[i] ^ prev;
+				for (int b = 0; value; b++, value >>= 1) {
+					if (value & 1) {
+						r_dst[b * plane_size + i / 8] |= uint8_t(1 << (i & 7));
+					}
+				}
+			}
+		} break;
+		case FILTER_BYTES: {
+			for (int i = 0; i < count; i++) {
+				int prev = (i % p_width) ? i - 1 : i - p_width;
+				for (int c = 0; c < pixel_size; c++) {
+					uint8_t value = p_src[i * pixel_size + c];
+					if (prev >= 0) {
+						value -= p_src[prev * pixel_size + c];
+					}
+					r_dst[c * count + i] = value;
+				}
+			}
+		} break;
+		default:
+			break;
+	}
+}
+
+void RegionCodec::_unfilter(Filter p_filter, Image::Format p_format, int p_width, int p_height, const uint8_t *p_src, uint8_t *r_dst) {
+	int count = p_width * p_height;
+	int pixel_size = get_filter_pixel_size(p_filter, p_format);
+	switch (p_filter) {
+		case FILTER_HEIGHT: {
+			if (pixel_size == 4) {
+				unfilter_height<uint32_t>(p_width, p_height, p_src, r_dst);
+			} else {
+				unfilter_height<uint16_t>(p_width, p_height, p_src, r_dst);
+			}
+		} break;
+		case FILTER_BITFIELD: {
+			uint32_t *dst = reinterpret_cast<uint32_t *>(r_dst);
+			int plane_size = (count + 7) / 8;
+			for (int i = 0; i < count; i++) {
+				uint32_t value = 0;
+				for (int b = 0; b < 32; b++) {
+					value |= uint32_t((p_src[b * plane_size + i / 8] >> (i & 7)) & 1) << b;
+				}
+				uint32_t prev = (i % p_width) ? dst[i - 1] : (i >= p_width) ? dst[i - p_width] : 0;
+				dst[i] = value ^ prev;
+			}
+		} break;
+		case FILTER_BYTES: {
+			for (int i = 0; i < count; i++) {
+				int prev = (i % p_width) ? i - 1 : i - p_width;
+				for (int c = 0; c < pixel_size; c++) {
+					uint8_t value = p_src[c * count + i];
+					if (prev >= 0) {
+						value += r_dst[prev * pixel_size + c];
+					}
+					r_dst[i * pixel_size + c] = value;
+				}
+			}
+		} break;
+		default:
+			break;
+	}
+}
+
+///////////////////////////
+// Public Functions
+///////////////////////////
+
+// p_filters is parallel to p_maps. A filter that doesn't suit a map's format is replaced by FILTER_NONE
+PackedByteArray RegionCodec::encode(const TypedArray<Image> &p_maps, const Vector<Filter> &p_filters) {
+	Vector<PackedByteArray> blocks;
+	Vector<Filter> filters;
+	Vector<uint64_t> sizes;
+	uint64_t total = 12;
+	for (int m = 0; m < p_maps.size(); m++) {
+		Ref<Image> img = p_maps[m];
+		if (img.is_null()) {
+			LOG(ERROR, "Map ", m, " is null");
+			return PackedByteArray();
+		}
+		if (Util::get_format_pixel_size(img->get_format()) == 0) {
+			LOG(ERROR, "Map ", m, " format ", img->get_format(), " is not supported");
+			return PackedByteArray();
+		}
+		PackedByteArray data = img->get_data();
+		Filter filter = (m < p_filters.size()) ? p_filters[m] : FILTER_NONE;
+		int pixel_size = get_filter_pixel_size(filter, img->get_format());
+		int64_t base_size = int64_t(img->get_width()) * img->get_height() * pixel_size;
+		if (pixel_size == 0 || base_size > data.size()) {
+			filter = FILTER_NONE;
+		}
+		if (filter != FILTER_NONE) {
+			PackedByteArray filtered;
+			// Bit planes round each plane up to whole bytes
+			int64_t filtered_size = (filter == FILTER_BITFIELD) ? (int64_t(img->get_width()) * img->get_height() + 7) / 8 * 32 : base_size;
+			filtered.resize(filtered_size + data.size() - base_size);
+			_filter(filter, img->get_format(), img->get_width(), img->get_height(), data.ptr(), filtered.ptrw());
+			memcpy(filtered.ptrw() + filtered_size, data.ptr() + base_size, size_t(data.size() - base_size));
+			data = filtered;
+		}
+		sizes.push_back(uint64_t(data.size()));
+		filters.push_back(filter);
+		blocks.push_back(data.compress(FileAccess::COMPRESSION_ZSTD));
+		total += 36 + uint64_t(blocks[m].size());
+	}
+
+	PackedByteArray out;
+	out.resize(int64_t(total));
+	uint8_t *ptr = out.ptrw();
+	memcpy(ptr, "T3DZ", 4);
+	ptr += 4;
+	write_32(ptr, VERSION);
+	write_32(ptr, uint32_t(p_maps.size()));
+	for (int m = 0; m < p_maps.size(); m++) {
+		Ref<Image> img = p_maps[m];
+		write_32(ptr, uint32_t(img->get_format()));
+		write_32(ptr, uint32_t(img->get_width()));
+		write_32(ptr, uint32_t(img->get_height()));
+		write_32(ptr, img->has_mipmaps() ? 1 : 0);
+		write_32(ptr, uint32_t(filters[m]));
+		write_64(ptr, sizes[m]);
+		write_64(ptr, uint64_t(blocks[m].size()));
+		memcpy(ptr, blocks[m].ptr(), size_t(blocks[m].size()));
+		ptr += blocks[m].size();
+	}
+	return out;
+}
+
+Error RegionCodec::decode(const PackedByteArray &p_data, TypedArray<Image> &r_maps) {
+	const uint8_t *ptr = p_data.ptr();
+	const uint8_t *end = ptr + p_data.size();
+	if (p_data.size() < 12 || memcmp(ptr, "T3DZ", 4) != 0) {
+		LOG(ERROR, "Not a compressed region");
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	ptr += 4;
+	uint32_t version = read_32(ptr);
+	if (version > VERSION) {
+		LOG(ERROR, "Compressed region version ", version, " is newer than supported version ", VERSION);
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	uint32_t map_count = read_32(ptr);
+	TypedArray<Image> maps;
+	for (uint32_t m = 0; m < map_count; m++) {
+		if (end - ptr < 36) {
+			LOG(ERROR, "Compressed region is truncated");
+			return ERR_FILE_CORRUPT;
+		}
+		Image::Format format = Image::Format(read_32(ptr));
+		uint32_t width = read_32(ptr);
+		uint32_t height = read_32(ptr);
+		bool mipmaps = read_32(ptr) != 0;
+		Filter filter = Filter(read_32(ptr));
+		uint64_t size = read_64(ptr);
+		uint64_t packed_size = read_64(ptr);
+		if (format < 0 || format >= Image::FORMAT_MAX || filter < 0 || filter >= FILTER_MAX ||
+				width == 0 || width > uint32_t(Image::MAX_WIDTH) || height == 0 || height > uint32_t(Image::MAX_HEIGHT) ||
+				uint64_t(width) * height > MAX_PIXELS ||
+				packed_size > uint64_t(end - ptr)) {
+			LOG(ERROR, "Compressed region map ", m, " is corrupt");
+			return ERR_FILE_CORRUPT;
+		}
+
+		// Checked before decompressing, so a corrupt header can't request a huge allocation
+		int64_t image_size = Util::get_image_data_size(int(width), int(height), format, mipmaps);
+		int pixel_size = get_filter_pixel_size(filter, format);
+		bool filtered = filter != FILTER_NONE && pixel_size > 0;
+		int64_t base_size = int64_t(width) * height * pixel_size;
+		int64_t filtered_size = (filter == FILTER_BITFIELD) ? (int64_t(width) * height + 7) / 8 * 32 : base_size;
+		int64_t stored_size = filtered ? image_size - base_size + filtered_size : image_size;
+		if (image_size == 0 || base_size > image_size || size != uint64_t(stored_size)) {
+			LOG(ERROR, "Compressed region map ", m, " is corrupt. ", width, "x", height, " format ", format,
+					" needs ", stored_size, " bytes, found ", size);
+			return ERR_FILE_CORRUPT;
+		}
+
+		PackedByteArray packed;
+		packed.resize(int64_t(packed_size));
+		memcpy(packed.ptrw(), ptr, size_t(packed_size));
+		ptr += packed_size;
+		PackedByteArray data = packed.decompress(int64_t(size), FileAccess::COMPRESSION_ZSTD);
+		if (uint64_t(data.size()) != size) {
+			LOG(ERROR, "Compressed region map ", m, " failed to decompress");
+			return ERR_FILE_CORRUPT;
+		}
+
+		if (filtered) {
+			PackedByteArray unfiltered;
+			unfiltered.resize(image_size);
+			_unfilter(filter, format, int(width), int(height), data.ptr(), unfiltered.ptrw());
+			memcpy(unfiltered.ptrw() + base_size, data.ptr() + filtered_size, size_t(image_size - base_size));
+			data = unfiltered;
+		}
+		Ref<Image> img = Image::create_from_data(int(width), int(height), mipmaps, format, data);
+		if (img.is_null() || img->get_size() != Vector2i(int(width), int(height)) || img->get_format() != format) {
+			LOG(ERROR, "Compressed region map ", m, " failed to create an image");
+			return ERR_FILE_CORRUPT;
+		}
+		maps.push_back(img);
+	}
+	r_maps = maps;
+	return OK;
+}
@@ -0,0 +1,53 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#ifndef REGIONCODEC_CLASS_H
+#define REGIONCODEC_CLASS_H
+
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/templates/vector.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+
+#include "constants.h"
+
+using namespace godot;
+
+/**
+ * Lossless compression of the maps of a single region, aware of what the maps hold.
+ * Each map is first transformed by a filter so the data becomes mostly small or repeated
+ * values, then compressed with Zstandard.
+ *	FILTER_HEIGHT: heights (RF or RH). Float bits are mapped to ordered integers, predicted from
+ *		their left, upper and upper left neighbors, and the residuals are split into byte planes.
+ *	FILTER_BITFIELD: the control map. Each value is XORed with its left neighbor, so unchanged
+ *		fields become 0, then split into 32 bit planes, so each field compresses on its own.
+ *	FILTER_BYTES: the color map. Each channel is delta coded against its left neighbor and split
+ *		into channel planes.
+ * Only the base level is filtered, mipmaps follow it unfiltered. Only uncompressed formats are stored.
+ * The blob is: char[4] magic "T3DZ", uint32 version, uint32 map count, then per map: uint32 format,
+ *	uint32 width, uint32 height, uint32 has mipmaps, uint32 filter, uint64 data size,
+ *	uint64 compressed size, compressed data.
+ * Functions are static and only touch their arguments, so regions can be coded on worker threads.
+ */
+class RegionCodec {
+	CLASS_NAME_STATIC("Terrain3DRegionCodec");
+
+public:
+	static inline const uint32_t VERSION = 1;
+
+	enum Filter {
+		FILTER_NONE,
+		FILTER_HEIGHT,
+		FILTER_BITFIELD,
+		FILTER_BYTES,
+		FILTER_MAX,
+	};
+
+private:
+	static void _filter(Filter p_filter, Image::Format p_format, int p_width, int p_height, const uint8_t *p_src, uint8_t *r_dst);
+	static void _unfilter(Filter p_filter, Image::Format p_format, int p_width, int p_height, const uint8_t *p_src, uint8_t *r_dst);
+
+public:
+	static PackedByteArray encode(const TypedArray<Image> &p_maps, const Vector<Filter> &p_filters);
+	static Error decode(const PackedByteArray &p_data, TypedArray<Image> &r_maps);
+};
+
+#endif // REGIONCODEC_CLASS_H
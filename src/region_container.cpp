@@ -0,0 +1,299 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+#include <godot_cpp/classes/dir_access.hpp>
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/project_settings.hpp>
+
+#include "logger.h"
+#include "region_container.h"
+#include "terrain_3d_util.h"
+
+///////////////////////////
+// Private Functions
+///////////////////////////
+
+// Maps the whole file read only. Returns false if the file isn't on disk or can't be mapped
+bool RegionContainer::_map_file(const String &p_path) {
+	String os_path = ProjectSettings::get_singleton()->globalize_path(p_path);
+#ifdef _WIN32
+	HANDLE file = CreateFileW((LPCWSTR)os_path.utf16().get_data(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE map = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (map == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+	void *view = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(map);
+		CloseHandle(file);
+		return false;
+	}
+	_file_handle = file;
+	_map_handle = map;
+	_mapping = static_cast<const uint8_t *>(view);
+	_mapping_size = uint64_t(size.QuadPart);
+#else
+	int fd = ::open(os_path.utf8().get_data(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void *view = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	if (view == MAP_FAILED) {
+		::close(fd);
+		return false;
+	}
+	_fd = fd;
+	_mapping = static_cast<const uint8_t *>(view);
+	_mapping_size = uint64_t(st.st_size);
+#endif
+	return true;
+}
+
+void RegionContainer::_unmap_file() {
+	if (_mapping == nullptr) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(_mapping);
+	CloseHandle(_map_handle);
+	CloseHandle(_file_handle);
+	_map_handle = nullptr;
+	_file_handle = nullptr;
+#else
+	munmap(const_cast<uint8_t *>(_mapping), size_t(_mapping_size));
+	::close(_fd);
+	_fd = -1;
+#endif
+	_mapping = nullptr;
+	_mapping_size = 0;
+}
+
+///////////////////////////
+// Public Functions
+///////////////////////////
+
+// Reads the header and index. Map data is not read until load_region()
+Error RegionContainer::open(const String &p_path) {
+	close();
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::READ);
+	if (file.is_null()) {
+		LOG(ERROR, "Cannot open region container: ", p_path);
+		return FileAccess::get_open_error();
+	}
+	if (file->get_buffer(4).get_string_from_ascii() != "T3DC") {
+		LOG(ERROR, "Not a region container: ", p_path);
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	uint32_t version = file->get_32();
+	if (version > VERSION) {
+		LOG(ERROR, "Region container version ", version, " is newer than supported version ", VERSION, ": ", p_path);
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	int region_size = int(file->get_32());
+	uint32_t region_count = file->get_32();
+	uint32_t map_count = file->get_32();
+	file->get_32(); // Page size, only used when writing
+	uint64_t index_offset = file->get_64();
+	uint64_t length = file->get_length();
+	// Both counts are bounded by the file, so the products can't overflow
+	uint64_t entry_size = 8 + uint64_t(map_count) * 24;
+	if (region_size <= 0 || region_size > Image::MAX_WIDTH || map_count > length / 24 ||
+			index_offset > length || region_count > (length - index_offset) / entry_size) {
+		LOG(ERROR, "Region container index is truncated or corrupt: ", p_path);
+		return ERR_FILE_CORRUPT;
+	}
+
+	file->seek(index_offset);
+	Vector<Entry> entries;
+	entries.resize(region_count);
+	Entry *entries_ptr = entries.ptrw();
+	for (uint32_t r = 0; r < region_count; r++) {
+		Entry &entry = entries_ptr[r];
+		entry.offset = Vector2i(int32_t(file->get_32()), int32_t(file->get_32()));
+		entry.maps.resize(map_count);
+		for (uint32_t m = 0; m < map_count; m++) {
+			MapEntry map;
+			map.format = Image::Format(file->get_32());
+			map.mipmaps = (file->get_32() & 1) != 0;
+			map.offset = file->get_64();
+			map.size = file->get_64();
+			if (map.format < 0 || map.format >= Image::FORMAT_MAX || map.size > length || map.offset > length - map.size ||
+					int64_t(map.size) != Util::get_image_data_size(region_size, region_size, map.format, map.mipmaps)) {
+				LOG(ERROR, "Region container entry ", r, " map ", m, " is corrupt: ", p_path);
+				return ERR_FILE_CORRUPT;
+			}
+			entry.maps.set(m, map);
+		}
+	}
+	file.unref();
+
+	_path = p_path;
+	_region_size = region_size;
+	_entries = entries;
+	if (!_map_file(p_path)) {
+		LOG(DEBUG, "Region container can't be memory mapped, reading with FileAccess: ", p_path);
+	}
+	LOG(INFO, "Opened region container with ", region_count, " regions, mapped: ", is_mapped(), ", ", p_path);
+	return OK;
+}
+
+void RegionContainer::close() {
+	_unmap_file();
+	_path = String();
+	_region_size = 0;
+	_entries.clear();
+}
+
+// Creates the Images for one region. Only this region's pages of the file are read
+Error RegionContainer::load_region(int p_index, TypedArray<Image> &r_maps) const {
+	ERR_FAIL_INDEX_V(p_index, _entries.size(), ERR_INVALID_PARAMETER);
+	const Entry &entry = _entries[p_index];
+	Ref<FileAccess> file;
+	if (!is_mapped()) {
+		file = FileAccess::open(_path, FileAccess::READ);
+		if (file.is_null()) {
+			LOG(ERROR, "Cannot open region container: ", _path);
+			return FileAccess::get_open_error();
+		}
+	}
+	TypedArray<Image> maps;
+	for (int m = 0; m < entry.maps.size(); m++) {
+		const MapEntry &map = entry.maps[m];
+		PackedByteArray data;
+		if (is_mapped()) {
+			data.resize(int64_t(map.size));
+			memcpy(data.ptrw(), _mapping + map.offset, size_t(map.size));
+		} else {
+			file->seek(map.offset);
+			data = file->get_buffer(int64_t(map.size));
+			if (uint64_t(data.size()) != map.size) {
+				LOG(ERROR, "Region container read failed for region ", entry.offset, ": ", _path);
+				return ERR_FILE_CORRUPT;
+			}
+		}
+		Ref<Image> img = Image::create_from_data(_region_size, _region_size, map.mipmaps, map.format, data);
+		if (img.is_null() || img->is_empty()) {
+			LOG(ERROR, "Region container map ", m, " of region ", entry.offset, " is corrupt: ", _path);
+			return ERR_FILE_CORRUPT;
+		}
+		maps.push_back(img);
+	}
+	r_maps = maps;
+	return OK;
+}
+
+/**
+ * Writes a container. p_maps holds one array per map type, each parallel to p_offsets.
+ * Writes to a temporary file first, so an interrupted write doesn't corrupt an existing container.
+ */
+Error RegionContainer::write(const String &p_path, int p_region_size, const TypedArray<Vector2i> &p_offsets,
+		const Vector<TypedArray<Image>> &p_maps) {
+	uint32_t region_count = p_offsets.size();
+	uint32_t map_count = p_maps.size();
+	for (uint32_t m = 0; m < map_count; m++) {
+		if (uint32_t(p_maps[m].size()) != region_count) {
+			LOG(ERROR, "Map type ", m, " has ", p_maps[m].size(), " maps for ", region_count, " regions");
+			return ERR_INVALID_PARAMETER;
+		}
+	}
+
+	// Lay out page aligned data blocks after the index
+	uint64_t entry_size = 8 + uint64_t(map_count) * 24;
+	uint64_t data_offset = HEADER_SIZE + entry_size * region_count;
+	Vector<uint64_t> offsets;
+	offsets.resize(region_count * map_count);
+	for (uint32_t r = 0; r < region_count; r++) {
+		for (uint32_t m = 0; m < map_count; m++) {
+			Ref<Image> img = p_maps[m][r];
+			if (img.is_null()) {
+				LOG(ERROR, "Region ", p_offsets[r], " map ", m, " is null");
+				return ERR_INVALID_DATA;
+			}
+			data_offset = (data_offset + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+			offsets.set(r * map_count + m, data_offset);
+			data_offset += uint64_t(img->get_data().size());
+		}
+	}
+
+	String tmp_path = p_path + ".tmp";
+	Ref<FileAccess> file = FileAccess::open(tmp_path, FileAccess::WRITE);
+	if (file.is_null()) {
+		LOG(ERROR, "Cannot open file for writing: ", tmp_path);
+		return FileAccess::get_open_error();
+	}
+	file->store_buffer(String("T3DC").to_ascii_buffer());
+	file->store_32(VERSION);
+	file->store_32(uint32_t(p_region_size));
+	file->store_32(region_count);
+	file->store_32(map_count);
+	file->store_32(PAGE_SIZE);
+	file->store_64(HEADER_SIZE);
+	PackedByteArray padding;
+	padding.resize(HEADER_SIZE - file->get_position());
+	padding.fill(0);
+	file->store_buffer(padding);
+
+	for (uint32_t r = 0; r < region_count; r++) {
+		Vector2i offset = p_offsets[r];
+		file->store_32(uint32_t(offset.x));
+		file->store_32(uint32_t(offset.y));
+		for (uint32_t m = 0; m < map_count; m++) {
+			Ref<Image> img = p_maps[m][r];
+			file->store_32(uint32_t(img->get_format()));
+			file->store_32(img->has_mipmaps() ? 1 : 0);
+			file->store_64(offsets[r * map_count + m]);
+			file->store_64(uint64_t(img->get_data().size()));
+		}
+	}
+
+	for (uint32_t r = 0; r < region_count; r++) {
+		for (uint32_t m = 0; m < map_count; m++) {
+			Ref<Image> img = p_maps[m][r];
+			padding.resize(int64_t(offsets[r * map_count + m] - file->get_position()));
+			padding.fill(0);
+			file->store_buffer(padding);
+			file->store_buffer(img->get_data());
+		}
+	}
+
+	Error err = file->get_error();
+	file.unref(); // Close before renaming
+	if (err != OK) {
+		LOG(ERROR, "Error writing region container: ", tmp_path);
+		DirAccess::remove_absolute(tmp_path);
+		return err;
+	}
+	LOG(INFO, "Wrote region container with ", region_count, " regions, ", data_offset / (1024 * 1024), " MB: ", p_path);
+	return DirAccess::rename_absolute(tmp_path, p_path);
+}
@@ -0,0 +1,84 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#ifndef REGIONCONTAINER_CLASS_H
+#define REGIONCONTAINER_CLASS_H
+
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/templates/vector.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+
+#include "constants.h"
+
+using namespace godot;
+
+/**
+ * A single file holding the maps of many regions, laid out so opening it costs only the index.
+ *	Header (64 bytes): char[4] magic "T3DC", uint32 version, uint32 region size, uint32 region count,
+ *		uint32 map count, uint32 page size, uint64 index offset, zero padding.
+ *	Index: per region, int32 offset x, int32 offset y, then per map: uint32 format,
+ *		uint32 flags (bit 0: has mipmaps), uint64 data offset, uint64 data size.
+ *	Data: the raw Image data of each map, uncompressed, each block starting on a page boundary.
+ * open() memory maps the file where the OS allows, so a region's pages are only read from disk
+ * when load_region() first touches them. Files that can't be mapped, such as those inside a
+ * PCK, are read with FileAccess instead. load_region() is const and safe to call from threads.
+ */
+class RegionContainer {
+	CLASS_NAME_STATIC("Terrain3DRegionContainer");
+
+public:
+	static inline const char *EXTENSION = "t3dc";
+	static inline const uint32_t VERSION = 1;
+	static inline const uint32_t PAGE_SIZE = 4096;
+	static inline const uint32_t HEADER_SIZE = 64;
+
+private:
+	struct MapEntry {
+		Image::Format format = Image::FORMAT_MAX;
+		bool mipmaps = false;
+		uint64_t offset = 0;
+		uint64_t size = 0;
+	};
+
+	struct Entry {
+		Vector2i offset;
+		Vector<MapEntry> maps;
+	};
+
+	String _path;
+	int _region_size = 0;
+	Vector<Entry> _entries;
+
+	// Memory mapping, or null if reading through FileAccess
+	const uint8_t *_mapping = nullptr;
+	uint64_t _mapping_size = 0;
+#ifdef _WIN32
+	void *_file_handle = nullptr;
+	void *_map_handle = nullptr;
+#else
+	int _fd = -1;
+#endif
+
+	bool _map_file(const String &p_path);
+	void _unmap_file();
+
+public:
+	RegionContainer() {}
+	RegionContainer(const RegionContainer &) = delete;
+	RegionContainer &operator=(const RegionContainer &) = delete;
+	~RegionContainer() { close(); }
+
+	Error open(const String &p_path);
+	void close();
+	bool is_open() const { return !_path.is_empty(); }
+	bool is_mapped() const { return _mapping != nullptr; }
+	String get_path() const { return _path; }
+	int get_region_size() const { return _region_size; }
+	int get_region_count() const { return _entries.size(); }
+	Vector2i get_region_offset(int p_index) const { return _entries[p_index].offset; }
+	Error load_region(int p_index, TypedArray<Image> &r_maps) const;
+
+	static Error write(const String &p_path, int p_region_size, const TypedArray<Vector2i> &p_offsets,
+			const Vector<TypedArray<Image>> &p_maps);
+};
+
+#endif // REGIONCONTAINER_CLASS_H
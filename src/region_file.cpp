@@ -0,0 +1,211 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#include <cstring>
+
+#include <godot_cpp/classes/dir_access.hpp>
+#include <godot_cpp/classes/file_access.hpp>
+
+#include "logger.h"
+#include "region_file.h"
+#include "terrain_3d_util.h"
+
+///////////////////////////
+// Public Functions
+///////////////////////////
+
+// eg. region_-2_3.t3dr
+String RegionFile::get_file_name(Vector2i p_offset) {
+	return vformat("region_%d_%d.%s", p_offset.x, p_offset.y, EXTENSION);
+}
+
+// Returns false if p_file_name isn't a region file name
+bool RegionFile::parse_file_name(const String &p_file_name, Vector2i &r_offset) {
+	if (p_file_name.get_extension() != EXTENSION || !p_file_name.begins_with("region_")) {
+		return false;
+	}
+	PackedStringArray parts = p_file_name.get_basename().trim_prefix("region_").split("_");
+	if (parts.size() != 2 || !parts[0].is_valid_int() || !parts[1].is_valid_int()) {
+		return false;
+	}
+	r_offset = Vector2i(int(parts[0].to_int()), int(parts[1].to_int()));
+	return true;
+}
+
+// Writes to a temporary file first, so an interrupted save doesn't corrupt an existing region
+Error RegionFile::save(const String &p_path, Vector2i p_offset, int p_region_size, const TypedArray<Image> &p_maps) {
+	String tmp_path = p_path + ".tmp";
+	Ref<FileAccess> file = FileAccess::open(tmp_path, FileAccess::WRITE);
+	if (file.is_null()) {
+		LOG(ERROR, "Cannot open file for writing: ", tmp_path);
+		return FileAccess::get_open_error();
+	}
+	file->store_buffer(String("T3DR").to_ascii_buffer());
+	file->store_32(VERSION);
+	file->store_32(uint32_t(p_offset.x));
+	file->store_32(uint32_t(p_offset.y));
+	file->store_32(uint32_t(p_region_size));
+	file->store_32(uint32_t(p_maps.size()));
+	for (int i = 0; i < p_maps.size(); i++) {
+		Ref<Image> img = p_maps[i];
+		if (img.is_null()) {
+			LOG(ERROR, "Region ", p_offset, " map ", i, " is null");
+			file.unref();
+			DirAccess::remove_absolute(tmp_path);
+			return ERR_INVALID_DATA;
+		}
+		// Uniform maps, such as blank ones, are stored as one texel
+		uint32_t texel;
+		bool uniform = Util::is_uniform(img, &texel);
+		PackedByteArray data;
+		if (uniform) {
+			data.resize((img->get_format() == Image::FORMAT_RH) ? 2 : 4);
+			memcpy(data.ptrw(), &texel, data.size());
+		} else {
+			data = img->get_data();
+		}
+		file->store_32(uint32_t(img->get_format()));
+		file->store_32(uint32_t(img->get_width()));
+		file->store_32(uint32_t(img->get_height()));
+		file->store_32((img->has_mipmaps() ? FLAG_MIPMAPS : 0) | (uniform ? FLAG_UNIFORM : 0));
+		file->store_64(uint64_t(data.size()));
+		file->store_buffer(data);
+	}
+	Error err = file->get_error();
+	file.unref(); // Close before renaming
+	if (err != OK) {
+		LOG(ERROR, "Error writing region file: ", tmp_path);
+		DirAccess::remove_absolute(tmp_path);
+		return err;
+	}
+	return DirAccess::rename_absolute(tmp_path, p_path);
+}
+
+Error RegionFile::load(const String &p_path, int p_region_size, TypedArray<Image> &r_maps, Vector2i *r_offset) {
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::READ);
+	if (file.is_null()) {
+		LOG(ERROR, "Cannot open region file: ", p_path);
+		return FileAccess::get_open_error();
+	}
+	if (file->get_buffer(4).get_string_from_ascii() != "T3DR") {
+		LOG(ERROR, "Not a region file: ", p_path);
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	uint32_t version = file->get_32();
+	if (version > VERSION) {
+		LOG(ERROR, "Region file version ", version, " is newer than supported version ", VERSION, ": ", p_path);
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	Vector2i offset = Vector2i(int32_t(file->get_32()), int32_t(file->get_32()));
+	int region_size = int(file->get_32());
+	if (region_size != p_region_size) {
+		LOG(ERROR, "Region file size ", region_size, " doesn't match region size ", p_region_size, ": ", p_path);
+		return ERR_INVALID_DATA;
+	}
+	uint32_t map_count = file->get_32();
+	TypedArray<Image> maps;
+	for (uint32_t i = 0; i < map_count; i++) {
+		Image::Format format = Image::Format(file->get_32());
+		int width = int(file->get_32());
+		int height = int(file->get_32());
+		uint32_t flags = file->get_32();
+		bool mipmaps = (flags & FLAG_MIPMAPS) != 0;
+		bool uniform = (flags & FLAG_UNIFORM) != 0;
+		uint64_t size = file->get_64();
+		int64_t image_size = 0;
+		if (format >= 0 && format < Image::FORMAT_MAX && width == region_size && height == region_size) {
+			image_size = Util::get_image_data_size(width, height, format, mipmaps);
+		}
+		// Uniform maps store a single texel
+		int64_t expected_size = uniform ? Util::get_format_pixel_size(format) : image_size;
+		if (image_size == 0 || int64_t(size) != expected_size || size > file->get_length() - file->get_position()) {
+			LOG(ERROR, "Region file map ", i, " is corrupt: ", p_path);
+			return ERR_FILE_CORRUPT;
+		}
+		PackedByteArray data = file->get_buffer(int64_t(size));
+		if (uniform) {
+			// Repeats the texel over the base level and mipmaps
+			Ref<Image> img = Image::create(width, height, mipmaps, format);
+			PackedByteArray texel = data;
+			data = img->get_data();
+			uint8_t *dst = data.ptrw();
+			for (int64_t b = 0; b < data.size(); b++) {
+				dst[b] = texel[b % texel.size()];
+			}
+		}
+		Ref<Image> img = Image::create_from_data(width, height, mipmaps, format, data);
+		if (img.is_null() || img->is_empty()) {
+			LOG(ERROR, "Region file map ", i, " is corrupt: ", p_path);
+			return ERR_FILE_CORRUPT;
+		}
+		maps.push_back(img);
+	}
+	if (file->get_error() != OK && file->get_error() != ERR_FILE_EOF) {
+		LOG(ERROR, "Error reading region file: ", p_path);
+		return ERR_FILE_CORRUPT;
+	}
+	r_maps = maps;
+	if (r_offset) {
+		*r_offset = offset;
+	}
+	return OK;
+}
+
+// Writes to a temporary file first, so readers see either the previous or the new index
+Error RegionFile::save_index(const String &p_directory, const TypedArray<Vector2i> &p_offsets) {
+	String path = p_directory.path_join(INDEX_FILE_NAME);
+	String tmp_path = path + ".tmp";
+	Ref<FileAccess> file = FileAccess::open(tmp_path, FileAccess::WRITE);
+	if (file.is_null()) {
+		LOG(ERROR, "Cannot open file for writing: ", tmp_path);
+		return FileAccess::get_open_error();
+	}
+	file->store_buffer(String("T3DI").to_ascii_buffer());
+	file->store_32(VERSION);
+	file->store_32(uint32_t(p_offsets.size()));
+	for (int i = 0; i < p_offsets.size(); i++) {
+		Vector2i offset = p_offsets[i];
+		file->store_32(uint32_t(offset.x));
+		file->store_32(uint32_t(offset.y));
+	}
+	Error err = file->get_error();
+	file.unref(); // Close before renaming
+	if (err != OK) {
+		LOG(ERROR, "Error writing region index: ", tmp_path);
+		DirAccess::remove_absolute(tmp_path);
+		return err;
+	}
+	return DirAccess::rename_absolute(tmp_path, path);
+}
+
+// Returns ERR_FILE_NOT_FOUND if the directory has no index
+Error RegionFile::load_index(const String &p_directory, TypedArray<Vector2i> &r_offsets) {
+	String path = p_directory.path_join(INDEX_FILE_NAME);
+	if (!FileAccess::file_exists(path)) {
+		return ERR_FILE_NOT_FOUND;
+	}
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ);
+	if (file.is_null()) {
+		LOG(ERROR, "Cannot open region index: ", path);
+		return FileAccess::get_open_error();
+	}
+	if (file->get_buffer(4).get_string_from_ascii() != "T3DI") {
+		LOG(ERROR, "Not a region index: ", path);
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	uint32_t version = file->get_32();
+	if (version > VERSION) {
+		LOG(ERROR, "Region index version ", version, " is newer than supported version ", VERSION, ": ", path);
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	uint32_t count = file->get_32();
+	if (uint64_t(count) * 8 > file->get_length() - file->get_position()) {
+		LOG(ERROR, "Region index is truncated: ", path);
+		return ERR_FILE_CORRUPT;
+	}
+	TypedArray<Vector2i> offsets;
+	for (uint32_t i = 0; i < count; i++) {
+		offsets.push_back(Vector2i(int32_t(file->get_32()), int32_t(file->get_32())));
+	}
+	r_offsets = offsets;
+	return OK;
+}
@@ -0,0 +1,43 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#ifndef REGIONFILE_CLASS_H
+#define REGIONFILE_CLASS_H
+
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+
+#include "constants.h"
+
+using namespace godot;
+
+/**
+ * Reads and writes the maps of a single region as its own file, for region streaming.
+ * The file is a small header followed by the raw Image data of each map type:
+ *	char[4] magic "T3DR", uint32 version, int32 offset x, int32 offset y, uint32 region size,
+ *	uint32 map count, then per map: uint32 format, uint32 width, uint32 height,
+ *	uint32 flags (bit 0: has mipmaps, bit 1: uniform), uint64 data size, data.
+ * Uniform maps, where every texel is identical, store only that texel as their data.
+ * Loading only touches the file and new Images, so it is safe to run on a worker thread.
+ * A directory may also hold an index listing the regions saved to it. It is replaced atomically
+ * after the region files are written, so regions removed since are hidden even if their files
+ * remain. Its format: char[4] magic "T3DI", uint32 version, uint32 count, then int32 x, y pairs.
+ */
+class RegionFile {
+	CLASS_NAME_STATIC("Terrain3DRegionFile");
+
+public:
+	static inline const char *EXTENSION = "t3dr";
+	static inline const uint32_t VERSION = 2;
+	static inline const uint32_t FLAG_MIPMAPS = 1;
+	static inline const uint32_t FLAG_UNIFORM = 2;
+	static inline const char *INDEX_FILE_NAME = "region_index.t3di";
+
+	static String get_file_name(Vector2i p_offset);
+	static bool parse_file_name(const String &p_file_name, Vector2i &r_offset);
+	static Error save(const String &p_path, Vector2i p_offset, int p_region_size, const TypedArray<Image> &p_maps);
+	static Error load(const String &p_path, int p_region_size, TypedArray<Image> &r_maps, Vector2i *r_offset = nullptr);
+	static Error save_index(const String &p_directory, const TypedArray<Vector2i> &p_offsets);
+	static Error load_index(const String &p_directory, TypedArray<Vector2i> &r_offsets);
+};
+
+#endif // REGIONFILE_CLASS_H
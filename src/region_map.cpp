@@ -0,0 +1,91 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#include <godot_cpp/classes/rendering_device.hpp>
+#include <godot_cpp/classes/rendering_server.hpp>
+
+#include "logger.h"
+#include "region_map.h"
+
+///////////////////////////
+// Public Functions
+///////////////////////////
+
+void RegionMap::build(const TypedArray<Vector2i> &p_offsets) {
+	_count = p_offsets.size();
+	uint32_t capacity = 16;
+	while (capacity < uint32_t(_count) * 2) {
+		capacity <<= 1;
+	}
+	_mask = capacity - 1;
+	_slots.resize(capacity);
+	_bounds = Rect2i();
+
+	Slot *slots = _slots.ptrw();
+	for (uint32_t i = 0; i < capacity; i++) {
+		slots[i] = Slot();
+	}
+	for (int r = 0; r < _count; r++) {
+		Vector2i offset = p_offsets[r];
+		if (r == 0) {
+			_bounds = Rect2i(offset, Vector2i(1, 1));
+		} else {
+			_bounds = _bounds.expand(offset).expand(offset + Vector2i(1, 1));
+		}
+		uint32_t i = _hash(offset) & _mask;
+		while (slots[i].index >= 0 && slots[i].offset != offset) {
+			i = (i + 1) & _mask;
+		}
+		// Duplicate offsets resolve to the last index, as the old dense grid did
+		slots[i].offset = offset;
+		slots[i].index = r;
+	}
+	LOG(DEBUG_CONT, "Built region map with ", _count, " regions in ", capacity, " slots, bounds: ", _bounds);
+}
+
+void RegionMap::clear() {
+	_slots.clear();
+	_mask = 0;
+	_count = 0;
+	_bounds = Rect2i();
+}
+
+/**
+ * Returns an image covering the region bounds for the shader. FORMAT_RF, where each pixel is
+ * the region index + 1, or 0 if there is no region. Pixel (0, 0) is at get_bounds().position.
+ */
+Ref<Image> RegionMap::get_image() const {
+	int max_size = get_max_size();
+	Vector2i size = Vector2i(CLAMP(_bounds.size.x, 1, max_size), CLAMP(_bounds.size.y, 1, max_size));
+	if (!fits(_bounds)) {
+		LOG(ERROR, "Regions span ", _bounds.size, " which exceeds the maximum region map size of ", max_size,
+				". Regions outside of it will not render");
+	}
+	Ref<Image> img = Image::create(size.x, size.y, false, Image::FORMAT_RF);
+	Rect2i rect = Rect2i(Vector2i(), size);
+	const Slot *slots = _slots.ptr();
+	for (int i = 0; i < _slots.size(); i++) {
+		Vector2i pos = slots[i].offset - _bounds.position;
+		if (slots[i].index >= 0 && rect.has_point(pos)) {
+			img->set_pixelv(pos, Color(real_t(slots[i].index + 1), 0.f, 0.f, 1.f));
+		}
+	}
+	return img;
+}
+
+/**
+ * Returns the span of region offsets allowed on either axis: MAX_SPAN, or the largest 2D texture
+ * size the GPU supports if smaller. The compatibility renderer has no RenderingDevice, so only
+ * MAX_SPAN applies. Computed once by a function-local static, whose initialization is thread safe.
+ */
+int RegionMap::get_max_size() {
+	static const int max_size = []() {
+		int size = MAX_SPAN;
+		RenderingDevice *rd = RenderingServer::get_singleton()->get_rendering_device();
+		if (rd) {
+			size = MIN(size, int(rd->limit_get(RenderingDevice::LIMIT_MAX_TEXTURE_SIZE_2D)));
+		}
+		LOG(DEBUG, "Maximum region map size: ", size);
+		return size;
+	}();
+	return max_size;
+}
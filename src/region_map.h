@@ -0,0 +1,80 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#ifndef REGIONMAP_CLASS_H
+#define REGIONMAP_CLASS_H
+
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/templates/vector.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+
+#include "constants.h"
+
+using namespace godot;
+
+/**
+ * Sparse map from region offset (region grid coordinate) to region index.
+ * Open addressing hash table with linear probing, kept at or below 50% load, so lookups
+ * are O(1) regardless of world size or the number of regions.
+ * It is rebuilt from the region offsets array whenever regions are added or removed.
+ */
+class RegionMap {
+	CLASS_NAME_STATIC("Terrain3DRegionMap");
+
+	struct Slot {
+		Vector2i offset;
+		int32_t index = -1; // -1 is an empty slot
+	};
+
+	Vector<Slot> _slots;
+	uint32_t _mask = 0;
+	int _count = 0;
+	Rect2i _bounds; // Extent of all region offsets
+
+	static inline uint32_t _hash(Vector2i p_offset);
+
+public:
+	// The region map image is dense over the bounds, so its span is capped to keep it at 16 MiB
+	static inline const int MAX_SPAN = 2048;
+
+
+	void build(const TypedArray<Vector2i> &p_offsets);
+	void clear();
+	int get(Vector2i p_offset) const;
+	int size() const { return _count; }
+	Rect2i get_bounds() const { return _bounds; }
+	Ref<Image> get_image() const;
+
+	static int get_max_size();
+	static bool fits(const Rect2i &p_bounds);
+};
+
+// Inline Functions
+
+inline uint32_t RegionMap::_hash(Vector2i p_offset) {
+	uint32_t h = uint32_t(p_offset.x) * 0x9E3779B1u ^ uint32_t(p_offset.y) * 0x85EBCA77u;
+	return h ^ (h >> 15);
+}
+
+// Returns true if a region map image covering p_bounds is within the span limit
+inline bool RegionMap::fits(const Rect2i &p_bounds) {
+	int max_size = get_max_size();
+	return p_bounds.size.x <= max_size && p_bounds.size.y <= max_size;
+}
+
+// Returns the region index at the region offset, or -1
+inline int RegionMap::get(Vector2i p_offset) const {
+	if (_count == 0) {
+		return -1;
+	}
+	const Slot *slots = _slots.ptr();
+	uint32_t i = _hash(p_offset) & _mask;
+	while (slots[i].index >= 0) {
+		if (slots[i].offset == p_offset) {
+			return slots[i].index;
+		}
+		i = (i + 1) & _mask;
+	}
+	return -1;
+}
+
+#endif // REGIONMAP_CLASS_H
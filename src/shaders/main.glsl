@@ -26,9 +26,8 @@ uniform float _region_size = 1024.0;
 uniform float _region_texel_size = 0.0009765625; // = 1/1024
 uniform float _mesh_vertex_spacing = 1.0;
 uniform float _mesh_vertex_density = 1.0; // = 1/_mesh_vertex_spacing
-uniform int _region_map_size = 16;
-uniform int _region_map[256];
-uniform vec2 _region_offsets[256];
+uniform sampler2D _region_map : hint_default_black, filter_nearest, repeat_disable; // Region index + 1, 0 = none
+uniform ivec2 _region_map_origin = ivec2(0); // Region offset of texel (0,0) in _region_map
 uniform sampler2DArray _height_maps : repeat_disable;
 uniform usampler2DArray _control_maps : repeat_disable;
 //INSERT: TEXTURE_SAMPLERS_NEAREST
@@ -77,15 +76,24 @@ varying float v_region_border_mask;
 // Vertex
 ////////////////////////
 
+// Takes in a region offset, returns the layer index used for texturearrays, -1 if not in a region
+int get_region_index(ivec2 pos) {
+	pos -= _region_map_origin;
+	ivec2 size = textureSize(_region_map, 0);
+	if (pos.x < 0 || pos.y < 0 || pos.x >= size.x || pos.y >= size.y) {
+		return -1;
+	}
+	return int(texelFetch(_region_map, pos, 0).r) - 1;
+}
+
 // Takes in UV world space coordinates, returns ivec3 with:
 // XY: (0 to _region_size) coordinates within a region
 // Z: layer index used for texturearrays, -1 if not in a region
 ivec3 get_region_uv(vec2 uv) {
 	uv *= _region_texel_size;
-	ivec2 pos = ivec2(floor(uv)) + (_region_map_size / 2);
-	int bounds = int(pos.x>=0 && pos.x<_region_map_size && pos.y>=0 && pos.y<_region_map_size);
-	int layer_index = _region_map[ pos.y * _region_map_size + pos.x ] * bounds - 1;
-	return ivec3(ivec2((uv - _region_offsets[layer_index]) * _region_size), layer_index);
+	ivec2 pos = ivec2(floor(uv));
+	int layer_index = get_region_index(pos);
+	return ivec3(ivec2((uv - vec2(pos)) * _region_size), layer_index);
 }
 
 // Takes in UV2 region space coordinates, returns vec3 with:
@@ -95,11 +103,10 @@ vec3 get_region_uv2(vec2 uv) {
 	// Vertex function added half a texel to UV2, to center the UV's.  vertex(), fragment() and get_height()
 	// call this with reclaimed versions of UV2, so to keep the last row/column within the correct
 	// window, take back the half pixel before the floor(). 
-	ivec2 pos = ivec2(floor(uv - vec2(_region_texel_size * 0.5))) + (_region_map_size / 2);
-	int bounds = int(pos.x>=0 && pos.x<_region_map_size && pos.y>=0 && pos.y<_region_map_size);
-	int layer_index = _region_map[ pos.y * _region_map_size + pos.x ] * bounds - 1;
+	ivec2 pos = ivec2(floor(uv - vec2(_region_texel_size * 0.5)));
+	int layer_index = get_region_index(pos);
 	// The return value is still texel-centered.
-	return vec3(uv - _region_offsets[layer_index], float(layer_index));
+	return vec3(uv - vec2(pos), float(layer_index));
 }
 
 //INSERT: WORLD_NOISE1
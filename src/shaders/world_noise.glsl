@@ -6,6 +6,8 @@ R"(
 // World Noise
 
 uniform sampler2D _region_blend_map : hint_default_black, filter_linear, repeat_disable;
+uniform vec2 _region_blend_map_origin = vec2(-8.0); // Region space position of the blend map
+uniform vec2 _region_blend_map_size = vec2(16.0); // Size in regions
 uniform int world_noise_max_octaves : hint_range(0, 15) = 4;
 uniform int world_noise_min_octaves : hint_range(0, 15) = 2;
 uniform float world_noise_lod_distance : hint_range(0, 40000, 1) = 7500.;
@@ -71,18 +73,8 @@ float world_noise(vec2 p) {
 //INSERT: WORLD_NOISE2
 	// World Noise
    	if(_background_mode == 2u) {
-	    float weight = texture(_region_blend_map, (uv/float(_region_map_size))+0.5).r;
-	    float rmap_half_size = float(_region_map_size)*.5;
-	    if(abs(uv.x) > rmap_half_size+.5 || abs(uv.y) > rmap_half_size+.5) {
-		    weight = 0.;
-	    } else {
-		    if(abs(uv.x) > rmap_half_size-.5) {
-			    weight = mix(weight, 0., abs(uv.x) - (rmap_half_size-.5));
-		    }
-		    if(abs(uv.y) > rmap_half_size-.5) {
-			    weight = mix(weight, 0., abs(uv.y) - (rmap_half_size-.5));
-		    }
-	    }
+	    // The blend map has an empty border, so clamping to its edge fades to 0 outside
+	    float weight = texture(_region_blend_map, (uv - _region_blend_map_origin) / _region_blend_map_size).r;
 	    height = mix(height, world_noise((uv+world_noise_offset.xz) * world_noise_scale*.1) *
             world_noise_height*10. + world_noise_offset.y*100.,
 		    clamp(smoothstep(world_noise_blend_near, world_noise_blend_far, 1.0 - weight), 0.0, 1.0));
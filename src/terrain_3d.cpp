@@ -58,6 +58,10 @@ void Terrain3D::_initialize() {
 		LOG(DEBUG, "Connecting region_size_changed signal to _material->_set_region_size()");
 		_storage->connect("region_size_changed", callable_mp(_material.ptr(), &Terrain3DMaterial::_set_region_size));
 	}
+	if (!_storage->is_connected("region_size_changed", callable_mp(this, &Terrain3D::_update_region_size))) {
+		LOG(DEBUG, "Connecting region_size_changed signal to _update_region_size()");
+		_storage->connect("region_size_changed", callable_mp(this, &Terrain3D::_update_region_size));
+	}
 	if (!_storage->is_connected("regions_changed", callable_mp(_material.ptr(), &Terrain3DMaterial::_update_regions))) {
 		LOG(DEBUG, "Connecting regions_changed signal to _material->_update_regions()");
 		_storage->connect("regions_changed", callable_mp(_material.ptr(), &Terrain3DMaterial::_update_regions));
@@ -108,6 +112,13 @@ void Terrain3D::__process(double delta) {
 			snap(cam_pos);
 			_camera_last_position = cam_pos_2d;
 		}
+
+		// Stream regions around the camera. Collision shapes are per region, so rebuild them
+		if (_storage->get_streaming_enabled() && _storage->update_streaming(cam_pos)) {
+			if (_static_body.is_valid() || _debug_static_body != nullptr) {
+				_build_collision();
+			}
+		}
 	}
 }
 
@@ -371,24 +382,28 @@ void Terrain3D::_update_collision() {
 		Vector2i global_offset = Vector2i(_storage->get_region_offsets()[i]) * region_size;
 		Vector3 global_pos = Vector3(global_offset.x, 0.f, global_offset.y);
 
+		// Decode holes for the shape, including the edge shared with adjacent regions
+		int hole_stride = (shape_size + 7) / 8;
+		PackedByteArray holes;
+		holes.resize(hole_stride * shape_size);
+		ControlLanes lanes;
+		lanes.hole = holes.ptrw();
+		_storage->decode_control_rect_px(Rect2i(global_offset, Vector2i(shape_size, shape_size)), lanes);
+		const uint8_t *holes_ptr = holes.ptr();
+
 		Ref<Image> map, map_x, map_z, map_xz;
-		Ref<Image> cmap, cmap_x, cmap_z, cmap_xz;
 		map = _storage->get_map_region(Terrain3DStorage::TYPE_HEIGHT, i);
-		cmap = _storage->get_map_region(Terrain3DStorage::TYPE_CONTROL, i);
 		int region = _storage->get_region_index(Vector3(global_pos.x + region_size, 0.f, global_pos.z) * _mesh_vertex_spacing);
 		if (region >= 0) {
 			map_x = _storage->get_map_region(Terrain3DStorage::TYPE_HEIGHT, region);
-			cmap_x = _storage->get_map_region(Terrain3DStorage::TYPE_CONTROL, region);
 		}
 		region = _storage->get_region_index(Vector3(global_pos.x, 0.f, global_pos.z + region_size) * _mesh_vertex_spacing);
 		if (region >= 0) {
 			map_z = _storage->get_map_region(Terrain3DStorage::TYPE_HEIGHT, region);
-			cmap_z = _storage->get_map_region(Terrain3DStorage::TYPE_CONTROL, region);
 		}
 		region = _storage->get_region_index(Vector3(global_pos.x + region_size, 0.f, global_pos.z + region_size) * _mesh_vertex_spacing);
 		if (region >= 0) {
 			map_xz = _storage->get_map_region(Terrain3DStorage::TYPE_HEIGHT, region);
-			cmap_xz = _storage->get_map_region(Terrain3DStorage::TYPE_CONTROL, region);
 		}
 
 		for (int z = 0; z < shape_size; z++) {
@@ -399,25 +414,26 @@ void Terrain3D::_update_collision() {
 				// int index = z * shape_size + x;
 				// Array Index Rotated Y=-90 - must rotate shape Y=+90 (xform below)
 				int index = shape_size - 1 - z + x * shape_size;
+				bool hole = get_mask_bit(holes_ptr + z * hole_stride, x);
 
 				// Set heights on local map, or adjacent maps if on the last row/col
 				if (x < region_size && z < region_size) {
-					map_data[index] = (is_hole(cmap->get_pixel(x, z).r)) ? hole_const : map->get_pixel(x, z).r;
+					map_data[index] = hole ? hole_const : map->get_pixel(x, z).r;
 				} else if (x == region_size && z < region_size) {
 					if (map_x.is_valid()) {
-						map_data[index] = (is_hole(cmap_x->get_pixel(0, z).r)) ? hole_const : map_x->get_pixel(0, z).r;
+						map_data[index] = hole ? hole_const : map_x->get_pixel(0, z).r;
 					} else {
 						map_data[index] = 0.0f;
 					}
 				} else if (z == region_size && x < region_size) {
 					if (map_z.is_valid()) {
-						map_data[index] = (is_hole(cmap_z->get_pixel(x, 0).r)) ? hole_const : map_z->get_pixel(x, 0).r;
+						map_data[index] = hole ? hole_const : map_z->get_pixel(x, 0).r;
 					} else {
 						map_data[index] = 0.0f;
 					}
 				} else if (x == region_size && z == region_size) {
 					if (map_xz.is_valid()) {
-						map_data[index] = (is_hole(cmap_xz->get_pixel(0, 0).r)) ? hole_const : map_xz->get_pixel(0, 0).r;
+						map_data[index] = hole ? hole_const : map_xz->get_pixel(0, 0).r;
 					} else {
 						map_data[index] = 0.0f;
 					}
@@ -469,6 +485,14 @@ void Terrain3D::_update_collision() {
 	LOG(DEBUG, "Collision creation time: ", Time::get_singleton()->get_ticks_msec() - time, " ms");
 }
 
+// Collision shapes are one per region, so they must be rebuilt if regions are re-sliced
+void Terrain3D::_update_region_size(int p_size) {
+	LOG(INFO, "Region size changed to ", p_size);
+	if (_initialized && (_static_body.is_valid() || _debug_static_body != nullptr)) {
+		_build_collision();
+	}
+}
+
 void Terrain3D::_destroy_collision() {
 	if (_static_body.is_valid()) {
 		LOG(INFO, "Freeing physics body");
@@ -548,6 +572,21 @@ void Terrain3D::_generate_triangles(PackedVector3Array &p_vertices, PackedVector
 	ERR_FAIL_COND(!_storage.is_valid());
 	int32_t step = 1 << CLAMP(p_lod, 0, 8);
 
+	// Nav bits are decoded in bulk, for the rows of one strip of triangle pairs at a time
+	PackedByteArray nav_mask;
+	Rect2i nav_rect;
+	auto decode_nav = [&](int32_t p_x_start, int32_t p_x_end, int32_t p_z) {
+		if (!p_require_nav) {
+			return;
+		}
+		nav_rect = Rect2i(p_x_start, p_z, p_x_end - p_x_start + step, step + 1);
+		nav_mask.resize((nav_rect.size.x + 7) / 8 * nav_rect.size.y);
+		ControlLanes lanes;
+		lanes.nav = nav_mask.ptrw();
+		_storage->decode_control_rect_px(nav_rect, lanes);
+	};
+	const uint8_t *nav_ptr = nullptr;
+
 	if (!p_global_aabb.has_volume()) {
 		int32_t region_size = (int)_storage->get_region_size();
 
@@ -556,8 +595,10 @@ void Terrain3D::_generate_triangles(PackedVector3Array &p_vertices, PackedVector
 			Vector2i region_offset = (Vector2i)region_offsets[r] * region_size;
 
 			for (int32_t z = region_offset.y; z < region_offset.y + region_size; z += step) {
+				decode_nav(region_offset.x, region_offset.x + region_size, z);
+				nav_ptr = p_require_nav ? nav_mask.ptr() : nullptr;
 				for (int32_t x = region_offset.x; x < region_offset.x + region_size; x += step) {
-					_generate_triangle_pair(p_vertices, p_uvs, p_lod, p_filter, p_require_nav, x, z);
+					_generate_triangle_pair(p_vertices, p_uvs, p_lod, p_filter, nav_ptr, nav_rect, x, z);
 				}
 			}
 		}
@@ -568,28 +609,33 @@ void Terrain3D::_generate_triangles(PackedVector3Array &p_vertices, PackedVector
 		int32_t x_end = (int32_t)Math::floor(p_global_aabb.get_end().x / _mesh_vertex_spacing) + 1;
 
 		for (int32_t z = z_start; z < z_end; ++z) {
+			decode_nav(x_start, x_end, z);
+			nav_ptr = p_require_nav ? nav_mask.ptr() : nullptr;
 			for (int32_t x = x_start; x < x_end; ++x) {
 				real_t height = _storage->get_height(Vector3(x, 0.f, z));
 				if (height >= p_global_aabb.position.y && height <= p_global_aabb.get_end().y) {
-					_generate_triangle_pair(p_vertices, p_uvs, p_lod, p_filter, p_require_nav, x, z);
+					_generate_triangle_pair(p_vertices, p_uvs, p_lod, p_filter, nav_ptr, nav_rect, x, z);
 				}
 			}
 		}
 	}
 }
 
-void Terrain3D::_generate_triangle_pair(PackedVector3Array &p_vertices, PackedVector2Array *p_uvs, int32_t p_lod, Terrain3DStorage::HeightFilter p_filter, bool p_require_nav, int32_t x, int32_t z) const {
+// If p_nav_mask is set, triangles are only generated where all vertices have the nav bit set.
+// It holds the nav bits of p_nav_rect, as decoded by Terrain3DStorage::decode_control_rect_px()
+void Terrain3D::_generate_triangle_pair(PackedVector3Array &p_vertices, PackedVector2Array *p_uvs, int32_t p_lod, Terrain3DStorage::HeightFilter p_filter, const uint8_t *p_nav_mask, Rect2i p_nav_rect, int32_t x, int32_t z) const {
 	int32_t step = 1 << CLAMP(p_lod, 0, 8);
+	int nav_stride = (p_nav_rect.size.x + 7) / 8;
+	auto is_nav_px = [&](int32_t p_x, int32_t p_z) {
+		return get_mask_bit(p_nav_mask + (p_z - p_nav_rect.position.y) * nav_stride, p_x - p_nav_rect.position.x);
+	};
 
 	Vector3 xz = Vector3(x, 0.0f, z) * _mesh_vertex_spacing;
 	Vector3 xsz = Vector3(x + step, 0.0f, z) * _mesh_vertex_spacing;
 	Vector3 xzs = Vector3(x, 0.0f, z + step) * _mesh_vertex_spacing;
 	Vector3 xszs = Vector3(x + step, 0.0f, z + step) * _mesh_vertex_spacing;
 
-	uint32_t control1 = _storage->get_control(xz);
-	uint32_t control2 = _storage->get_control(xszs);
-	uint32_t control3 = _storage->get_control(xzs);
-	if (!p_require_nav || (is_nav(control1) && is_nav(control2) && is_nav(control3))) {
+	if (!p_nav_mask || (is_nav_px(x, z) && is_nav_px(x + step, z + step) && is_nav_px(x, z + step))) {
 		Vector3 v1 = _storage->get_mesh_vertex(p_lod, p_filter, xz);
 		Vector3 v2 = _storage->get_mesh_vertex(p_lod, p_filter, xszs);
 		Vector3 v3 = _storage->get_mesh_vertex(p_lod, p_filter, xzs);
@@ -605,10 +651,7 @@ void Terrain3D::_generate_triangle_pair(PackedVector3Array &p_vertices, PackedVe
 		}
 	}
 
-	control1 = _storage->get_control(xz);
-	control2 = _storage->get_control(xsz);
-	control3 = _storage->get_control(xszs);
-	if (!p_require_nav || (is_nav(control1) && is_nav(control2) && is_nav(control3))) {
+	if (!p_nav_mask || (is_nav_px(x, z) && is_nav_px(x + step, z) && is_nav_px(x + step, z + step))) {
 		Vector3 v1 = _storage->get_mesh_vertex(p_lod, p_filter, xz);
 		Vector3 v2 = _storage->get_mesh_vertex(p_lod, p_filter, xsz);
 		Vector3 v3 = _storage->get_mesh_vertex(p_lod, p_filter, xszs);
@@ -683,6 +726,7 @@ void Terrain3D::set_mesh_vertex_spacing(real_t p_spacing) {
 		LOG(INFO, "Setting mesh vertex spacing: ", p_spacing);
 		_mesh_vertex_spacing = p_spacing;
 		if (_storage != nullptr) {
+			Terrain3DStorage::WriteLock lock = _storage->write_lock();
 			_storage->_mesh_vertex_spacing = p_spacing;
 		}
 		_clear();
@@ -941,6 +985,36 @@ void Terrain3D::update_aabbs() {
  * Returns vec3(Double max 3.402823466e+38F) on no intersection. Test w/ if (var.x < 3.4e38)
  */
 Vector3 Terrain3D::get_intersection(Vector3 p_src_pos, Vector3 p_direction) {
+	Vector3 miss = Vector3(__FLT_MAX__, __FLT_MAX__, __FLT_MAX__);
+	if (_storage.is_null()) {
+		LOG(ERROR, "Invalid storage");
+		return Vector3(NAN, NAN, NAN);
+	}
+	p_direction.normalize();
+
+	// Regions are raycast on the CPU, which needs no camera or rendered frame
+	Vector3 point = _storage->raycast(p_src_pos, p_direction);
+	if (point.x != __FLT_MAX__) {
+		return point;
+	}
+
+	// Outside of regions, intersect the world background
+	Terrain3DMaterial::WorldBackground background = _material.is_valid() ? _material->get_world_background() : Terrain3DMaterial::FLAT;
+	if (background == Terrain3DMaterial::NONE) {
+		return miss;
+	} else if (background == Terrain3DMaterial::FLAT) {
+		if (Math::abs(p_direction.y) < CMP_EPSILON) {
+			return miss;
+		}
+		real_t t = -p_src_pos.y / p_direction.y;
+		if (t < 0.f) {
+			return miss;
+		}
+		point = p_src_pos + p_direction * t;
+		return (_storage->get_region_index(point) < 0) ? point : miss;
+	}
+
+	// Noise is only generated in the shader, so read it back from the GPU depth
 	if (_camera == nullptr) {
 		LOG(ERROR, "Invalid camera");
 		return Vector3(NAN, NAN, NAN);
@@ -949,9 +1023,6 @@ Vector3 Terrain3D::get_intersection(Vector3 p_src_pos, Vector3 p_direction) {
 		LOG(ERROR, "Invalid mouse camera");
 		return Vector3(NAN, NAN, NAN);
 	}
-	p_direction.normalize();
-
-	Vector3 point;
 
 	// Position mouse cam one unit behind the requested position
 	_mouse_cam->set_global_position(p_src_pos - p_direction);
@@ -967,6 +1038,9 @@ Vector3 Terrain3D::get_intersection(Vector3 p_src_pos, Vector3 p_direction) {
 		_mouse_vp->set_update_mode(SubViewport::UPDATE_ONCE);
 		Ref<ViewportTexture> vp_tex = _mouse_vp->get_texture();
 		Ref<Image> vp_img = vp_tex->get_image();
+		if (vp_img.is_null()) {
+			return miss;
+		}
 
 		// Read the depth pixel from the camera viewport
 		// DEPRECATED - remove srgb_to_linear and use HDR viewport for Godot 4.2 +
@@ -978,7 +1052,7 @@ Vector3 Terrain3D::get_intersection(Vector3 p_src_pos, Vector3 p_direction) {
 		Vector2 screen_rg = Vector2(screen_depth.r, screen_depth.g);
 		real_t normalized_distance = screen_rg.dot(Vector2(1.f, 1.f / 255.f));
 		if (normalized_distance < 0.00001f) {
-			return Vector3(__FLT_MAX__, __FLT_MAX__, __FLT_MAX__);
+			return miss;
 		}
 		// Necessary for a correct value depth = 1
 		if (normalized_distance > 0.9999f) {
@@ -1124,7 +1198,8 @@ void Terrain3D::_notification(int p_what) {
 			if (!_storage.is_valid()) {
 				LOG(DEBUG, "Save requested, but no valid storage. Skipping");
 			} else {
-				_storage->save();
+				// Written in the background, so editing can continue
+				_storage->save(true);
 			}
 			if (!_material.is_valid()) {
 				LOG(DEBUG, "Save requested, but no valid material. Skipping");
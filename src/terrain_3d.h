@@ -88,11 +88,12 @@ class Terrain3D : public Node3D {
 	void _build_collision();
 	void _update_collision();
 	void _destroy_collision();
+	void _update_region_size(int p_size);
 
 	void _update_instances();
 
 	void _generate_triangles(PackedVector3Array &p_vertices, PackedVector2Array *p_uvs, int32_t p_lod, Terrain3DStorage::HeightFilter p_filter, bool require_nav, AABB const &p_global_aabb) const;
-	void _generate_triangle_pair(PackedVector3Array &p_vertices, PackedVector2Array *p_uvs, int32_t p_lod, Terrain3DStorage::HeightFilter p_filter, bool require_nav, int32_t x, int32_t z) const;
+	void _generate_triangle_pair(PackedVector3Array &p_vertices, PackedVector2Array *p_uvs, int32_t p_lod, Terrain3DStorage::HeightFilter p_filter, const uint8_t *p_nav_mask, Rect2i p_nav_rect, int32_t x, int32_t z) const;
 
 public:
 	static int debug_level;
@@ -1,6 +1,9 @@
 // Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
 
+#include <godot_cpp/classes/dir_access.hpp>
 #include <godot_cpp/classes/editor_undo_redo_manager.hpp>
+#include <godot_cpp/classes/os.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 #include <godot_cpp/core/class_db.hpp>
 
 #include "logger.h"
@@ -65,15 +68,25 @@ void Terrain3DEditor::_operate_region(Vector3 p_global_position) {
 
 	if (_operation == ADD) {
 		if (!has_region) {
-			_terrain->get_storage()->add_region(p_global_position);
-			modified = true;
+			Error err = _terrain->get_storage()->add_region(p_global_position);
+			if (err == OK) {
+				_undo_added_regions.push_back(_terrain->get_storage()->get_region_offset(p_global_position));
+				modified = true;
+			}
 		}
 	}
 	if (_operation == SUBTRACT) {
 		if (has_region) {
 			int region_index = _terrain->get_storage()->get_region_index(p_global_position);
-			Ref<Image> height_map = _terrain->get_storage()->get_map_region(Terrain3DStorage::TYPE_HEIGHT, region_index);
-			height_range = Util::get_min_max(height_map);
+			height_range = _terrain->get_storage()->get_region_height_range(region_index);
+
+			// Keep the removed maps for undo. The storage drops its references, so no copy is needed
+			TypedArray<Image> maps;
+			for (int i = 0; i < Terrain3DStorage::TYPE_MAX; i++) {
+				maps.push_back(_terrain->get_storage()->get_map_region(static_cast<Terrain3DStorage::MapType>(i), region_index));
+			}
+			_undo_removed_regions.push_back(_terrain->get_storage()->get_region_offset(p_global_position));
+			_undo_removed_maps.push_back(maps);
 
 			_terrain->get_storage()->remove_region(p_global_position);
 			modified = true;
@@ -103,6 +116,7 @@ void Terrain3DEditor::_operate_map(Vector3 p_global_position, real_t p_camera_di
 				LOG(ERROR, "Failed to add region, no region to operate on");
 				return;
 			}
+			_undo_added_regions.push_back(storage->get_region_offset(p_global_position));
 			_region_modified(p_global_position);
 		}
 	}
@@ -129,6 +143,7 @@ void Terrain3DEditor::_operate_map(Vector3 p_global_position, real_t p_camera_di
 		default:
 			return;
 	}
+	_undo_map_type = map_type;
 
 	Ref<Image> map = storage->get_map_region(map_type, region_index);
 	int brush_size = _brush.get_size();
@@ -153,6 +168,7 @@ void Terrain3DEditor::_operate_map(Vector3 p_global_position, real_t p_camera_di
 	edited_area.position = p_global_position - Vector3(brush_size, 0.f, brush_size) / 2.f;
 	edited_area.size = Vector3(brush_size, 0.f, brush_size);
 
+	Vector<int> edited_regions; // Only these layers are uploaded to the GPU
 	real_t vertex_spacing = _terrain->get_mesh_vertex_spacing();
 	for (real_t x = 0.f; x < brush_size; x += vertex_spacing) {
 		for (real_t y = 0.f; y < brush_size; y += vertex_spacing) {
@@ -172,6 +188,7 @@ void Terrain3DEditor::_operate_map(Vector3 p_global_position, real_t p_camera_di
 					continue;
 				}
 				new_region_index = storage->get_region_index(brush_global_position);
+				_undo_added_regions.push_back(storage->get_region_offset(brush_global_position));
 				_region_modified(brush_global_position);
 			}
 
@@ -280,7 +297,6 @@ void Terrain3DEditor::_operate_map(Vector3 p_global_position, real_t p_camera_di
 							break;
 					}
 					dest = Color(destf, 0.f, 0.f, 1.f);
-					storage->update_heights(destf);
 
 					edited_position.y = destf;
 					edited_area = edited_area.expand(edited_position);
@@ -380,13 +396,24 @@ void Terrain3DEditor::_operate_map(Vector3 p_global_position, real_t p_camera_di
 					}
 				}
 
-				map->set_pixelv(map_pixel_position, dest);
+				_backup_tile(map, storage->get_region_offset(brush_global_position), map_pixel_position);
+				{
+					// Queries on other threads may be reading this map
+					Terrain3DStorage::WriteLock lock = storage->write_lock();
+					map->set_pixelv(map_pixel_position, dest);
+				}
+				if (!edited_regions.has(region_index)) {
+					edited_regions.push_back(region_index);
+				}
 			}
 		}
 	}
 	_modified = true;
-	storage->force_update_maps(map_type);
+	// Report the area first, so height pyramids are current when the maps update
 	storage->add_edited_area(edited_area);
+	for (int i = 0; i < edited_regions.size(); i++) {
+		storage->force_update_maps(map_type, edited_regions[i]);
+	}
 }
 
 bool Terrain3DEditor::_is_in_bounds(Vector2i p_position, Vector2i p_max_position) {
@@ -409,86 +436,188 @@ Vector2 Terrain3DEditor::_rotate_uv(Vector2 p_uv, real_t p_angle) {
 	return p_uv.clamp(Vector2(0.f, 0.f), Vector2(1.f, 1.f));
 }
 
-/* Stored in the _undo_set is:
- * 0-2: map 0,1,2
- * 3: Region offsets
- * 4: height range
- * 5: edited AABB
- */
+// Copies the tile holding p_pixel into the undo state, the first time the operation touches it
+void Terrain3DEditor::_backup_tile(const Ref<Image> &p_map, Vector2i p_region_offset, Vector2i p_pixel) {
+	Vector2i tile = p_pixel / UNDO_TILE_SIZE;
+	Vector3i key = Vector3i(p_region_offset.x, p_region_offset.y, (tile.y << 16) | tile.x);
+	if (_undo_tile_index.has(key)) {
+		return;
+	}
+	Rect2i rect = Rect2i(tile * UNDO_TILE_SIZE, Vector2i(UNDO_TILE_SIZE, UNDO_TILE_SIZE));
+	rect = rect.intersection(Rect2i(Vector2i(0, 0), p_map->get_size()));
+	_undo_tile_index[key] = _undo_tiles.size();
+	_undo_tile_regions.push_back(p_region_offset);
+	_undo_tile_positions.push_back(rect.position);
+	_undo_tiles.push_back(p_map->get_region(rect));
+}
+
+// Resets the undo state. Nothing is copied until the operation edits something
 void Terrain3DEditor::_setup_undo() {
 	ERR_FAIL_COND_MSG(_terrain == nullptr, "terrain is null, returning");
 	ERR_FAIL_COND_MSG(_terrain->get_plugin() == nullptr, "terrain->plugin is null, returning");
 	if (_tool < 0 || _tool >= TOOL_MAX) {
 		return;
 	}
-	LOG(INFO, "Setting up undo snapshot...");
-	_undo_set.clear();
-	_undo_set.resize(Terrain3DStorage::TYPE_MAX + 3);
-	for (int i = 0; i < Terrain3DStorage::TYPE_MAX; i++) {
-		_undo_set[i] = _terrain->get_storage()->get_maps_copy(static_cast<Terrain3DStorage::MapType>(i));
-		LOG(DEBUG, "maps ", i, "(", static_cast<TypedArray<Image>>(_undo_set[i]).size(), "): ", _undo_set[i]);
-	}
-	_undo_set[Terrain3DStorage::TYPE_MAX] = _terrain->get_storage()->get_region_offsets().duplicate();
-	LOG(DEBUG, "region_offsets(", static_cast<TypedArray<Vector2i>>(_undo_set[Terrain3DStorage::TYPE_MAX]).size(), "): ", _undo_set[Terrain3DStorage::TYPE_MAX]);
-	_undo_set[Terrain3DStorage::TYPE_MAX + 1] = _terrain->get_storage()->get_height_range();
-
-	_undo_set[Terrain3DStorage::TYPE_MAX + 2] = _terrain->get_storage()->get_edited_area();
+	LOG(INFO, "Setting up undo state...");
+	// Assign new arrays, as the previous ones are shared with the last undo action
+	_undo_map_type = Terrain3DStorage::TYPE_MAX;
+	_undo_height_range = _terrain->get_storage()->get_height_range();
+	_undo_tile_index = Dictionary();
+	_undo_tile_regions = TypedArray<Vector2i>();
+	_undo_tile_positions = TypedArray<Vector2i>();
+	_undo_tiles = TypedArray<Image>();
+	_undo_added_regions = TypedArray<Vector2i>();
+	_undo_removed_regions = TypedArray<Vector2i>();
+	_undo_removed_maps = Array();
 }
 
+// Creates the undo action from the tiles backed up during the operation, and their current state for redo
 void Terrain3DEditor::_store_undo() {
 	ERR_FAIL_COND_MSG(_terrain == nullptr, "terrain is null, returning");
 	ERR_FAIL_COND_MSG(_terrain->get_plugin() == nullptr, "terrain->plugin is null, returning");
 	if (_tool < 0 || _tool >= TOOL_MAX) {
 		return;
 	}
-	LOG(INFO, "Storing undo snapshot...");
-	EditorUndoRedoManager *undo_redo = _terrain->get_plugin()->get_undo_redo();
+	Ref<Terrain3DStorage> storage = _terrain->get_storage();
+	int region_size = storage->get_region_size();
+	real_t vertex_spacing = _terrain->get_mesh_vertex_spacing();
+	AABB edited_area = storage->get_edited_area();
+	LOG(INFO, "Storing undo for ", _undo_tiles.size(), " tiles, ", _undo_added_regions.size(), " added and ",
+			_undo_removed_regions.size(), " removed regions");
+
+	// Tiles of regions that no longer exist are dropped, so neither set holds null tiles
+	TypedArray<Vector2i> tile_regions;
+	TypedArray<Vector2i> tile_positions;
+	TypedArray<Image> undo_tiles;
+	TypedArray<Image> redo_tiles;
+	for (int i = 0; i < _undo_tiles.size(); i++) {
+		Vector2i region_offset = _undo_tile_regions[i];
+		Vector3 global_position = Vector3(region_offset.x + .5f, 0.f, region_offset.y + .5f) * real_t(region_size) * vertex_spacing;
+		int region_index = storage->get_region_index(global_position);
+		if (region_index == -1) {
+			continue;
+		}
+		Ref<Image> tile = _undo_tiles[i];
+		Vector2i position = _undo_tile_positions[i];
+		Ref<Image> map = storage->get_map_region(_undo_map_type, region_index);
+		tile_regions.push_back(region_offset);
+		tile_positions.push_back(position);
+		undo_tiles.push_back(tile);
+		redo_tiles.push_back(map->get_region(Rect2i(position, tile->get_size())));
+	}
+	Array blank_maps;
+	for (int i = 0; i < _undo_added_regions.size(); i++) {
+		blank_maps.push_back(TypedArray<Image>());
+	}
+
+	Array undo_set;
+	undo_set.resize(UNDO_MAX);
+	undo_set[UNDO_MAP_TYPE] = int(_undo_map_type);
+	undo_set[UNDO_REGION_SIZE] = region_size;
+	undo_set[UNDO_HEIGHT_RANGE] = _undo_height_range;
+	undo_set[UNDO_EDITED_AREA] = edited_area;
+	undo_set[UNDO_TILE_REGIONS] = tile_regions;
+	undo_set[UNDO_TILE_POSITIONS] = tile_positions;
+	undo_set[UNDO_TILES] = undo_tiles;
+	undo_set[UNDO_REMOVE_REGIONS] = _undo_added_regions;
+	undo_set[UNDO_ADD_REGIONS] = _undo_removed_regions;
+	undo_set[UNDO_ADD_MAPS] = _undo_removed_maps;
+	undo_set[UNDO_ID] = _undo_next_id;
+	undo_set[UNDO_REDO] = false;
+
+	Array redo_set = undo_set.duplicate();
+	redo_set[UNDO_HEIGHT_RANGE] = storage->get_height_range();
+	redo_set[UNDO_TILES] = redo_tiles;
+	redo_set[UNDO_REMOVE_REGIONS] = _undo_removed_regions;
+	redo_set[UNDO_ADD_REGIONS] = _undo_added_regions;
+	redo_set[UNDO_ADD_MAPS] = blank_maps;
+	redo_set[UNDO_REDO] = true;
+
+	UndoRecord record;
+	record.id = _undo_next_id++;
+	record.undo_set = undo_set;
+	record.redo_set = redo_set;
+	record.token.instantiate();
+	_undo_records.push_back(record);
 
+	EditorUndoRedoManager *undo_redo = _terrain->get_plugin()->get_undo_redo();
+	if (!undo_redo->is_connected("history_changed", callable_mp(this, &Terrain3DEditor::_prune_undo_records))) {
+		undo_redo->connect("history_changed", callable_mp(this, &Terrain3DEditor::_prune_undo_records));
+	}
 	String action_name = String("Terrain3D ") + OPNAME[_operation] + String(" ") + TOOLNAME[_tool];
 	LOG(DEBUG, "Creating undo action: '", action_name, "'");
 	undo_redo->create_action(action_name);
-
-	AABB edited_area = _terrain->get_storage()->get_edited_area();
-	LOG(DEBUG, "Updating undo snapshot edited area: ", edited_area);
-	_undo_set[Terrain3DStorage::TYPE_MAX + 2] = edited_area;
-
-	LOG(DEBUG, "Storing undo snapshot: ", _undo_set);
-	undo_redo->add_undo_method(this, "apply_undo", _undo_set.duplicate()); // Must be duplicated
-
-	LOG(DEBUG, "Setting up redo snapshot...");
-	Array redo_set;
-	redo_set.resize(Terrain3DStorage::TYPE_MAX + 3);
-	for (int i = 0; i < Terrain3DStorage::TYPE_MAX; i++) {
-		redo_set[i] = _terrain->get_storage()->get_maps_copy(static_cast<Terrain3DStorage::MapType>(i));
-		LOG(DEBUG, "maps ", i, "(", static_cast<TypedArray<Image>>(redo_set[i]).size(), "): ", redo_set[i]);
-	}
-	redo_set[Terrain3DStorage::TYPE_MAX] = _terrain->get_storage()->get_region_offsets().duplicate();
-	LOG(DEBUG, "region_offsets(", static_cast<TypedArray<Vector2i>>(redo_set[Terrain3DStorage::TYPE_MAX]).size(), "): ", redo_set[Terrain3DStorage::TYPE_MAX]);
-	redo_set[Terrain3DStorage::TYPE_MAX + 1] = _terrain->get_storage()->get_height_range();
-
-	edited_area = _terrain->get_storage()->get_edited_area();
-	LOG(DEBUG, "Storing edited area: ", edited_area);
-	redo_set[Terrain3DStorage::TYPE_MAX + 2] = edited_area;
-
-	LOG(DEBUG, "Storing redo snapshot: ", redo_set);
+	undo_redo->add_undo_method(this, "apply_undo", undo_set);
 	undo_redo->add_do_method(this, "apply_undo", redo_set);
-
+	undo_redo->add_do_reference(record.token.ptr());
 	LOG(DEBUG, "Committing undo action");
 	undo_redo->commit_action(false);
+	_update_undo_memory();
 }
 
+// Removes and adds the recorded regions, then writes the recorded tiles back into the maps
 void Terrain3DEditor::_apply_undo(const Array &p_set) {
 	ERR_FAIL_COND_MSG(_terrain == nullptr, "terrain is null, returning");
 	ERR_FAIL_COND_MSG(_terrain->get_plugin() == nullptr, "terrain->plugin is null, returning");
-	LOG(INFO, "Applying Undo/Redo set. Array size: ", p_set.size());
-	LOG(DEBUG, "Apply undo received: ", p_set);
+	if (p_set.size() != UNDO_MAX) {
+		LOG(ERROR, "Unrecognized undo set of size ", p_set.size(), ". Cannot apply");
+		return;
+	}
+	Ref<Terrain3DStorage> storage = _terrain->get_storage();
+	int region_size = storage->get_region_size();
+	if (int(p_set[UNDO_REGION_SIZE]) != region_size) {
+		LOG(ERROR, "Region size has changed since this undo step was recorded. Cannot apply");
+		return;
+	}
+	real_t vertex_spacing = _terrain->get_mesh_vertex_spacing();
+	TypedArray<Vector2i> remove_regions = p_set[UNDO_REMOVE_REGIONS];
+	TypedArray<Vector2i> add_regions = p_set[UNDO_ADD_REGIONS];
+	Array add_maps = p_set[UNDO_ADD_MAPS];
+	TypedArray<Vector2i> tile_regions = p_set[UNDO_TILE_REGIONS];
+	TypedArray<Vector2i> tile_positions = p_set[UNDO_TILE_POSITIONS];
+	TypedArray<Image> tiles = _get_undo_tiles(p_set);
+	Terrain3DStorage::MapType map_type = static_cast<Terrain3DStorage::MapType>(int(p_set[UNDO_MAP_TYPE]));
+	LOG(INFO, "Applying Undo/Redo set with ", tiles.size(), " tiles, ", remove_regions.size(), " regions to remove and ",
+			add_regions.size(), " to add");
+
+	for (int i = 0; i < remove_regions.size(); i++) {
+		Vector2i region_offset = remove_regions[i];
+		Vector3 global_position = Vector3(region_offset.x + .5f, 0.f, region_offset.y + .5f) * real_t(region_size) * vertex_spacing;
+		if (storage->has_region(global_position)) {
+			storage->remove_region(global_position);
+		}
+	}
+	for (int i = 0; i < add_regions.size(); i++) {
+		Vector2i region_offset = add_regions[i];
+		Vector3 global_position = Vector3(region_offset.x + .5f, 0.f, region_offset.y + .5f) * real_t(region_size) * vertex_spacing;
+		TypedArray<Image> maps = add_maps[i];
+		storage->add_region(global_position, maps);
+	}
 
-	for (int i = 0; i < Terrain3DStorage::TYPE_MAX; i++) {
-		Terrain3DStorage::MapType map_type = static_cast<Terrain3DStorage::MapType>(i);
-		_terrain->get_storage()->set_maps(map_type, p_set[i]);
+	Vector<int> edited_regions;
+	for (int i = 0; i < tiles.size(); i++) {
+		Ref<Image> tile = tiles[i];
+		Vector2i region_offset = tile_regions[i];
+		Vector3 global_position = Vector3(region_offset.x + .5f, 0.f, region_offset.y + .5f) * real_t(region_size) * vertex_spacing;
+		int region_index = storage->get_region_index(global_position);
+		if (tile.is_null() || region_index == -1) {
+			continue;
+		}
+		Ref<Image> map = storage->get_map_region(map_type, region_index);
+		// The resident height format may have changed since recording
+		if (tile->get_format() != map->get_format()) {
+			tile = tile->duplicate();
+			tile->convert(map->get_format());
+		}
+		{
+			Terrain3DStorage::WriteLock lock = storage->write_lock();
+			map->blit_rect(tile, Rect2i(Vector2i(0, 0), tile->get_size()), tile_positions[i]);
+		}
+		if (!edited_regions.has(region_index)) {
+			edited_regions.push_back(region_index);
+		}
 	}
-	_terrain->get_storage()->set_region_offsets(p_set[Terrain3DStorage::TYPE_MAX]);
-	_terrain->get_storage()->set_height_range(p_set[Terrain3DStorage::TYPE_MAX + 1]);
+	storage->set_height_range(p_set[UNDO_HEIGHT_RANGE]);
 
 	if (_terrain->get_plugin()->has_method("update_grid")) {
 		LOG(DEBUG, "Calling GDScript update_grid()");
@@ -498,9 +627,267 @@ void Terrain3DEditor::_apply_undo(const Array &p_set) {
 	_pending_undo = false;
 	_modified = false;
 
-	AABB edited_area = p_set[Terrain3DStorage::TYPE_MAX + 2];
-	_terrain->get_storage()->clear_edited_area();
-	_terrain->get_storage()->add_edited_area(edited_area);
+	// Report the area first, so height pyramids are current when the maps update
+	AABB edited_area = p_set[UNDO_EDITED_AREA];
+	storage->clear_edited_area();
+	storage->add_edited_area(edited_area);
+	for (int i = 0; i < edited_regions.size(); i++) {
+		storage->force_update_maps(map_type, edited_regions[i]);
+	}
+
+	_update_undo_memory();
+}
+
+// Returns the bytes of memory held by the tiles and maps of an undo set
+int64_t Terrain3DEditor::_get_undo_size(const Array &p_set) {
+	int64_t size = 0;
+	Variant tiles = p_set[UNDO_TILES];
+	if (tiles.get_type() == Variant::ARRAY) {
+		TypedArray<Image> images = tiles;
+		for (int i = 0; i < images.size(); i++) {
+			size += Ref<Image>(images[i])->get_data().size();
+		}
+	} else if (tiles.get_type() == Variant::PACKED_BYTE_ARRAY) {
+		size += PackedByteArray(tiles).size();
+	}
+	Array add_maps = p_set[UNDO_ADD_MAPS];
+	for (int i = 0; i < add_maps.size(); i++) {
+		TypedArray<Image> maps = add_maps[i];
+		for (int j = 0; j < maps.size(); j++) {
+			size += Ref<Image>(maps[j])->get_data().size();
+		}
+	}
+	return size;
+}
+
+// Runs on the WorkerThreadPool. Only reads the tiles, which aren't modified once recorded
+void Terrain3DEditor::_undo_compress_task(void *p_job) {
+	UndoJob *job = static_cast<UndoJob *>(p_job);
+	Vector<RegionCodec::Filter> filters;
+	for (int i = 0; i < job->tiles.size(); i++) {
+		filters.push_back(job->filter);
+	}
+	job->data = RegionCodec::encode(job->tiles, filters);
+}
+
+// Appends the compressed tiles of a set to the undo file, and replaces them with their location
+bool Terrain3DEditor::_spill_undo_tiles(Array p_set) {
+	if (_undo_file.is_null()) {
+		_undo_file_path = OS::get_singleton()->get_cache_dir().path_join(
+				vformat("terrain3d_undo_%d_%d.tmp", OS::get_singleton()->get_process_id(), get_instance_id()));
+		_undo_file = FileAccess::open(_undo_file_path, FileAccess::WRITE_READ);
+		if (_undo_file.is_null()) {
+			LOG(ERROR, "Cannot open undo file for writing: ", _undo_file_path);
+			return false;
+		}
+		LOG(INFO, "Created undo file: ", _undo_file_path);
+	}
+	PackedByteArray data = p_set[UNDO_TILES];
+	_undo_file->seek_end();
+	PackedInt64Array location;
+	location.push_back(int64_t(_undo_file->get_position()));
+	location.push_back(data.size());
+	_undo_file->store_buffer(data);
+	if (_undo_file->get_error() != OK) {
+		LOG(ERROR, "Error writing undo file: ", _undo_file_path);
+		return false;
+	}
+	p_set[UNDO_TILES] = location;
+	return true;
+}
+
+// Returns the tiles of an undo set, decompressing them or reading them from the undo file as needed
+TypedArray<Image> Terrain3DEditor::_get_undo_tiles(const Array &p_set) {
+	Variant tiles = p_set[UNDO_TILES];
+	PackedByteArray data;
+	switch (tiles.get_type()) {
+		case Variant::ARRAY:
+			return tiles;
+		case Variant::PACKED_BYTE_ARRAY:
+			data = tiles;
+			break;
+		case Variant::PACKED_INT64_ARRAY: {
+			PackedInt64Array location = tiles;
+			if (_undo_file.is_null() || location.size() != 2) {
+				LOG(ERROR, "Undo tiles are in a file that is no longer open");
+				return TypedArray<Image>();
+			}
+			_undo_file->seek(uint64_t(location[0]));
+			data = _undo_file->get_buffer(location[1]);
+			if (data.size() != location[1]) {
+				LOG(ERROR, "Failed to read undo tiles from: ", _undo_file_path);
+				return TypedArray<Image>();
+			}
+		} break;
+		default:
+			LOG(ERROR, "Unrecognized undo tiles");
+			return TypedArray<Image>();
+	}
+	TypedArray<Image> images;
+	if (RegionCodec::decode(data, images) != OK) {
+		LOG(ERROR, "Failed to decompress undo tiles");
+		return TypedArray<Image>();
+	}
+	return images;
+}
+
+/**
+ * Prunes discarded records, finishes compression jobs, compresses the tiles of all but the
+ * newest undo record, then while over the budget, moves the compressed tiles of the oldest
+ * records to the undo file.
+ */
+void Terrain3DEditor::_update_undo_memory() {
+	_prune_undo_records();
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	for (int i = 0; i < _undo_jobs.size();) {
+		UndoJob *job = _undo_jobs[i];
+		if (!wtp->is_task_completed(job->task_id)) {
+			i++;
+			continue;
+		}
+		wtp->wait_for_task_completion(job->task_id);
+		_undo_jobs.remove_at(i);
+		if (!job->data.is_empty()) {
+			job->set[UNDO_TILES] = job->data;
+		}
+		memdelete(job);
+	}
+
+	for (int i = 0; i < _undo_records.size() - 1; i++) {
+		Array sets[] = { _undo_records[i].undo_set, _undo_records[i].redo_set };
+		for (Array &set : sets) {
+			Variant tiles = set[UNDO_TILES];
+			if (tiles.get_type() != Variant::ARRAY || Array(tiles).is_empty()) {
+				continue;
+			}
+			bool pending = false;
+			for (int j = 0; j < _undo_jobs.size() && !pending; j++) {
+				pending = int(_undo_jobs[j]->set[UNDO_ID]) == _undo_records[i].id &&
+						bool(_undo_jobs[j]->set[UNDO_REDO]) == bool(set[UNDO_REDO]);
+			}
+			if (pending) {
+				continue;
+			}
+			UndoJob *job = memnew(UndoJob);
+			job->set = set;
+			job->tiles = tiles;
+			job->filter = Terrain3DStorage::CODEC_FILTER[int(set[UNDO_MAP_TYPE])];
+			job->task_id = wtp->add_native_task(&Terrain3DEditor::_undo_compress_task, job, false, "Terrain3DEditor undo compression");
+			_undo_jobs.push_back(job);
+		}
+	}
+
+	int64_t budget = int64_t(_undo_memory_budget) * 1024 * 1024;
+	int64_t usage = 0;
+	for (int i = 0; i < _undo_records.size(); i++) {
+		usage += _get_undo_size(_undo_records[i].undo_set) + _get_undo_size(_undo_records[i].redo_set);
+	}
+	for (int i = 0; i < _undo_records.size() - 1 && usage > budget; i++) {
+		Array sets[] = { _undo_records[i].undo_set, _undo_records[i].redo_set };
+		for (Array &set : sets) {
+			Variant tiles = set[UNDO_TILES];
+			if (tiles.get_type() != Variant::PACKED_BYTE_ARRAY) {
+				continue;
+			}
+			int64_t size = PackedByteArray(tiles).size();
+			if (_spill_undo_tiles(set)) {
+				usage -= size;
+			}
+		}
+	}
+}
+
+// Forgets records of actions the undo manager no longer holds, then compacts the undo file
+void Terrain3DEditor::_prune_undo_records() {
+	int count = _undo_records.size();
+	for (int i = count - 1; i >= 0; i--) {
+		if (_undo_records[i].token->get_reference_count() <= 1) {
+			_undo_records.remove_at(i);
+		}
+	}
+	if (_undo_records.size() < count) {
+		LOG(DEBUG, "Pruned ", count - _undo_records.size(), " undo records discarded by the undo manager");
+		_compact_undo_file();
+	}
+}
+
+/**
+ * Deletes the undo file if no records are spilled to it, or rewrites it with only the tiles
+ * of remaining records once more than half of it belongs to pruned ones.
+ */
+void Terrain3DEditor::_compact_undo_file() {
+	if (_undo_file.is_null()) {
+		return;
+	}
+	Vector<Array> spilled;
+	int64_t live = 0;
+	for (int i = 0; i < _undo_records.size(); i++) {
+		Array sets[] = { _undo_records[i].undo_set, _undo_records[i].redo_set };
+		for (const Array &set : sets) {
+			Variant tiles = set[UNDO_TILES];
+			if (tiles.get_type() == Variant::PACKED_INT64_ARRAY) {
+				spilled.push_back(set);
+				live += PackedInt64Array(tiles)[1];
+			}
+		}
+	}
+	if (spilled.is_empty()) {
+		LOG(INFO, "Removing unused undo file: ", _undo_file_path);
+		_undo_file.unref();
+		DirAccess::remove_absolute(_undo_file_path);
+		return;
+	}
+	int64_t length = int64_t(_undo_file->get_length());
+	if (length - live <= live) {
+		return;
+	}
+
+	// Alternates between two names, as the old file stays open until the new one is written
+	String path = _undo_file_path.ends_with(".compact") ? _undo_file_path.trim_suffix(".compact") : _undo_file_path + ".compact";
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE_READ);
+	if (file.is_null()) {
+		LOG(ERROR, "Cannot open undo file for writing: ", path);
+		return;
+	}
+	Vector<PackedInt64Array> locations;
+	for (int i = 0; i < spilled.size(); i++) {
+		PackedInt64Array location = spilled[i][UNDO_TILES];
+		_undo_file->seek(uint64_t(location[0]));
+		PackedByteArray data = _undo_file->get_buffer(location[1]);
+		location.set(0, int64_t(file->get_position()));
+		file->store_buffer(data);
+		if (data.size() != location[1] || file->get_error() != OK) {
+			LOG(ERROR, "Failed to compact undo file: ", _undo_file_path);
+			file.unref();
+			DirAccess::remove_absolute(path);
+			return;
+		}
+		locations.push_back(location);
+	}
+	for (int i = 0; i < spilled.size(); i++) {
+		Array set = spilled[i];
+		set[UNDO_TILES] = locations[i];
+	}
+	LOG(INFO, "Compacted undo file from ", length, " to ", live, " bytes");
+	_undo_file.unref();
+	DirAccess::remove_absolute(_undo_file_path);
+	_undo_file_path = path;
+	_undo_file = file;
+}
+
+// Waits for compression jobs, forgets all records and deletes the undo file
+void Terrain3DEditor::_clear_undo_records() {
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	for (int i = 0; i < _undo_jobs.size(); i++) {
+		wtp->wait_for_task_completion(_undo_jobs[i]->task_id);
+		memdelete(_undo_jobs[i]);
+	}
+	_undo_jobs.clear();
+	_undo_records.clear();
+	if (_undo_file.is_valid()) {
+		_undo_file.unref();
+		DirAccess::remove_absolute(_undo_file_path);
+	}
 }
 
 ///////////////////////////
@@ -511,6 +898,7 @@ Terrain3DEditor::Terrain3DEditor() {
 }
 
 Terrain3DEditor::~Terrain3DEditor() {
+	_clear_undo_records();
 }
 
 void Terrain3DEditor::set_brush_data(Dictionary p_data) {
@@ -533,6 +921,7 @@ void Terrain3DEditor::start_operation(Vector3 p_global_position) {
 		LOG(ERROR, "_terrain not set");
 		return;
 	}
+	_update_undo_memory();
 	_setup_undo();
 	_pending_undo = true;
 	_modified = false;
@@ -574,6 +963,39 @@ void Terrain3DEditor::stop_operation() {
 	}
 }
 
+// Sets the memory undo history may hold before older entries are moved to a temporary file
+void Terrain3DEditor::set_undo_memory_budget(int p_megabytes) {
+	LOG(INFO, "Setting undo memory budget: ", p_megabytes, " MB");
+	_undo_memory_budget = MAX(p_megabytes, 0);
+	_update_undo_memory();
+}
+
+Dictionary Terrain3DEditor::get_undo_memory_usage() const {
+	int64_t memory = 0;
+	int64_t compressed = 0;
+	int64_t spilled = 0;
+	for (int i = 0; i < _undo_records.size(); i++) {
+		Array sets[] = { _undo_records[i].undo_set, _undo_records[i].redo_set };
+		for (const Array &set : sets) {
+			Variant tiles = set[UNDO_TILES];
+			if (tiles.get_type() == Variant::PACKED_BYTE_ARRAY) {
+				compressed += PackedByteArray(tiles).size();
+			} else if (tiles.get_type() == Variant::PACKED_INT64_ARRAY) {
+				spilled += PackedInt64Array(tiles)[1];
+			}
+			memory += _get_undo_size(set);
+		}
+	}
+	Dictionary dict;
+	dict["entries"] = _undo_records.size();
+	dict["memory"] = memory;
+	dict["compressed"] = compressed;
+	dict["spilled"] = spilled;
+	dict["pending"] = _undo_jobs.size();
+	dict["budget"] = int64_t(_undo_memory_budget) * 1024 * 1024;
+	return dict;
+}
+
 ///////////////////////////
 // Protected Functions
 ///////////////////////////
@@ -611,5 +1033,9 @@ void Terrain3DEditor::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("stop_operation"), &Terrain3DEditor::stop_operation);
 	ClassDB::bind_method(D_METHOD("is_operating"), &Terrain3DEditor::is_operating);
 
+	ClassDB::bind_method(D_METHOD("set_undo_memory_budget", "megabytes"), &Terrain3DEditor::set_undo_memory_budget);
+	ClassDB::bind_method(D_METHOD("get_undo_memory_budget"), &Terrain3DEditor::get_undo_memory_budget);
+	ClassDB::bind_method(D_METHOD("get_undo_memory_usage"), &Terrain3DEditor::get_undo_memory_usage);
+
 	ClassDB::bind_method(D_METHOD("apply_undo", "maps"), &Terrain3DEditor::_apply_undo);
 }
@@ -3,8 +3,10 @@
 #ifndef TERRAIN3D_EDITOR_CLASS_H
 #define TERRAIN3D_EDITOR_CLASS_H
 
+#include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/image.hpp>
 #include <godot_cpp/classes/image_texture.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
 
 #include "terrain_3d.h"
 
@@ -118,7 +120,68 @@ private:
 	bool _pending_undo = false;
 	bool _modified = false;
 	AABB _modified_area;
-	Array _undo_set; // 0-2: map 0,1,2, 3: Region offsets, 4: height range, 5: edited AABB
+
+	// Undo is recorded as copies of the tiles an operation touches, plus the regions it added
+	// or removed, so its cost scales with the edited area rather than the world size
+	static inline const int UNDO_TILE_SIZE = 64;
+
+	// Indices of the Array given to apply_undo
+	enum UndoData {
+		UNDO_MAP_TYPE, // The map type of the tiles, or TYPE_MAX if none
+		UNDO_REGION_SIZE,
+		UNDO_HEIGHT_RANGE,
+		UNDO_EDITED_AREA,
+		UNDO_TILE_REGIONS, // Region offset of each tile
+		UNDO_TILE_POSITIONS, // Pixel position of each tile in its region
+		UNDO_TILES,
+		UNDO_REMOVE_REGIONS, // Region offsets to remove
+		UNDO_ADD_REGIONS, // Region offsets to add
+		UNDO_ADD_MAPS, // Maps of each added region, or empty arrays for blank regions
+		UNDO_ID, // Id of the UndoRecord holding this set
+		UNDO_REDO, // True for the redo set
+		UNDO_MAX,
+	};
+
+	Terrain3DStorage::MapType _undo_map_type = Terrain3DStorage::TYPE_MAX;
+	Vector2 _undo_height_range;
+	Dictionary _undo_tile_index; // Vector3i(region offset x, y, tile) : index into _undo_tiles
+	TypedArray<Vector2i> _undo_tile_regions;
+	TypedArray<Vector2i> _undo_tile_positions;
+	TypedArray<Image> _undo_tiles;
+	TypedArray<Vector2i> _undo_added_regions;
+	TypedArray<Vector2i> _undo_removed_regions;
+	Array _undo_removed_maps;
+
+	/**
+	 * Undo memory budget. The sets given to the undo manager are shared with _undo_records, so
+	 * their tiles can be replaced in place. The newest entry keeps its tiles as Images. Older
+	 * entries are compressed with RegionCodec on the WorkerThreadPool, and while over the budget,
+	 * the oldest compressed tiles are moved to a temporary file and read back when applied.
+	 * UNDO_TILES holds a TypedArray<Image>, a PackedByteArray when compressed, or a
+	 * PackedInt64Array of the file position and size when spilled.
+	 * Each record's token is also given to the undo manager as a do reference, so once the manager
+	 * discards the action, by a new action, its history limit or a cleared history, the token is
+	 * only held by the record. Those records are pruned and the undo file compacted.
+	 */
+	struct UndoRecord {
+		int id = 0;
+		Array undo_set;
+		Array redo_set;
+		Ref<RefCounted> token;
+	};
+	struct UndoJob {
+		Array set;
+		TypedArray<Image> tiles;
+		RegionCodec::Filter filter = RegionCodec::FILTER_NONE;
+		PackedByteArray data;
+		int64_t task_id = -1;
+	};
+	int _undo_memory_budget = 512; // MB
+	int _undo_next_id = 1;
+	Vector<UndoRecord> _undo_records; // Oldest first
+	Vector<UndoJob *> _undo_jobs;
+	Ref<FileAccess> _undo_file;
+	String _undo_file_path;
 
 	void _region_modified(Vector3 p_global_position, Vector2 p_height_range = Vector2());
 	void _operate_region(Vector3 p_global_position);
@@ -127,9 +190,18 @@ private:
 	Vector2 _get_uv_position(Vector3 p_global_position, int p_region_size);
 	Vector2 _rotate_uv(Vector2 p_uv, real_t p_angle);
 
+	void _backup_tile(const Ref<Image> &p_map, Vector2i p_region_offset, Vector2i p_pixel);
 	void _setup_undo();
 	void _store_undo();
 	void _apply_undo(const Array &p_set);
+	static int64_t _get_undo_size(const Array &p_set);
+	static void _undo_compress_task(void *p_job);
+	bool _spill_undo_tiles(Array p_set);
+	TypedArray<Image> _get_undo_tiles(const Array &p_set);
+	void _update_undo_memory();
+	void _prune_undo_records();
+	void _compact_undo_file();
+	void _clear_undo_records();
 
 public:
 	Terrain3DEditor();
@@ -149,6 +221,10 @@ public:
 	void stop_operation();
 	bool is_operating() const { return _pending_undo; }
 
+	void set_undo_memory_budget(int p_megabytes);
+	int get_undo_memory_budget() const { return _undo_memory_budget; }
+	Dictionary get_undo_memory_usage() const;
+
 protected:
 	static void _bind_methods();
 };
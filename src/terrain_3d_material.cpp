@@ -299,15 +299,16 @@ void Terrain3DMaterial::_update_shader() {
 // 0: height maps texture array RID
 // 1: control maps RID
 // 2: color maps RID
-// 3: region map packedByteArray
-// 4: region offsets array
+// 3: region map RID
+// 4: region map origin
+// 5: region offsets array
 void Terrain3DMaterial::_update_regions(const Array &p_args) {
 	if (!_initialized) {
 		return;
 	}
 	LOG(INFO, "Updating region maps in shader");
-	if (p_args.size() != 5) {
-		LOG(ERROR, "Expected 5 arguments. Received: ", p_args.size());
+	if (p_args.size() != 6) {
+		LOG(ERROR, "Expected 6 arguments. Received: ", p_args.size());
 		return;
 	}
 
@@ -321,47 +322,41 @@ void Terrain3DMaterial::_update_regions(const Array &p_args) {
 	LOG(DEBUG, "Control map RID: ", control_rid);
 	LOG(DEBUG, "Color map RID: ", color_rid);
 
-	_region_map = p_args[3];
-	LOG(DEBUG, "_region_map.size(): ", _region_map.size());
-	if (_region_map.size() != Terrain3DStorage::REGION_MAP_SIZE * Terrain3DStorage::REGION_MAP_SIZE) {
-		LOG(ERROR, "Expected _region_map.size() of ", Terrain3DStorage::REGION_MAP_SIZE * Terrain3DStorage::REGION_MAP_SIZE);
-	}
-	RS->material_set_param(_material, "_region_map", _region_map);
-	RS->material_set_param(_material, "_region_map_size", Terrain3DStorage::REGION_MAP_SIZE);
-	if (Terrain3D::debug_level >= DEBUG) {
-		LOG(DEBUG, "Region map");
-		for (int i = 0; i < _region_map.size(); i++) {
-			if (_region_map[i]) {
-				LOG(DEBUG, "Region id: ", _region_map[i], " array index: ", i);
-			}
-		}
-	}
+	RID region_map_rid = p_args[3];
+	Vector2i region_map_origin = p_args[4];
+	RS->material_set_param(_material, "_region_map", region_map_rid);
+	RS->material_set_param(_material, "_region_map_origin", region_map_origin);
+	LOG(DEBUG, "Region map RID: ", region_map_rid, ", origin: ", region_map_origin);
 
-	TypedArray<Vector2i> region_offsets = p_args[4];
-	LOG(DEBUG, "Region_offsets size: ", region_offsets.size(), " ", region_offsets);
-	RS->material_set_param(_material, "_region_offsets", region_offsets);
+	_region_offsets = p_args[5];
+	LOG(DEBUG, "Region_offsets size: ", _region_offsets.size(), " ", _region_offsets);
 
 	_generate_region_blend_map();
 }
 
+// Builds a blurred mask of the regions, covering their bounds plus an empty border of one region,
+// so the world noise fades out around the edges of the terrain
 void Terrain3DMaterial::_generate_region_blend_map() {
-	int rsize = Terrain3DStorage::REGION_MAP_SIZE;
-	if (_region_map.size() == rsize * rsize) {
-		LOG(DEBUG, "Regenerating ", Vector2i(512, 512), " region blend map");
-		Ref<Image> region_blend_img = Image::create(rsize, rsize, false, Image::FORMAT_RH);
-		for (int y = 0; y < rsize; y++) {
-			for (int x = 0; x < rsize; x++) {
-				if (_region_map[y * rsize + x] > 0) {
-					region_blend_img->set_pixel(x, y, COLOR_WHITE);
-				}
-			}
-		}
-		region_blend_img->resize(512, 512, Image::INTERPOLATE_TRILINEAR);
-		_generated_region_blend_map.clear();
-		_generated_region_blend_map.create(region_blend_img);
-		RS->material_set_param(_material, "_region_blend_map", _generated_region_blend_map.get_rid());
-		Util::dump_gen(_generated_region_blend_map, "blend_map");
-	}
+	Rect2i bounds;
+	for (int i = 0; i < _region_offsets.size(); i++) {
+		Vector2i offset = _region_offsets[i];
+		bounds = (i == 0) ? Rect2i(offset, Vector2i(1, 1)) : bounds.expand(offset).expand(offset + Vector2i(1, 1));
+	}
+	bounds = bounds.grow(1);
+	Ref<Image> region_blend_img = Image::create(bounds.size.x, bounds.size.y, false, Image::FORMAT_RH);
+	for (int i = 0; i < _region_offsets.size(); i++) {
+		region_blend_img->set_pixelv(Vector2i(_region_offsets[i]) - bounds.position, COLOR_WHITE);
+	}
+	int px_per_region = CLAMP(BLEND_MAP_MAX_SIZE / MAX(bounds.size.x, bounds.size.y), 1, BLEND_MAP_PX_PER_REGION);
+	Vector2i blend_size = bounds.size * px_per_region;
+	LOG(DEBUG, "Regenerating ", blend_size, " region blend map over regions ", bounds);
+	region_blend_img->resize(blend_size.x, blend_size.y, Image::INTERPOLATE_TRILINEAR);
+	_generated_region_blend_map.clear();
+	_generated_region_blend_map.create(region_blend_img);
+	RS->material_set_param(_material, "_region_blend_map", _generated_region_blend_map.get_rid());
+	RS->material_set_param(_material, "_region_blend_map_origin", Vector2(bounds.position));
+	RS->material_set_param(_material, "_region_blend_map_size", Vector2(bounds.size));
+	Util::dump_gen(_generated_region_blend_map, "blend_map");
 }
 
 // Called from signal connected in Terrain3D, emitted by texture_list
@@ -398,7 +393,7 @@ void Terrain3DMaterial::_set_region_size(int p_size) {
 	_region_size = CLAMP(p_size, 64, 4096);
 	_region_sizev = Vector2i(_region_size, _region_size);
 	RS->material_set_param(_material, "_region_size", real_t(_region_size));
-	RS->material_set_param(_material, "_region_pixel_size", 1.0f / real_t(_region_size));
+	RS->material_set_param(_material, "_region_texel_size", 1.0f / real_t(_region_size));
 }
 
 void Terrain3DMaterial::_set_shader_parameters(const Dictionary &p_dict) {
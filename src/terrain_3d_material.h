@@ -31,6 +31,9 @@ public: // Constants
 	};
 
 private:
+	static inline const int BLEND_MAP_PX_PER_REGION = 32;
+	static inline const int BLEND_MAP_MAX_SIZE = 2048;
+
 	bool _initialized = false;
 	RID _material;
 	RID _shader;
@@ -67,8 +70,8 @@ private:
 	int _region_size = 1024;
 	real_t _mesh_vertex_spacing = 1.0f;
 	Vector2i _region_sizev = Vector2i(_region_size, _region_size);
-	PackedInt32Array _region_map;
-	GeneratedTexture _generated_region_blend_map; // 512x512 blurred image of region_map
+	TypedArray<Vector2i> _region_offsets;
+	GeneratedTexture _generated_region_blend_map; // Blurred image of the regions, 32px per region
 
 	// Functions
 	void _preload_shaders();
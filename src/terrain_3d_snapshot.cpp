@@ -0,0 +1,56 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#include <godot_cpp/core/class_db.hpp>
+
+#include "logger.h"
+#include "terrain_3d_snapshot.h"
+
+///////////////////////////
+// Public Functions
+///////////////////////////
+
+// Returns a copy on write duplicate, so editing it doesn't change the snapshot
+Ref<Image> Terrain3DSnapshot::get_map_region(Terrain3DStorage::MapType p_map_type, int p_region_index) const {
+	Ref<Image> map = _storage->get_map_region(p_map_type, p_region_index);
+	return map.is_valid() ? map->duplicate() : map;
+}
+
+TypedArray<Image> Terrain3DSnapshot::get_maps(Terrain3DStorage::MapType p_map_type) const {
+	if (p_map_type < 0 || p_map_type >= Terrain3DStorage::TYPE_MAX) {
+		LOG(ERROR, "Specified map type out of range");
+		return TypedArray<Image>();
+	}
+	TypedArray<Image> maps = _storage->get_maps(p_map_type);
+	TypedArray<Image> copies;
+	copies.resize(maps.size());
+	for (int i = 0; i < maps.size(); i++) {
+		copies[i] = Ref<Image>(maps[i])->duplicate();
+	}
+	return copies;
+}
+
+///////////////////////////
+// Protected Functions
+///////////////////////////
+
+void Terrain3DSnapshot::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_version"), &Terrain3DSnapshot::get_version);
+	ClassDB::bind_method(D_METHOD("get_region_size"), &Terrain3DSnapshot::get_region_size);
+	ClassDB::bind_method(D_METHOD("get_region_count"), &Terrain3DSnapshot::get_region_count);
+	ClassDB::bind_method(D_METHOD("get_region_offsets"), &Terrain3DSnapshot::get_region_offsets);
+	ClassDB::bind_method(D_METHOD("get_height_range"), &Terrain3DSnapshot::get_height_range);
+	ClassDB::bind_method(D_METHOD("get_region_index", "global_position"), &Terrain3DSnapshot::get_region_index);
+	ClassDB::bind_method(D_METHOD("has_region", "global_position"), &Terrain3DSnapshot::has_region);
+	ClassDB::bind_method(D_METHOD("get_map_region", "map_type", "region_index"), &Terrain3DSnapshot::get_map_region);
+	ClassDB::bind_method(D_METHOD("get_maps", "map_type"), &Terrain3DSnapshot::get_maps);
+
+	ClassDB::bind_method(D_METHOD("get_pixel", "map_type", "global_position"), &Terrain3DSnapshot::get_pixel);
+	ClassDB::bind_method(D_METHOD("get_height", "global_position"), &Terrain3DSnapshot::get_height);
+	ClassDB::bind_method(D_METHOD("get_control", "global_position"), &Terrain3DSnapshot::get_control);
+	ClassDB::bind_method(D_METHOD("get_normal", "global_position"), &Terrain3DSnapshot::get_normal);
+	ClassDB::bind_method(D_METHOD("get_heights", "global_positions"), &Terrain3DSnapshot::get_heights);
+	ClassDB::bind_method(D_METHOD("get_normals", "global_positions"), &Terrain3DSnapshot::get_normals);
+	ClassDB::bind_method(D_METHOD("get_mesh_vertex", "lod", "filter", "global_position"), &Terrain3DSnapshot::get_mesh_vertex);
+	ClassDB::bind_method(D_METHOD("raycast", "from", "direction", "max_distance"), &Terrain3DSnapshot::raycast, DEFVAL(100000.f));
+	ClassDB::bind_method(D_METHOD("get_height_range_rect", "global_rect"), &Terrain3DSnapshot::get_height_range_rect);
+}
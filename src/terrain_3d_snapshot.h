@@ -0,0 +1,54 @@
+// Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
+
+#ifndef TERRAIN3D_SNAPSHOT_CLASS_H
+#define TERRAIN3D_SNAPSHOT_CLASS_H
+
+#include "terrain_3d_storage.h"
+
+using namespace godot;
+
+/**
+ * An immutable view of the terrain data at one point in time, made by
+ * Terrain3DStorage::create_snapshot(). The view is a private storage holding copy on write
+ * duplicates of the region maps, and shared copies of the sampler, region map and height
+ * pyramids, so no pixels are copied until the live terrain edits a map. Nothing edits the
+ * private storage, so queries are safe from any thread and never wait on the editor.
+ */
+class Terrain3DSnapshot : public RefCounted {
+	GDCLASS(Terrain3DSnapshot, RefCounted);
+	CLASS_NAME();
+
+	friend class Terrain3DStorage;
+
+private:
+	uint64_t _version = 0; // Terrain3DStorage::get_data_version() when taken
+	Ref<Terrain3DStorage> _storage; // Never rendered, edited or exposed
+
+public:
+	Terrain3DSnapshot() { _storage.instantiate(); }
+
+	uint64_t get_version() const { return _version; }
+	int get_region_size() const { return _storage->get_region_size(); }
+	int get_region_count() const { return _storage->get_region_count(); }
+	TypedArray<Vector2i> get_region_offsets() const { return _storage->get_region_offsets().duplicate(); }
+	Vector2 get_height_range() const { return _storage->get_height_range(); }
+	int get_region_index(Vector3 p_global_position) const { return _storage->get_region_index(p_global_position); }
+	bool has_region(Vector3 p_global_position) const { return _storage->has_region(p_global_position); }
+	Ref<Image> get_map_region(Terrain3DStorage::MapType p_map_type, int p_region_index) const;
+	TypedArray<Image> get_maps(Terrain3DStorage::MapType p_map_type) const;
+
+	Color get_pixel(Terrain3DStorage::MapType p_map_type, Vector3 p_global_position) const { return _storage->get_pixel(p_map_type, p_global_position); }
+	real_t get_height(Vector3 p_global_position) const { return _storage->get_height(p_global_position); }
+	uint32_t get_control(Vector3 p_global_position) const { return _storage->get_control(p_global_position); }
+	Vector3 get_normal(Vector3 p_global_position) const { return _storage->get_normal(p_global_position); }
+	PackedRealArray get_heights(const PackedVector3Array &p_global_positions) const { return _storage->get_heights(p_global_positions); }
+	PackedVector3Array get_normals(const PackedVector3Array &p_global_positions) const { return _storage->get_normals(p_global_positions); }
+	Vector3 get_mesh_vertex(int32_t p_lod, Terrain3DStorage::HeightFilter p_filter, Vector3 p_global_position) const { return _storage->get_mesh_vertex(p_lod, p_filter, p_global_position); }
+	Vector3 raycast(Vector3 p_from, Vector3 p_direction, real_t p_max_distance = 100000.f) const { return _storage->raycast(p_from, p_direction, p_max_distance); }
+	Vector2 get_height_range_rect(Rect2 p_global_rect) const { return _storage->get_height_range_rect(p_global_rect); }
+
+protected:
+	static void _bind_methods();
+};
+
+#endif // TERRAIN3D_SNAPSHOT_CLASS_H
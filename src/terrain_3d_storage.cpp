@@ -1,25 +1,1373 @@
 // Copyright © 2023 Cory Petkovsek, Roope Palmroos, and Contributors.
 
+#include <cstring>
+
+#include <godot_cpp/classes/dir_access.hpp>
 #include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/rendering_server.hpp>
 #include <godot_cpp/classes/resource_saver.hpp>
 #include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/templates/hash_map.hpp>
+#include <godot_cpp/templates/hash_set.hpp>
+
+#include "logger.h"
+#include "region_file.h"
+#include "terrain_3d_snapshot.h"
+#include "terrain_3d_storage.h"
+
+///////////////////////////
+// Private Functions
+///////////////////////////
+
+void Terrain3DStorage::_clear() {
+	LOG(INFO, "Clearing storage");
+	_region_map_dirty = true;
+	_generated_height_maps.clear();
+	_generated_control_maps.clear();
+	_generated_color_maps.clear();
+	_generated_region_map.clear();
+	{
+		WriteLock lock(_map_lock);
+		_region_map.clear();
+		_clear_sampler();
+		_data_version++;
+	}
+	_edited_rects.clear();
+	_color_mipmap_rects.clear();
+	_shared_maps.clear();
+}
+
+// Empties the CPU sampler cache and the height pyramids, disabling queries. Expects _map_lock held exclusively
+void Terrain3DStorage::_clear_sampler() {
+	_sampler_offsets.clear();
+	for (int t = 0; t < TYPE_MAX; t++) {
+		_sampler_maps[t].clear();
+	}
+	_height_pyramids.clear();
+	_height_pyramid_ids.clear();
+	_height_range_dirty = true;
+}
+
+// Mirrors the region arrays into native containers for the CPU sampler. Expects _map_lock held exclusively
+void Terrain3DStorage::_update_sampler() {
+	LOG(DEBUG_CONT, "Updating CPU sampler cache");
+	int count = _region_offsets.size();
+	_sampler_offsets.resize(count);
+	for (int i = 0; i < count; i++) {
+		_sampler_offsets.set(i, _region_offsets[i]);
+	}
+	for (int t = 0; t < TYPE_MAX; t++) {
+		TypedArray<Image> maps = get_maps(static_cast<MapType>(t));
+		if (maps.size() != count) {
+			// Expected while loading, as region_offsets is set before the maps
+			LOG(DEBUG_CONT, TYPESTR[t], " maps size ", maps.size(), " doesn't match ", count, " regions yet");
+			_clear_sampler();
+			return;
+		}
+		Vector<Ref<Image>> &cache = _sampler_maps[t];
+		cache.resize(count);
+		for (int i = 0; i < count; i++) {
+			Ref<Image> map = maps[i];
+			if (map.is_null() || map->get_size() != _region_sizev || map->get_format() != _get_format(static_cast<MapType>(t))) {
+				LOG(ERROR, "Region ", i, " ", TYPESTR[t], " map is invalid. CPU queries disabled until maps are fixed");
+				_clear_sampler();
+				return;
+			}
+			cache.set(i, map);
+		}
+	}
+	_update_height_pyramids();
+}
+
+/**
+ * Rebuilds the CPU region map and sampler so queries see added or removed regions, without
+ * touching the GPU. _region_map_dirty stays set, so the next update_regions() regenerates the
+ * region map texture and emits regions_changed once for a bulk change. The sampler is rebuilt
+ * with the map, as region indices shift on removal. Unchanged height pyramids are reused.
+ */
+void Terrain3DStorage::_update_region_map() {
+	WriteLock lock(_map_lock);
+	_region_map.build(_region_offsets);
+	_update_sampler();
+	_data_version++;
+}
+
+// Builds pyramids for new or replaced height maps, reusing the rest
+void Terrain3DStorage::_update_height_pyramids() {
+	int count = _sampler_offsets.size();
+	HashMap<uint64_t, int> previous;
+	if (!_height_pyramids_dirty) {
+		for (int i = 0; i < _height_pyramid_ids.size(); i++) {
+			previous.insert(_height_pyramid_ids[i], i);
+		}
+	}
+	Vector<HeightPyramid> pyramids;
+	pyramids.resize(count);
+	Vector<uint64_t> ids;
+	ids.resize(count);
+	int built = 0;
+	for (int i = 0; i < count; i++) {
+		const Ref<Image> &map = _sampler_maps[TYPE_HEIGHT][i];
+		uint64_t id = map->get_instance_id();
+		ids.set(i, id);
+		if (previous.has(id)) {
+			pyramids.set(i, _height_pyramids[previous[id]]);
+		} else {
+			pyramids.ptrw()[i].build(_get_heights(map), _region_size);
+			built++;
+		}
+	}
+	_height_pyramids = pyramids;
+	_height_pyramid_ids = ids;
+	_height_pyramids_dirty = false;
+	_height_range_dirty = true;
+	LOG(DEBUG_CONT, "Built ", built, " height pyramids, reused ", count - built);
+}
+
+// Updates the pyramids for changed heights in a global pixel rectangle. Expects _map_lock held exclusively
+void Terrain3DStorage::_update_height_pyramids(Rect2i p_px_rect) {
+	int rs = _region_size;
+	Vector2i from = Vector2i(floor_div(p_px_rect.position.x, rs), floor_div(p_px_rect.position.y, rs));
+	Vector2i to = Vector2i(floor_div(p_px_rect.get_end().x - 1, rs), floor_div(p_px_rect.get_end().y - 1, rs));
+	for (int y = from.y; y <= to.y; y++) {
+		for (int x = from.x; x <= to.x; x++) {
+			int region = _region_map.get(Vector2i(x, y));
+			if (!_has_pyramid(region)) {
+				continue;
+			}
+			const Ref<Image> &map = _sampler_maps[TYPE_HEIGHT][region];
+			Rect2i local = Rect2i(p_px_rect.position - _sampler_offsets[region] * rs, p_px_rect.size);
+			_height_pyramids.ptrw()[region].update(_get_heights(map), local);
+			_height_range_dirty = true;
+		}
+	}
+}
+
+// Returns the exact height range in a global pixel rectangle, or min > max if there are no regions
+Vector2 Terrain3DStorage::_get_height_range_px(Rect2i p_px_rect) const {
+	Vector2 range = Vector2(FLT_MAX, -FLT_MAX);
+	int rs = _region_size;
+	Vector2i from = Vector2i(floor_div(p_px_rect.position.x, rs), floor_div(p_px_rect.position.y, rs));
+	Vector2i to = Vector2i(floor_div(p_px_rect.get_end().x - 1, rs), floor_div(p_px_rect.get_end().y - 1, rs));
+	for (int y = from.y; y <= to.y; y++) {
+		for (int x = from.x; x <= to.x; x++) {
+			int region = _region_map.get(Vector2i(x, y));
+			if (!_has_pyramid(region)) {
+				continue;
+			}
+			const Ref<Image> &map = _sampler_maps[TYPE_HEIGHT][region];
+			Rect2i local = Rect2i(p_px_rect.position - _sampler_offsets[region] * rs, p_px_rect.size);
+			Vector2 r = _height_pyramids[region].get_min_max(_get_heights(map), local);
+			range.x = MIN(range.x, r.x);
+			range.y = MAX(range.y, r.y);
+		}
+	}
+	return range;
+}
+
+/**
+ * Combines the top node of each region's pyramid. Includes 0, as the range always has, so
+ * terrain raised or lowered entirely away from 0 still reports a range reaching it.
+ * Expects _height_range_mutex held. The dirty flag is cleared before reading the pyramids,
+ * so an edit made meanwhile marks it again.
+ */
+void Terrain3DStorage::_update_height_range() const {
+	_height_range_dirty = false;
+	ReadLock lock(_map_lock);
+	Vector2 range = Vector2(0.f, 0.f);
+	for (int i = 0; i < _height_pyramids.size(); i++) {
+		if (_height_pyramids[i].is_valid()) {
+			Vector2 r = _height_pyramids[i].get_min_max();
+			range.x = MIN(range.x, r.x);
+			range.y = MAX(range.y, r.y);
+		}
+	}
+	_height_range = range;
+}
+
+// Returns a map sharing the data of earlier maps with the same uniform value, or p_map if it isn't uniform
+Ref<Image> Terrain3DStorage::_get_shared_map(const Ref<Image> &p_map) {
+	uint32_t texel;
+	if (!Util::is_uniform(p_map, &texel)) {
+		return p_map;
+	}
+	Vector4i key = Vector4i(p_map->get_format(), p_map->get_width(), p_map->has_mipmaps() ? 1 : 0, int32_t(texel));
+	if (_shared_maps.has(key)) {
+		Ref<Image> shared = _shared_maps[key];
+		if (shared->get_size() == p_map->get_size()) {
+			return shared->duplicate();
+		}
+	}
+	// Kept as a duplicate, so edits to p_map don't change the shared data
+	_shared_maps[key] = p_map->duplicate();
+	return p_map;
+}
+
+// Returns a blank map sharing its data with all other blank maps of the type
+Ref<Image> Terrain3DStorage::_get_blank_map(MapType p_map_type) {
+	Image::Format format = _get_format(p_map_type);
+	bool mipmaps = p_map_type == TYPE_COLOR; // Color maps get mipmaps before upload anyway
+	uint32_t texel = 0;
+	Util::is_uniform(Util::get_filled_image(Vector2i(1, 1), COLOR[p_map_type], false, format), &texel);
+	Vector4i key = Vector4i(format, _region_size, mipmaps ? 1 : 0, int32_t(texel));
+	if (_shared_maps.has(key)) {
+		Ref<Image> shared = _shared_maps[key];
+		if (shared->get_size() == _region_sizev) {
+			return shared->duplicate();
+		}
+	}
+	Ref<Image> map = Util::get_filled_image(_region_sizev, COLOR[p_map_type], mipmaps, format);
+	_shared_maps[key] = map->duplicate();
+	return map;
+}
+
+// Marks color map pixels whose mipmaps must be regenerated. An empty rect marks the whole map
+void Terrain3DStorage::_set_color_mipmaps_dirty(Vector2i p_region_offset, Rect2i p_rect) {
+	Rect2i rect = p_rect.has_area() ? p_rect : Rect2i(Vector2i(), _region_sizev);
+	if (_color_mipmap_rects.has(p_region_offset)) {
+		rect = rect.merge(_color_mipmap_rects[p_region_offset]);
+	}
+	_color_mipmap_rects[p_region_offset] = rect;
+}
+
+// Runs on the WorkerThreadPool. Each task owns one map copy
+void Terrain3DStorage::_mipmap_task(void *p_job, uint32_t p_index) {
+	const MipmapJob *job = static_cast<const MipmapJob *>(p_job);
+	Util::generate_mipmaps_rect(job->maps[p_index], job->rects[p_index]);
+}
+
+/**
+ * Brings color map mipmaps up to date before upload. Maps without mipmaps get a full chain, and
+ * maps marked by _set_color_mipmaps_dirty() only their stale pixels. Other maps keep their chain,
+ * so rebuilding the texture array doesn't regenerate every region.
+ * Queries may be reading the maps, so mipmaps are generated into copies, whose data is then
+ * swapped in under the write lock.
+ */
+void Terrain3DStorage::_update_color_mipmaps() {
+	MipmapJob job;
+	Vector<Ref<Image>> targets;
+	for (int i = 0; i < _color_maps.size() && i < _region_offsets.size(); i++) {
+		Ref<Image> map = _color_maps[i];
+		if (map.is_null() || map->is_empty()) {
+			continue;
+		}
+		Vector2i offset = _region_offsets[i];
+		if (!map->has_mipmaps()) {
+			job.rects.push_back(Rect2i(Vector2i(), map->get_size()));
+		} else if (_color_mipmap_rects.has(offset)) {
+			job.rects.push_back(_color_mipmap_rects[offset]);
+		} else {
+			continue;
+		}
+		targets.push_back(map);
+		job.maps.push_back(map->duplicate());
+	}
+	_color_mipmap_rects.clear();
+	if (job.maps.size() == 1) {
+		_mipmap_task(&job, 0);
+	} else if (job.maps.size() > 1) {
+		WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+		int64_t group_id = wtp->add_native_group_task(&Terrain3DStorage::_mipmap_task, &job, job.maps.size(), -1, true, "Terrain3DStorage mipmaps");
+		wtp->wait_for_group_task_completion(group_id);
+	}
+	if (!targets.is_empty()) {
+		WriteLock lock(_map_lock);
+		for (int i = 0; i < targets.size(); i++) {
+			const Ref<Image> &copy = job.maps[i];
+			targets[i]->set_data(copy->get_width(), copy->get_height(), copy->has_mipmaps(), copy->get_format(), copy->get_data());
+		}
+		_data_version++;
+	}
+	LOG(DEBUG_CONT, "Regenerated mipmaps of ", job.maps.size(), " of ", _color_maps.size(), " color maps");
+}
+
+/**
+ * Clips a ray to a rectangle on the XZ plane with the slab method, narrowing r_t0 and r_t1.
+ * Returns false if the ray misses the rectangle within that range.
+ */
+bool Terrain3DStorage::_clip_ray(const Vector3 &p_origin, const Vector3 &p_dir, Vector2 p_min, Vector2 p_max, real_t &r_t0, real_t &r_t1) {
+	for (int axis = 0; axis < 2; axis++) {
+		real_t o = (axis == 0) ? p_origin.x : p_origin.z;
+		real_t d = (axis == 0) ? p_dir.x : p_dir.z;
+		if (Math::abs(d) < CMP_EPSILON) {
+			if (o < p_min[axis] || o > p_max[axis]) {
+				return false;
+			}
+			continue;
+		}
+		real_t inv = 1.f / d;
+		real_t ta = (p_min[axis] - o) * inv;
+		real_t tb = (p_max[axis] - o) * inv;
+		if (ta > tb) {
+			SWAP(ta, tb);
+		}
+		r_t0 = MAX(r_t0, ta);
+		r_t1 = MIN(r_t1, tb);
+		if (r_t0 > r_t1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Intersects a ray with the bilinear height patch of one quad, matching get_height().
+ * The quad spans global pixels p_px to p_px + (1, 1). Heights along the ray are quadratic in t,
+ * so this solves exactly rather than stepping. Holes and quads missing a corner are skipped.
+ * Positions are descaled, so t is in world units.
+ */
+bool Terrain3DStorage::_raycast_quad(Vector2i p_px, const Vector3 &p_origin, const Vector3 &p_dir, real_t p_t0, real_t p_t1, real_t &r_t) const {
+	if (is_hole(_get_control_px(p_px))) {
+		return false;
+	}
+	real_t h00 = _get_height_px(p_px);
+	real_t h10 = _get_height_px(p_px + Vector2i(1, 0));
+	real_t h01 = _get_height_px(p_px + Vector2i(0, 1));
+	real_t h11 = _get_height_px(p_px + Vector2i(1, 1));
+	if (Math::is_nan(h00) || Math::is_nan(h10) || Math::is_nan(h01) || Math::is_nan(h11)) {
+		return false;
+	}
+	// Solve from the entry point for precision, with s = t - p_t0
+	Vector3 p = p_origin + p_dir * p_t0;
+	real_t u = p.x - real_t(p_px.x);
+	real_t v = p.z - real_t(p_px.y);
+	real_t b = h10 - h00;
+	real_t c = h01 - h00;
+	real_t d = h00 - h10 - h01 + h11;
+	// f(s) = ray height - patch height = qa*s^2 + qb*s + qc
+	real_t qa = -d * p_dir.x * p_dir.z;
+	real_t qb = p_dir.y - (b * p_dir.x + c * p_dir.z + d * (u * p_dir.z + v * p_dir.x));
+	real_t qc = p.y - (h00 + b * u + c * v + d * u * v);
+	real_t length = p_t1 - p_t0;
+	real_t s = -1.f;
+	if (qc <= 0.f) {
+		s = 0.f; // Entered the quad at or below the surface
+	} else if (Math::abs(qa) < CMP_EPSILON) {
+		if (Math::abs(qb) > CMP_EPSILON) {
+			s = -qc / qb;
+		}
+	} else {
+		real_t disc = qb * qb - 4.f * qa * qc;
+		if (disc >= 0.f) {
+			real_t q = -0.5f * (qb + SIGN(qb) * Math::sqrt(disc));
+			real_t s0 = (q != 0.f) ? q / qa : -1.f;
+			real_t s1 = (q != 0.f) ? qc / q : -1.f;
+			if (s0 > s1) {
+				SWAP(s0, s1);
+			}
+			s = (s0 >= 0.f) ? s0 : s1;
+		}
+	}
+	if (s < 0.f || s > length) {
+		return false;
+	}
+	r_t = p_t0 + s;
+	return true;
+}
+
+// Steps through the quads from p_min to p_max (exclusive) that the ray crosses, returning the first hit or -1
+real_t Terrain3DStorage::_raycast_leaf(Vector2i p_min, Vector2i p_max, const Vector3 &p_origin, const Vector3 &p_dir, real_t p_t0, real_t p_t1) const {
+	Vector3 p = p_origin + p_dir * p_t0;
+	Vector2i cell = Vector2i(int(Math::floor(p.x)), int(Math::floor(p.z)));
+	cell = Vector2i(CLAMP(cell.x, p_min.x, p_max.x - 1), CLAMP(cell.y, p_min.y, p_max.y - 1));
+	Vector2i step = Vector2i(p_dir.x > 0.f ? 1 : -1, p_dir.z > 0.f ? 1 : -1);
+	real_t t_delta_x = (p_dir.x != 0.f) ? Math::abs(1.f / p_dir.x) : real_t(FLT_MAX);
+	real_t t_delta_z = (p_dir.z != 0.f) ? Math::abs(1.f / p_dir.z) : real_t(FLT_MAX);
+	real_t t_max_x = (p_dir.x != 0.f) ? (real_t(cell.x + (step.x > 0 ? 1 : 0)) - p_origin.x) / p_dir.x : real_t(FLT_MAX);
+	real_t t_max_z = (p_dir.z != 0.f) ? (real_t(cell.y + (step.y > 0 ? 1 : 0)) - p_origin.z) / p_dir.z : real_t(FLT_MAX);
+	real_t t = p_t0;
+	while (t <= p_t1) {
+		real_t t_next = MIN(MIN(t_max_x, t_max_z), p_t1);
+		real_t hit;
+		if (_raycast_quad(cell, p_origin, p_dir, t, t_next, hit)) {
+			return hit;
+		}
+		if (t_next >= p_t1) {
+			break;
+		}
+		if (t_max_x < t_max_z) {
+			cell.x += step.x;
+			t_max_x += t_delta_x;
+		} else {
+			cell.y += step.y;
+			t_max_z += t_delta_z;
+		}
+		if (cell.x < p_min.x || cell.y < p_min.y || cell.x >= p_max.x || cell.y >= p_max.y) {
+			break;
+		}
+		t = t_next;
+	}
+	return -1.f;
+}
+
+/**
+ * Finds the first hit within one region by descending its height pyramid. Nodes are visited
+ * near to far and skipped if the ray's height over the node is entirely above or below it.
+ * Nodes on the far edges also cover quads reaching into the neighboring region, which the
+ * pyramid doesn't bound, so those are never skipped by height.
+ */
+real_t Terrain3DStorage::_raycast_region(int p_region, const Vector3 &p_origin, const Vector3 &p_dir, real_t p_t0, real_t p_t1) const {
+	const HeightPyramid &pyramid = _height_pyramids[p_region];
+	if (!pyramid.is_valid()) {
+		return -1.f;
+	}
+	int rs = _region_size;
+	Vector2i region_px = _sampler_offsets[p_region] * rs;
+
+	struct Entry {
+		int level;
+		int x;
+		int y;
+	};
+	Entry stack[4 * HeightPyramid::MAX_LEVELS];
+	int top = 0;
+	stack[top++] = { pyramid.get_level_count() - 1, 0, 0 };
+	real_t best = -1.f;
+	while (top > 0) {
+		Entry e = stack[--top];
+		int ns = pyramid.get_node_size(e.level);
+		Vector2i node_min = region_px + Vector2i(e.x, e.y) * ns;
+		Vector2i node_max = node_min + Vector2i(ns, ns);
+		real_t ta = p_t0;
+		real_t tb = (best >= 0.f) ? best : p_t1;
+		if (!_clip_ray(p_origin, p_dir, Vector2(node_min), Vector2(node_max), ta, tb)) {
+			continue;
+		}
+		bool far_edge = (e.x + 1) * ns >= rs || (e.y + 1) * ns >= rs;
+		if (!far_edge) {
+			HeightPyramid::Node node = pyramid.get_node(e.level, e.x, e.y);
+			real_t ya = p_origin.y + p_dir.y * ta;
+			real_t yb = p_origin.y + p_dir.y * tb;
+			if (MIN(ya, yb) > node.max || MAX(ya, yb) < node.min) {
+				continue;
+			}
+		}
+		if (e.level == 0) {
+			real_t hit = _raycast_leaf(node_min, node_max, p_origin, p_dir, ta, tb);
+			if (hit >= 0.f && (best < 0.f || hit < best)) {
+				best = hit;
+			}
+			continue;
+		}
+		// Push children far to near, so the nearest is processed first
+		int child_level = e.level - 1;
+		Entry children[4];
+		real_t entry_t[4];
+		int count = 0;
+		int child_ns = pyramid.get_node_size(child_level);
+		for (int cy = e.y * 2; cy <= e.y * 2 + 1; cy++) {
+			for (int cx = e.x * 2; cx <= e.x * 2 + 1; cx++) {
+				Vector2i child_min = region_px + Vector2i(cx, cy) * child_ns;
+				real_t ca = ta;
+				real_t cb = tb;
+				if (_clip_ray(p_origin, p_dir, Vector2(child_min), Vector2(child_min + Vector2i(child_ns, child_ns)), ca, cb)) {
+					children[count] = { child_level, cx, cy };
+					entry_t[count] = ca;
+					count++;
+				}
+			}
+		}
+		for (int i = 1; i < count; i++) {
+			for (int j = i; j > 0 && entry_t[j] > entry_t[j - 1]; j--) {
+				SWAP(entry_t[j], entry_t[j - 1]);
+				SWAP(children[j], children[j - 1]);
+			}
+		}
+		for (int i = 0; i < count; i++) {
+			stack[top++] = children[i];
+		}
+	}
+	return best;
+}
+
+/**
+ * Re-slices all region maps into regions of p_size. Every pixel keeps its global position, so
+ * the terrain is unchanged. Shrinking splits each region into several, growing merges
+ * neighbors and pads any area not covered by an old region with the default map values.
+ */
+Error Terrain3DStorage::_resize_regions(RegionSize p_size) {
+	int old_size = _region_size;
+	int new_size = p_size;
+	LOG(INFO, "Re-slicing ", _region_offsets.size(), " regions from ", old_size, " to ", new_size);
+	if (_region_map_dirty) {
+		update_regions();
+	}
+
+	// Collect the new regions covering all old ones, in old region order
+	TypedArray<Vector2i> new_offsets;
+	Dictionary new_offset_set;
+	for (int i = 0; i < _region_offsets.size(); i++) {
+		Vector2i px = Vector2i(_region_offsets[i]) * old_size;
+		Vector2i from = Vector2i(floor_div(px.x, new_size), floor_div(px.y, new_size));
+		Vector2i to = Vector2i(floor_div(px.x + old_size - 1, new_size), floor_div(px.y + old_size - 1, new_size));
+		if (ABS(from.x) > REGION_OFFSET_MAX || ABS(from.y) > REGION_OFFSET_MAX ||
+				ABS(to.x) > REGION_OFFSET_MAX || ABS(to.y) > REGION_OFFSET_MAX) {
+			LOG(ERROR, "Region ", _region_offsets[i], " would be outside of the maximum world size at region size ", new_size);
+			return FAILED;
+		}
+		for (int y = from.y; y <= to.y; y++) {
+			for (int x = from.x; x <= to.x; x++) {
+				Vector2i offset = Vector2i(x, y);
+				if (!new_offset_set.has(offset)) {
+					new_offset_set[offset] = true;
+					new_offsets.push_back(offset);
+				}
+			}
+		}
+	}
+	RegionMap new_map;
+	new_map.build(new_offsets);
+	if (!RegionMap::fits(new_map.get_bounds())) {
+		LOG(ERROR, "Regions would span ", new_map.get_bounds().size, " at region size ", new_size,
+				", exceeding the maximum of ", RegionMap::get_max_size());
+		return FAILED;
+	}
+	if (new_offsets.size() > 2048) {
+		LOG(WARN, new_offsets.size(), " regions may exceed the GPU's texture array layer limit");
+	}
+
+	// Build the new maps by blitting in the overlapping part of each old region
+	Vector2i new_sizev = Vector2i(new_size, new_size);
+	TypedArray<Image> new_maps[TYPE_MAX];
+	for (int n = 0; n < new_offsets.size(); n++) {
+		Vector2i px = Vector2i(new_offsets[n]) * new_size;
+		Rect2i new_rect = Rect2i(px, new_sizev);
+		Ref<Image> images[TYPE_MAX];
+		for (int t = 0; t < TYPE_MAX; t++) {
+			images[t] = Util::get_filled_image(new_sizev, COLOR[t], false, _get_format(static_cast<MapType>(t)));
+		}
+		Vector2i from = Vector2i(floor_div(px.x, old_size), floor_div(px.y, old_size));
+		Vector2i to = Vector2i(floor_div(px.x + new_size - 1, old_size), floor_div(px.y + new_size - 1, old_size));
+		for (int y = from.y; y <= to.y; y++) {
+			for (int x = from.x; x <= to.x; x++) {
+				int index = _region_map.get(Vector2i(x, y));
+				if (index < 0) {
+					continue;
+				}
+				Rect2i old_rect = Rect2i(Vector2i(x, y) * old_size, Vector2i(old_size, old_size));
+				Rect2i overlap = new_rect.intersection(old_rect);
+				for (int t = 0; t < TYPE_MAX; t++) {
+					images[t]->blit_rect(get_map_region(static_cast<MapType>(t), index),
+							Rect2i(overlap.position - old_rect.position, overlap.size), overlap.position - px);
+				}
+			}
+		}
+		for (int t = 0; t < TYPE_MAX; t++) {
+			new_maps[t].push_back(images[t]);
+		}
+	}
+	LOG(INFO, "Re-sliced into ", new_offsets.size(), " regions");
+
+	{
+		// Queries find no regions until update_regions() samples the new maps
+		WriteLock lock(_map_lock);
+		_region_size = p_size;
+		_region_sizev = new_sizev;
+		_region_map.clear();
+		_sampler_offsets.clear();
+		_data_version++;
+	}
+	_region_offsets = new_offsets;
+	_height_maps = new_maps[TYPE_HEIGHT];
+	_control_maps = new_maps[TYPE_CONTROL];
+	_color_maps = new_maps[TYPE_COLOR];
+	_region_map_dirty = true;
+	_generated_height_maps.clear();
+	_generated_control_maps.clear();
+	_generated_color_maps.clear();
+	emit_signal("region_size_changed", _region_size);
+	update_regions();
+	notify_property_list_changed();
+	emit_changed();
+	return OK;
+}
+
+/**
+ * Finds all region files and containers in the streaming directory. Containers are opened,
+ * which only reads their index. Region files take priority over a container holding the same region.
+ */
+void Terrain3DStorage::_scan_stream_files() {
+	_cancel_stream_jobs();
+	_stream_files.clear();
+	for (int i = 0; i < _stream_containers.size(); i++) {
+		memdelete(_stream_containers[i]);
+	}
+	_stream_containers.clear();
+	if (_streaming_directory.is_empty()) {
+		return;
+	}
+	// Regions removed by an incremental save may still be in containers, but not in the index
+	TypedArray<Vector2i> index_offsets;
+	bool has_index = RegionFile::load_index(_streaming_directory, index_offsets) == OK;
+	Dictionary index;
+	for (int i = 0; i < index_offsets.size(); i++) {
+		index[index_offsets[i]] = true;
+	}
+	PackedStringArray files = DirAccess::get_files_at(_streaming_directory);
+	for (int i = 0; i < files.size(); i++) {
+		if (files[i].get_extension() != RegionContainer::EXTENSION) {
+			continue;
+		}
+		RegionContainer *container = memnew(RegionContainer);
+		if (container->open(_streaming_directory.path_join(files[i])) != OK) {
+			memdelete(container);
+			continue;
+		}
+		if (container->get_region_size() != _region_size) {
+			LOG(ERROR, "Region container size ", container->get_region_size(), " doesn't match region size ", _region_size, ": ", files[i]);
+			memdelete(container);
+			continue;
+		}
+		int container_id = _stream_containers.size();
+		_stream_containers.push_back(container);
+		for (int r = 0; r < container->get_region_count(); r++) {
+			if (!has_index || index.has(container->get_region_offset(r))) {
+				_stream_files[container->get_region_offset(r)] = Vector2i(container_id, r);
+			}
+		}
+	}
+	for (int i = 0; i < files.size(); i++) {
+		Vector2i offset;
+		if (RegionFile::parse_file_name(files[i], offset) && (!has_index || index.has(offset))) {
+			_stream_files[offset] = _streaming_directory.path_join(files[i]);
+		}
+	}
+	_stream_last_position = Vector2(FLT_MAX, FLT_MAX);
+	LOG(INFO, "Found ", _stream_files.size(), " region files in ", _streaming_directory);
+}
+
+// Waits for and discards loads in progress
+void Terrain3DStorage::_cancel_stream_jobs() {
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	for (int i = 0; i < _stream_jobs.size(); i++) {
+		wtp->wait_for_task_completion(_stream_jobs[i]->task_id);
+		memdelete(_stream_jobs[i]);
+	}
+	_stream_jobs.clear();
+}
+
+// Runs on the WorkerThreadPool. Only touches the job
+void Terrain3DStorage::_stream_load_task(void *p_job) {
+	StreamJob *job = static_cast<StreamJob *>(p_job);
+	if (job->container) {
+		job->error = job->container->load_region(job->container_index, job->maps);
+	} else {
+		job->error = RegionFile::load(job->path, job->region_size, job->maps);
+	}
+}
+
+/**
+ * Removes the regions in p_unloaded and appends p_loaded (offset -> sanitized maps) in one pass
+ * over the region arrays, without rebuilding anything, so update_streaming() can call
+ * update_regions() once. Loaded regions outside the world or the region map span are dropped.
+ * Returns the offsets added.
+ */
+TypedArray<Vector2i> Terrain3DStorage::_swap_streamed_regions(const Dictionary &p_loaded, const Dictionary &p_unloaded) {
+	TypedArray<Vector2i> offsets;
+	TypedArray<Image> height_maps;
+	TypedArray<Image> control_maps;
+	TypedArray<Image> color_maps;
+	Rect2i bounds;
+	for (int i = 0; i < _region_offsets.size(); i++) {
+		Vector2i offset = _region_offsets[i];
+		if (p_unloaded.has(offset)) {
+			continue;
+		}
+		bounds = offsets.is_empty() ? Rect2i(offset, Vector2i(1, 1)) : bounds.expand(offset).expand(offset + Vector2i(1, 1));
+		offsets.push_back(offset);
+		height_maps.push_back(_height_maps[i]);
+		control_maps.push_back(_control_maps[i]);
+		color_maps.push_back(_color_maps[i]);
+	}
+
+	TypedArray<Vector2i> added;
+	Array loaded = p_loaded.keys();
+	for (int i = 0; i < loaded.size(); i++) {
+		Vector2i offset = loaded[i];
+		Rect2i new_bounds = offsets.is_empty() ? Rect2i(offset, Vector2i(1, 1)) : bounds.expand(offset).expand(offset + Vector2i(1, 1));
+		if (ABS(offset.x) > REGION_OFFSET_MAX || ABS(offset.y) > REGION_OFFSET_MAX || !RegionMap::fits(new_bounds)) {
+			LOG(ERROR, "Streamed region ", offset, " is outside the world or too far from the other regions. Regions may span at most ",
+					RegionMap::get_max_size(), " regions on either axis");
+			continue;
+		}
+		TypedArray<Image> maps = p_loaded[offset];
+		bounds = new_bounds;
+		offsets.push_back(offset);
+		height_maps.push_back(maps[TYPE_HEIGHT]);
+		control_maps.push_back(maps[TYPE_CONTROL]);
+		color_maps.push_back(maps[TYPE_COLOR]);
+		added.push_back(offset);
+	}
+
+	_region_offsets = offsets;
+	_height_maps = height_maps;
+	_control_maps = control_maps;
+	_color_maps = color_maps;
+	_region_map_dirty = true;
+	return added;
+}
+
+// Distance on the XZ plane from a position to the nearest edge of a region, 0 if inside
+real_t Terrain3DStorage::_get_region_distance(Vector2i p_offset, Vector2 p_global_xz) const {
+	real_t size = real_t(_region_size) * _mesh_vertex_spacing;
+	Vector2 start = Vector2(p_offset) * size;
+	Vector2 end = start + Vector2(size, size);
+	real_t dx = MAX(MAX(start.x - p_global_xz.x, p_global_xz.x - end.x), 0.f);
+	real_t dz = MAX(MAX(start.y - p_global_xz.y, p_global_xz.y - end.y), 0.f);
+	return Math::sqrt(dx * dx + dz * dz);
+}
+
+// Removing a region overrides earlier modifications, and adding one again overrides removal
+void Terrain3DStorage::_set_region_modified(Vector2i p_region_offset, int p_map_bits) {
+	int bits = (p_map_bits & REGION_REMOVED) ? REGION_REMOVED : (int(_modified_regions.get(p_region_offset, 0)) & ~REGION_REMOVED) | p_map_bits;
+	_modified_regions[p_region_offset] = bits;
+	_modified = true;
+}
+
+// Returns the regions saved in a directory as a set. Without an index, all region files count
+Dictionary Terrain3DStorage::_get_region_index(const String &p_directory) {
+	Dictionary index;
+	TypedArray<Vector2i> offsets;
+	if (RegionFile::load_index(p_directory, offsets) == OK) {
+		for (int i = 0; i < offsets.size(); i++) {
+			index[offsets[i]] = true;
+		}
+		return index;
+	}
+	PackedStringArray files = DirAccess::get_files_at(p_directory);
+	for (int i = 0; i < files.size(); i++) {
+		Vector2i offset;
+		if (RegionFile::parse_file_name(files[i], offset)) {
+			index[offset] = true;
+		} else if (files[i].get_extension() == RegionContainer::EXTENSION) {
+			RegionContainer container;
+			if (container.open(p_directory.path_join(files[i])) == OK) {
+				for (int r = 0; r < container.get_region_count(); r++) {
+					index[container.get_region_offset(r)] = true;
+				}
+			}
+		}
+	}
+	return index;
+}
+
+Error Terrain3DStorage::_update_region_index(const String &p_directory, const TypedArray<Vector2i> &p_saved, const TypedArray<Vector2i> &p_removed) {
+	Dictionary index = _get_region_index(p_directory);
+	for (int i = 0; i < p_saved.size(); i++) {
+		index[p_saved[i]] = true;
+	}
+	for (int i = 0; i < p_removed.size(); i++) {
+		index.erase(p_removed[i]);
+	}
+	TypedArray<Vector2i> offsets;
+	Array keys = index.keys();
+	for (int i = 0; i < keys.size(); i++) {
+		offsets.push_back(keys[i]);
+	}
+	return RegionFile::save_index(p_directory, offsets);
+}
+
+/**
+ * Snapshots what a save writes: the settings and maps for the resource at p_path, and the
+ * regions to write as files to p_directory. Either may be empty. Takes the modified marks and
+ * flag, so edits from here on count for the next save.
+ */
+Terrain3DStorage::SaveJob *Terrain3DStorage::_create_save_job(const String &p_path, const String &p_directory) {
+	SaveJob *job = memnew(SaveJob);
+	job->storage = this;
+	job->id = ++_save_job_id;
+	job->path = p_path;
+	job->directory = p_directory;
+	job->region_size = _region_size;
+
+	if (!p_directory.is_empty()) {
+		Dictionary index = _get_region_index(p_directory);
+		for (int i = 0; i < _region_offsets.size(); i++) {
+			Vector2i offset = _region_offsets[i];
+			if (index.has(offset) && !_modified_regions.has(offset)) {
+				continue;
+			}
+			TypedArray<Image> maps;
+			maps.push_back(Ref<Image>(_height_maps[i])->duplicate());
+			maps.push_back(Ref<Image>(_control_maps[i])->duplicate());
+			maps.push_back(Ref<Image>(_color_maps[i])->duplicate());
+			job->offsets.push_back(offset);
+			job->maps.push_back(maps);
+		}
+		Array modified = _modified_regions.keys();
+		for (int i = 0; i < modified.size(); i++) {
+			Vector2i offset = modified[i];
+			if ((int(_modified_regions[offset]) & REGION_REMOVED) && index.has(offset)) {
+				job->removed.push_back(offset);
+			}
+		}
+		job->modified_regions = _modified_regions;
+		_modified_regions = Dictionary();
+	}
+
+	if (!p_path.is_empty()) {
+		Ref<Terrain3DStorage> snapshot;
+		snapshot.instantiate();
+		snapshot->_version = _version;
+		snapshot->_save_16_bit = _save_16_bit;
+		snapshot->_resident_16_bit = _resident_16_bit;
+		snapshot->_save_compressed = _save_compressed;
+		snapshot->_region_size = _region_size;
+		snapshot->_region_sizev = _region_sizev;
+		snapshot->_height_range = get_height_range();
+		snapshot->_streaming_enabled = _streaming_enabled;
+		snapshot->_streaming_directory = _streaming_directory;
+		snapshot->_stream_load_radius = _stream_load_radius;
+		snapshot->_stream_unload_radius = _stream_unload_radius;
+		// Regions saved to a directory aren't kept in the resource
+		if (p_directory.is_empty()) {
+			snapshot->_region_offsets = _region_offsets.duplicate();
+			TypedArray<Image> *maps[] = { &snapshot->_height_maps, &snapshot->_control_maps, &snapshot->_color_maps };
+			for (int t = 0; t < TYPE_MAX; t++) {
+				TypedArray<Image> live_maps = get_maps(static_cast<MapType>(t));
+				for (int i = 0; i < live_maps.size(); i++) {
+					maps[t]->push_back(Ref<Image>(live_maps[i])->duplicate());
+				}
+			}
+		}
+		job->snapshot = snapshot;
+		_modified = false;
+	}
+	return job;
+}
+
+/**
+ * Writes the region files of a SaveJob and prepares its snapshot. Runs on the WorkerThreadPool
+ * for background saves, so only touches the job. The snapshot is given to ResourceSaver by
+ * _finish_save_job() on the main thread, as the editor updates its filesystem on each save.
+ */
+void Terrain3DStorage::_write_save_job(SaveJob *p_job) {
+	uint64_t start = Time::get_singleton()->get_ticks_msec();
+	int steps = p_job->offsets.size() + (p_job->snapshot.is_valid() ? 2 : 0) + 1;
+	int step = 0;
+	auto progress = [p_job, steps, &step]() {
+		step++;
+		if (p_job->background) {
+			p_job->storage->call_deferred("emit_signal", "save_progress", real_t(step) / real_t(steps));
+		} else {
+			p_job->storage->emit_signal("save_progress", real_t(step) / real_t(steps));
+		}
+	};
+
+	if (!p_job->directory.is_empty()) {
+		p_job->error = DirAccess::make_dir_recursive_absolute(p_job->directory);
+		if (p_job->error != OK) {
+			LOG(ERROR, "Cannot create directory: ", p_job->directory);
+			return;
+		}
+		for (int i = 0; i < p_job->offsets.size(); i++) {
+			Vector2i offset = p_job->offsets[i];
+			p_job->error = RegionFile::save(p_job->directory.path_join(RegionFile::get_file_name(offset)), offset, p_job->region_size, p_job->maps[i]);
+			if (p_job->error != OK) {
+				LOG(ERROR, "Failed to save region ", offset, ", error: ", p_job->error);
+				return;
+			}
+			progress();
+		}
+		// The index is replaced in one step once all region files are written
+		p_job->error = _update_region_index(p_job->directory, p_job->offsets, p_job->removed);
+		if (p_job->error != OK) {
+			LOG(ERROR, "Failed to update region index in ", p_job->directory, ", error: ", p_job->error);
+			return;
+		}
+		for (int i = 0; i < p_job->removed.size(); i++) {
+			String path = p_job->directory.path_join(RegionFile::get_file_name(p_job->removed[i]));
+			if (FileAccess::file_exists(path)) {
+				DirAccess::remove_absolute(path);
+			}
+		}
+		LOG(INFO, "Saved ", p_job->offsets.size(), " regions, removed ", p_job->removed.size(), ", in ",
+				Time::get_singleton()->get_ticks_msec() - start, " ms to ", p_job->directory);
+	}
+
+	Ref<Terrain3DStorage> snapshot = p_job->snapshot;
+	if (snapshot.is_valid()) {
+		// The snapshot's maps are its own, so they can be converted without restoring them after
+		if (snapshot->_save_16_bit && !snapshot->_resident_16_bit) {
+			LOG(DEBUG, "16-bit save requested, converting heightmaps");
+			for (int i = 0; i < snapshot->_height_maps.size(); i++) {
+				Ref<Image> img = snapshot->_height_maps[i];
+				img->convert(Image::FORMAT_RH);
+			}
+		}
+		if (snapshot->_save_compressed && !snapshot->_region_offsets.is_empty()) {
+			Array data = snapshot->compress_regions();
+			// The maps are stored in compressed_regions instead, so ResourceSaver needn't compress
+			if (data.size() == snapshot->_region_offsets.size()) {
+				snapshot->_compressed_regions = data;
+				snapshot->_height_maps = TypedArray<Image>();
+				snapshot->_control_maps = TypedArray<Image>();
+				snapshot->_color_maps = TypedArray<Image>();
+				p_job->compressed = true;
+			}
+		}
+		progress();
+	}
+	progress();
+}
+
+void Terrain3DStorage::_save_task(void *p_job) {
+	SaveJob *job = static_cast<SaveJob *>(p_job);
+	_write_save_job(job);
+	if (job->background) {
+		callable_mp(job->storage, &Terrain3DStorage::_finish_save).call_deferred(job->id);
+	}
+}
+
+// Saves the snapshot of a written SaveJob, applies the result on the main thread and frees it
+Error Terrain3DStorage::_finish_save_job(SaveJob *p_job) {
+	if (p_job->error == OK && p_job->snapshot.is_valid()) {
+		LOG(DEBUG, "Saving snapshot to ", p_job->path, ", compressed regions: ", p_job->compressed ? "yes" : "no");
+		p_job->error = ResourceSaver::get_singleton()->save(p_job->snapshot, p_job->path,
+				p_job->compressed ? ResourceSaver::FLAG_NONE : ResourceSaver::FLAG_COMPRESS);
+		LOG(DEBUG, "ResourceSaver return error (0 is OK): ", p_job->error);
+		if (p_job->error == OK) {
+			emit_signal("save_progress", 1.f);
+		}
+	}
+	Error err = p_job->error;
+	if (err != OK) {
+		LOG(ERROR, "Failed to save terrain data, error: ", err);
+		// Restore the marks taken by the job. Marks made since are newer, and removal overrides edits
+		Array offsets = p_job->modified_regions.keys();
+		for (int i = 0; i < offsets.size(); i++) {
+			int bits = p_job->modified_regions[offsets[i]];
+			if (_modified_regions.has(offsets[i])) {
+				int current = _modified_regions[offsets[i]];
+				bits = ((current | bits) & REGION_REMOVED) ? current : current | bits;
+			}
+			_modified_regions[offsets[i]] = bits;
+		}
+		if (p_job->snapshot.is_valid() || !offsets.is_empty()) {
+			_modified = true;
+		}
+	} else {
+		if (_streaming_enabled && !p_job->directory.is_empty() && p_job->directory == _streaming_directory) {
+			// Every region now has a file, or is modified and stays loaded, so all may be streamed out
+			for (int i = 0; i < _region_offsets.size(); i++) {
+				_streamed_regions[_region_offsets[i]] = true;
+			}
+			_scan_stream_files();
+		}
+		if (p_job->snapshot.is_valid()) {
+			LOG(INFO, "Finished saving terrain data");
+		}
+	}
+	emit_signal("save_finished", err);
+	memdelete(p_job);
+	return err;
+}
+
+/**
+ * Returns true if a background save is writing or removing the region's file. Its modified mark
+ * was taken by the save, so streaming must neither unload it, nor load its old file, until done.
+ */
+bool Terrain3DStorage::_is_region_saving(Vector2i p_region_offset) const {
+	return _save_job != nullptr && !_save_job->directory.is_empty() &&
+			(_save_job->modified_regions.has(p_region_offset) || _save_job->offsets.has(p_region_offset));
+}
+
+// Called deferred by background saves once written
+void Terrain3DStorage::_finish_save(int p_id) {
+	if (_save_job == nullptr || _save_job->id != p_id) {
+		return;
+	}
+	_wait_for_save();
+}
+
+// Finishes a background save, waiting for it if still being written
+void Terrain3DStorage::_wait_for_save() {
+	if (_save_job == nullptr) {
+		return;
+	}
+	SaveJob *job = _save_job;
+	_save_job = nullptr;
+	WorkerThreadPool::get_singleton()->wait_for_task_completion(job->task_id);
+	_finish_save_job(job);
+}
+
+/**
+ * Calls p_func(index, position) for every position, used by the batched query functions.
+ * Points are visited in region order so consecutive lookups hit the same region memory.
+ * Large batches are split into BATCH_CHUNK_SIZE chunks and run on the WorkerThreadPool.
+ * p_func runs with the read lock held. It must only read storage data, through the unlocked
+ * private functions, and write to its own output index.
+ */
+template <typename TFunc>
+void Terrain3DStorage::_process_batch(const PackedVector3Array &p_global_positions, TFunc p_func) {
+	int count = p_global_positions.size();
+	if (count == 0) {
+		return;
+	}
+	const Vector3 *positions = p_global_positions.ptr();
+
+	// Counting sort of point indices by region. Bucket 0 holds points outside of any region
+	ReadLock sort_lock(_map_lock);
+	int buckets = _sampler_offsets.size() + 1;
+	Vector<int> bucket_start;
+	bucket_start.resize(buckets + 1);
+	bucket_start.fill(0);
+	Vector<int> point_bucket;
+	point_bucket.resize(count);
+	int *start_ptr = bucket_start.ptrw();
+	int *bucket_ptr = point_bucket.ptrw();
+	for (int i = 0; i < count; i++) {
+		int region = _get_region_index_px(_get_px(positions[i]));
+		int bucket = (region >= 0 && region < buckets - 1) ? region + 1 : 0;
+		bucket_ptr[i] = bucket;
+		start_ptr[bucket + 1]++;
+	}
+	for (int b = 0; b < buckets; b++) {
+		start_ptr[b + 1] += start_ptr[b];
+	}
+	Vector<int> order;
+	order.resize(count);
+	int *order_ptr = order.ptrw();
+	for (int i = 0; i < count; i++) {
+		order_ptr[start_ptr[bucket_ptr[i]]++] = i;
+	}
+	// Not held while waiting for the chunks, which may queue behind readers blocked by a writer
+	sort_lock.unlock();
+
+	struct Batch {
+		const Vector3 *positions;
+		const int *order;
+		int count;
+		TFunc *func;
+		std::shared_mutex *lock;
+	} batch = { positions, order_ptr, count, &p_func, &_map_lock };
+
+	auto run_chunk = [](void *p_userdata, uint32_t p_chunk) {
+		const Batch *b = static_cast<const Batch *>(p_userdata);
+		ReadLock lock(*b->lock);
+		int end = MIN(int(p_chunk + 1) * BATCH_CHUNK_SIZE, b->count);
+		for (int j = int(p_chunk) * BATCH_CHUNK_SIZE; j < end; j++) {
+			int i = b->order[j];
+			(*b->func)(i, b->positions[i]);
+		}
+	};
+
+	int chunks = (count + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+	if (chunks == 1) {
+		run_chunk(&batch, 0);
+		return;
+	}
+	LOG(DEBUG_CONT, "Processing ", count, " queries in ", chunks, " chunks");
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	int64_t task_id = wtp->add_native_group_task(run_chunk, &batch, chunks, -1, true, "Terrain3DStorage batch query");
+	wtp->wait_for_group_task_completion(task_id);
+}
+
+// Encodes or decodes one region. Each task only touches its own slot of the job arrays
+void Terrain3DStorage::_codec_task(void *p_job, uint32_t p_index) {
+	CodecJob *job = static_cast<CodecJob *>(p_job);
+	if (job->encode) {
+		Vector<RegionCodec::Filter> filters;
+		for (int i = 0; i < TYPE_MAX; i++) {
+			filters.push_back(CODEC_FILTER[i]);
+		}
+		job->data[p_index] = RegionCodec::encode(job->maps[p_index], filters);
+		job->errors[p_index] = job->data[p_index].is_empty() ? ERR_INVALID_DATA : OK;
+	} else {
+		job->errors[p_index] = RegionCodec::decode(job->data[p_index], job->maps[p_index]);
+	}
+}
 
-#include "logger.h"
-#include "terrain_3d_storage.h"
+// Runs on the WorkerThreadPool. Builds the maps of one slice, padded with blank texels
+void Terrain3DStorage::_import_task(void *p_job, uint32_t p_index) {
+	const ImportJob *job = static_cast<const ImportJob *>(p_job);
+	int size = job->region_size;
+	Vector2i start = Vector2i(p_index % job->slices_width, p_index / job->slices_width) * size;
+	Vector2i copy_size = Vector2i(MIN(size, job->img_size.x - start.x), MIN(size, job->img_size.y - start.y));
+	bool transform = job->offset != 0.f || job->scale != 1.f;
+	for (int t = 0; t < TYPE_MAX; t++) {
+		PackedByteArray data;
+		data.resize(int64_t(size) * size * sizeof(uint32_t));
+		uint32_t *dst = reinterpret_cast<uint32_t *>(data.ptrw());
+		const uint32_t *src = reinterpret_cast<const uint32_t *>(job->sources[t]);
+		uint32_t fill = job->fill[t];
+		for (int y = 0; y < size; y++) {
+			uint32_t *row = dst + int64_t(y) * size;
+			int x = 0;
+			if (src && y < copy_size.y) {
+				const uint32_t *src_row = src + int64_t(start.y + y) * job->img_size.x + start.x;
+				if (t == TYPE_HEIGHT && transform) {
+					Util::scale_floats(reinterpret_cast<const float *>(src_row), copy_size.x, float(job->scale), float(job->offset),
+							reinterpret_cast<float *>(row));
+				} else {
+					memcpy(row, src_row, copy_size.x * sizeof(uint32_t));
+				}
+				x = copy_size.x;
+			}
+			for (; x < size; x++) {
+				row[x] = fill;
+			}
+		}
+		job->maps[p_index * TYPE_MAX + t] = Image::create_from_data(size, size, false, FORMAT[t], data);
+	}
+}
 
-///////////////////////////
-// Private Functions
-///////////////////////////
+// Checks that an import of p_size pixels fits on the region map at p_global_position
+bool Terrain3DStorage::_check_import_area(Vector3 p_global_position, Vector2i p_size) const {
+	Vector3 descaled_position = p_global_position / _mesh_vertex_spacing;
+	int max_dimension = _region_size * REGION_OFFSET_MAX;
+	if ((abs(descaled_position.x) > max_dimension) || (abs(descaled_position.z) > max_dimension)) {
+		LOG(ERROR, "Specify a position within +/-", Vector3(max_dimension, 0.f, max_dimension) * _mesh_vertex_spacing);
+		return false;
+	}
+	if ((descaled_position.x + p_size.x > max_dimension) ||
+			(descaled_position.z + p_size.y > max_dimension)) {
+		LOG(ERROR, p_size, " image will not fit at ", p_global_position,
+				". Try ", -(p_size * _mesh_vertex_spacing) / 2.f, " to center");
+		return false;
+	}
+	Vector2 px = Vector2(descaled_position.x, descaled_position.z);
+	Vector2i from = Vector2i((px / real_t(_region_size)).floor());
+	Vector2i to = Vector2i(((px + Vector2(p_size - Vector2i(1, 1))) / real_t(_region_size)).floor());
+	Rect2i bounds = Rect2i(from, to - from + Vector2i(1, 1));
+	if (_region_map.size() > 0) {
+		bounds = bounds.merge(_region_map.get_bounds());
+	}
+	if (!RegionMap::fits(bounds)) {
+		LOG(ERROR, p_size, " image at ", p_global_position, " would make regions span ", bounds.size,
+				", exceeding the maximum of ", RegionMap::get_max_size());
+		return false;
+	}
+	return true;
+}
 
-void Terrain3DStorage::_clear() {
-	LOG(INFO, "Clearing storage");
-	_region_map_dirty = true;
-	_region_map.clear();
-	_generated_height_maps.clear();
-	_generated_control_maps.clear();
-	_generated_color_maps.clear();
+// Returns region offset -> index, for adding many regions without rebuilding the region map
+Dictionary Terrain3DStorage::_get_region_indices() const {
+	Dictionary indices;
+	for (int i = 0; i < _region_offsets.size(); i++) {
+		indices[_region_offsets[i]] = i;
+	}
+	return indices;
+}
+
+/**
+ * Adds or replaces a region without updating the region map or texture arrays. The caller
+ * must do that once all regions are added. r_indices is from _get_region_indices() and is updated.
+ */
+void Terrain3DStorage::_add_imported_region(Vector2i p_region_offset, const TypedArray<Image> &p_maps, Dictionary &r_indices) {
+	// Creates blank maps and converts heights if resident in 16-bit
+	TypedArray<Image> images = sanitize_maps(TYPE_MAX, p_maps);
+	if (images.is_empty()) {
+		LOG(ERROR, "Sanitize_maps failed to accept images for region ", p_region_offset);
+		return;
+	}
+	if (r_indices.has(p_region_offset)) {
+		int index = r_indices[p_region_offset];
+		LOG(DEBUG, "Region ", p_region_offset, " already exists, overwriting");
+		_height_maps[index] = images[TYPE_HEIGHT];
+		_control_maps[index] = images[TYPE_CONTROL];
+		_color_maps[index] = images[TYPE_COLOR];
+	} else {
+		r_indices[p_region_offset] = _region_offsets.size();
+		_height_maps.push_back(images[TYPE_HEIGHT]);
+		_control_maps.push_back(images[TYPE_CONTROL]);
+		_color_maps.push_back(images[TYPE_COLOR]);
+		_region_offsets.push_back(p_region_offset);
+	}
+	_set_region_modified(p_region_offset, REGION_ALL_MAPS);
+}
+
+// Converts heights to little endian, unsigned 16-bit, mapping p_min to 0 and scaling by p_scale
+void Terrain3DStorage::_encode_r16(const HeightPyramid::Heights &p_heights, int p_count, float p_min, float p_scale, uint8_t *r_dst) {
+	for (int i = 0; i < p_count; i++) {
+		int h = CLAMP(int((p_heights.get(i) - p_min) * p_scale), 0, 65535);
+		r_dst[i * 2] = uint8_t(h & 0xFF);
+		r_dst[i * 2 + 1] = uint8_t(h >> 8);
+	}
+}
+
+// Runs on the WorkerThreadPool. Writes one slot of the destination, which no other task touches
+void Terrain3DStorage::_export_task(void *p_job, uint32_t p_index) {
+	const ExportJob *job = static_cast<const ExportJob *>(p_job);
+	int size = job->region_size;
+	Vector2i slot = Vector2i(p_index % job->slots.x, p_index / job->slots.x);
+	const uint8_t *src = job->sources[p_index];
+	int64_t src_row_size = int64_t(size) * job->src_pixel_size;
+	int64_t row_size = int64_t(size) * job->pixel_size;
+	for (int y = 0; y < size; y++) {
+		uint8_t *dst = job->dst + (int64_t(slot.y) * size + y) * job->dst_stride + slot.x * row_size;
+		if (src == nullptr) {
+			for (int x = 0; x < size; x++) {
+				memcpy(dst + x * job->pixel_size, job->fill, job->pixel_size);
+			}
+		} else if (job->r16) {
+			HeightPyramid::Heights heights;
+			heights.data = src + y * src_row_size;
+			heights.half = job->half;
+			_encode_r16(heights, size, job->height_min, job->height_scale, dst);
+		} else {
+			memcpy(dst, src + y * src_row_size, row_size);
+		}
+	}
+}
+
+// Runs on the WorkerThreadPool. Saves one region's map to its own file
+void Terrain3DStorage::_export_tile_task(void *p_job, uint32_t p_index) {
+	const ExportTilesJob *job = static_cast<const ExportTilesJob *>(p_job);
+	Ref<Image> map = job->maps[p_index];
+	const String &path = job->paths[p_index];
+	String ext = path.get_extension().to_lower();
+	Error err;
+	if (ext == "r16" || ext == "raw") {
+		PackedByteArray data;
+		data.resize(int64_t(map->get_width()) * map->get_height() * 2);
+		_encode_r16(_get_heights(map), map->get_width() * map->get_height(), job->height_min, job->height_scale, data.ptrw());
+		Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE);
+		if (file.is_null()) {
+			err = FileAccess::get_open_error();
+		} else {
+			file->store_buffer(data);
+			err = file->get_error();
+		}
+	} else {
+		if (map->get_format() != FORMAT[job->map_type]) {
+			map = map->duplicate();
+			map->convert(FORMAT[job->map_type]);
+		}
+		err = _save_image(map, path, job->map_type);
+	}
+	job->errors[p_index] = err;
+}
+
+// Saves an Image by extension: exr, png, jpg, webp, res or tres
+Error Terrain3DStorage::_save_image(const Ref<Image> &p_image, const String &p_file_name, MapType p_map_type) {
+	String ext = p_file_name.get_extension().to_lower();
+	if (ext == "exr") {
+		return p_image->save_exr(p_file_name, (p_map_type == TYPE_HEIGHT) ? true : false);
+	} else if (ext == "png") {
+		return p_image->save_png(p_file_name);
+	} else if (ext == "jpg") {
+		return p_image->save_jpg(p_file_name);
+	} else if (ext == "webp") {
+		return p_image->save_webp(p_file_name);
+	} else if ((ext == "res") || (ext == "tres")) {
+		return ResourceSaver::get_singleton()->save(p_image, p_file_name, ResourceSaver::FLAG_COMPRESS);
+	}
+	LOG(ERROR, "No recognized file type. See docs for valid extensions");
+	return FAILED;
+}
+
+// Region offsets of the area that exports cover. It always includes the origin
+void Terrain3DStorage::_get_region_bounds(Vector2i &r_top_left, Vector2i &r_bottom_right) const {
+	r_top_left = Vector2i(0, 0);
+	r_bottom_right = Vector2i(0, 0);
+	for (int i = 0; i < _region_offsets.size(); i++) {
+		Vector2i region = _region_offsets[i];
+		r_top_left = Vector2i(MIN(r_top_left.x, region.x), MIN(r_top_left.y, region.y));
+		r_bottom_right = Vector2i(MAX(r_bottom_right.x, region.x), MAX(r_bottom_right.y, region.y));
+	}
+	LOG(DEBUG, "Full range to cover all regions: ", r_top_left, " to ", r_bottom_right);
+}
+
+// Min and max height of all regions from their pyramids. It includes 0, the height of empty areas
+Vector2 Terrain3DStorage::_get_export_height_range() const {
+	Vector2 range = Vector2(0.f, 0.f);
+	for (int i = 0; i < _height_maps.size(); i++) {
+		Vector2 region_range;
+		if (i < _height_pyramids.size() && _height_pyramids[i].is_valid()) {
+			region_range = _height_pyramids[i].get_min_max();
+		} else {
+			region_range = Util::get_min_max(_height_maps[i]);
+		}
+		if (region_range.x <= region_range.y) {
+			range.x = MIN(range.x, region_range.x);
+			range.y = MAX(range.y, region_range.y);
+		}
+	}
+	return range;
+}
+
+/**
+ * Writes all regions' heights as one r16 file, one band of regions at a time. The full sized image
+ * is never created. Each band is converted in parallel and written with a single store_buffer().
+ */
+Error Terrain3DStorage::_export_r16(const String &p_file_name) {
+	Vector2i top_left;
+	Vector2i bottom_right;
+	_get_region_bounds(top_left, bottom_right);
+	Vector2i slots = bottom_right - top_left + Vector2i(1, 1);
+	Vector2 range = _get_export_height_range();
+	float height_min = float(range.x);
+	float height_scale = (range.y > range.x) ? 65535.f / float(range.y - range.x) : 0.f;
+	LOG(MESG, "Exporting ", slots * _region_size, " r16 heights, range: ", range, " to: ", p_file_name);
+
+	Ref<FileAccess> file = FileAccess::open(p_file_name, FileAccess::WRITE);
+	if (file.is_null()) {
+		LOG(ERROR, "Could not open file '" + p_file_name + "' for writing");
+		return FileAccess::get_open_error();
+	}
+	uint8_t fill[2];
+	float blank = float(COLOR[TYPE_HEIGHT].r);
+	HeightPyramid::Heights blank_heights;
+	blank_heights.data = &blank;
+	_encode_r16(blank_heights, 1, height_min, height_scale, fill);
+
+	Dictionary indices = _get_region_indices();
+	PackedByteArray band;
+	band.resize(int64_t(slots.x) * _region_size * _region_size * 2);
+	ExportJob job;
+	job.sources.resize(slots.x);
+	job.slots = Vector2i(slots.x, 1);
+	job.region_size = _region_size;
+	job.src_pixel_size = (_get_format(TYPE_HEIGHT) == Image::FORMAT_RH) ? 2 : 4;
+	job.pixel_size = 2;
+	job.fill = fill;
+	job.dst = band.ptrw();
+	job.dst_stride = int64_t(slots.x) * _region_size * 2;
+	job.r16 = true;
+	job.half = _get_format(TYPE_HEIGHT) == Image::FORMAT_RH;
+	job.height_min = height_min;
+	job.height_scale = height_scale;
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	for (int y = 0; y < slots.y; y++) {
+		for (int x = 0; x < slots.x; x++) {
+			Vector2i offset = top_left + Vector2i(x, y);
+			const uint8_t *src = nullptr;
+			if (indices.has(offset)) {
+				Ref<Image> map = _height_maps[int(indices[offset])];
+				src = map->ptr();
+			}
+			job.sources.write[x] = src;
+		}
+		int64_t group_id = wtp->add_native_group_task(&Terrain3DStorage::_export_task, &job, slots.x, -1, true, "Terrain3DStorage export");
+		wtp->wait_for_group_task_completion(group_id);
+		file->store_buffer(band);
+		if (file->get_error() != OK) {
+			break;
+		}
+	}
+	return file->get_error();
+}
+
+
+// Converts a FORMAT_RF height map to FORMAT_RH in place, returning and recording the largest error
+real_t Terrain3DStorage::_quantize_heights(const Ref<Image> &p_map) {
+	PackedByteArray original = p_map->get_data(); // Copy on write, so this keeps the 32-bit data
+	p_map->convert(Image::FORMAT_RH);
+	const float *src = reinterpret_cast<const float *>(original.ptr());
+	const uint16_t *dst = reinterpret_cast<const uint16_t *>(p_map->ptr());
+	int count = p_map->get_width() * p_map->get_height();
+	real_t max_error = 0.f;
+	for (int i = 0; i < count; i++) {
+		real_t error = Math::abs(real_t(src[i]) - real_t(Math::half_to_float(dst[i])));
+		if (error > max_error) { // Comparisons are false for NAN
+			max_error = error;
+		}
+	}
+	_height_quantization_error = MAX(_height_quantization_error, max_error);
+	return max_error;
 }
 
 ///////////////////////////
@@ -27,10 +1375,17 @@ void Terrain3DStorage::_clear() {
 ///////////////////////////
 
 Terrain3DStorage::Terrain3DStorage() {
-	_region_map.resize(REGION_MAP_SIZE * REGION_MAP_SIZE);
 }
 
 Terrain3DStorage::~Terrain3DStorage() {
+	if (_save_job) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(_save_job->task_id);
+		memdelete(_save_job);
+	}
+	_cancel_stream_jobs();
+	for (int i = 0; i < _stream_containers.size(); i++) {
+		memdelete(_stream_containers[i]);
+	}
 	_clear();
 }
 
@@ -51,12 +1406,64 @@ void Terrain3DStorage::set_save_16_bit(bool p_enabled) {
 	_save_16_bit = p_enabled;
 }
 
+void Terrain3DStorage::set_save_compressed(bool p_enabled) {
+	LOG(INFO, p_enabled);
+	_save_compressed = p_enabled;
+}
+
+/**
+ * Keeps height maps in 16-bit half floats (FORMAT_RH) in RAM and VRAM, halving their memory.
+ * Existing maps are converted, and the largest height error introduced is reported. Half floats
+ * have 11 significant bits, so the error is at most 1/2048 of the height, eg. 0.25 at 512 to 1024.
+ */
+void Terrain3DStorage::set_resident_16_bit(bool p_enabled) {
+	LOG(INFO, p_enabled);
+	if (_resident_16_bit == p_enabled) {
+		return;
+	}
+	WriteLock lock(_map_lock);
+	_resident_16_bit = p_enabled;
+	_height_quantization_error = 0.f;
+	for (int i = 0; i < _height_maps.size(); i++) {
+		Ref<Image> img = _height_maps[i];
+		if (img.is_null()) {
+			continue;
+		}
+		if (_resident_16_bit && img->get_format() == Image::FORMAT_RF) {
+			_quantize_heights(img);
+		} else {
+			img->convert(_get_format(TYPE_HEIGHT));
+		}
+	}
+	_data_version++;
+	lock.unlock();
+	if (_resident_16_bit) {
+		LOG(INFO, "Converted ", _height_maps.size(), " height maps to 16-bit. Max error: ", _height_quantization_error);
+	}
+	// Images were converted in place, so pyramids can't be matched by instance, and the texture format changed
+	_height_pyramids_dirty = true;
+	_generated_height_maps.clear();
+	update_regions();
+	notify_property_list_changed();
+}
+
 void Terrain3DStorage::set_height_range(Vector2 p_range) {
 	LOG(INFO, vformat("%.2v", p_range));
+	std::lock_guard<std::mutex> guard(_height_range_mutex);
 	_height_range = p_range;
+	_height_range_dirty = false;
+}
+
+Vector2 Terrain3DStorage::get_height_range() const {
+	std::lock_guard<std::mutex> guard(_height_range_mutex);
+	if (_height_range_dirty) {
+		_update_height_range();
+	}
+	return _height_range;
 }
 
 void Terrain3DStorage::update_heights(real_t p_height) {
+	std::lock_guard<std::mutex> guard(_height_range_mutex);
 	if (p_height < _height_range.x) {
 		_height_range.x = p_height;
 	} else if (p_height > _height_range.y) {
@@ -66,6 +1473,7 @@ void Terrain3DStorage::update_heights(real_t p_height) {
 }
 
 void Terrain3DStorage::update_heights(Vector2 p_heights) {
+	std::lock_guard<std::mutex> guard(_height_range_mutex);
 	if (p_heights.x < _height_range.x) {
 		_height_range.x = p_heights.x;
 	}
@@ -75,19 +1483,74 @@ void Terrain3DStorage::update_heights(Vector2 p_heights) {
 	_modified = true;
 }
 
+/**
+ * Recalculates the height range from the cached range of each region, in O(regions).
+ * This happens automatically after edits, so is only needed after modifying map Images directly.
+ */
 void Terrain3DStorage::update_height_range() {
-	_height_range = Vector2(0.f, 0.f);
-	for (int i = 0; i < _height_maps.size(); i++) {
-		update_heights(Util::get_min_max(_height_maps[i]));
-	}
+	std::lock_guard<std::mutex> guard(_height_range_mutex);
+	_update_height_range();
 	LOG(INFO, "Updated terrain height range: ", _height_range);
 }
 
+// Returns the min and max height of one region, maintained by its height pyramid
+Vector2 Terrain3DStorage::get_region_height_range(int p_region_index) const {
+	ReadLock lock(_map_lock);
+	if (p_region_index < 0 || p_region_index >= _height_pyramids.size() || !_height_pyramids[p_region_index].is_valid()) {
+		LOG(ERROR, "Region index out of range or not yet loaded: ", p_region_index);
+		return Vector2(0.f, 0.f);
+	}
+	Vector2 range = _height_pyramids[p_region_index].get_min_max();
+	return (range.x > range.y) ? Vector2(0.f, 0.f) : range;
+}
+
+/**
+ * Returns the min and max height within a rectangle on the XZ plane, in O(log n) per region
+ * using the height pyramids. Returns (0, 0) if the rectangle doesn't touch any regions.
+ */
+Vector2 Terrain3DStorage::get_height_range_rect(Rect2 p_global_rect) const {
+	ReadLock lock(_map_lock);
+	Rect2 descaled = Rect2(p_global_rect.position / _mesh_vertex_spacing, p_global_rect.size / _mesh_vertex_spacing).abs();
+	Vector2i start = Vector2i(descaled.position.floor());
+	Vector2i end = Vector2i(descaled.get_end().floor()) + Vector2i(1, 1);
+	Vector2 range = _get_height_range_px(Rect2i(start, end - start));
+	return (range.x > range.y) ? Vector2(0.f, 0.f) : range;
+}
+
 void Terrain3DStorage::clear_edited_area() {
 	_edited_area = AABB();
+	_edited_rects.clear();
 }
 
+/**
+ * Adds to the area reported by maps_edited. Height pyramids are updated over this area, so
+ * it must cover any height pixels edited directly in the map images.
+ */
 void Terrain3DStorage::add_edited_area(AABB p_area) {
+	Vector2 start = Vector2(p_area.position.x, p_area.position.z) / _mesh_vertex_spacing;
+	Vector2 end = Vector2(p_area.get_end().x, p_area.get_end().z) / _mesh_vertex_spacing;
+	Vector2i px_start = Vector2i(start.floor()) - Vector2i(1, 1);
+	Vector2i px_end = Vector2i(end.ceil()) + Vector2i(2, 2);
+	{
+		WriteLock lock(_map_lock);
+		_update_height_pyramids(Rect2i(px_start, px_end - px_start));
+		_data_version++;
+	}
+
+	// Kept per region, so force_update_maps() only regenerates color mipmaps over the edit
+	Vector2i region_start = Vector2i((Vector2(px_start) / real_t(_region_size)).floor());
+	Vector2i region_end = Vector2i((Vector2(px_end - Vector2i(1, 1)) / real_t(_region_size)).floor());
+	for (int y = region_start.y; y <= region_end.y; y++) {
+		for (int x = region_start.x; x <= region_end.x; x++) {
+			Vector2i offset = Vector2i(x, y);
+			Rect2i rect = Rect2i(px_start - offset * _region_size, px_end - px_start).intersection(Rect2i(Vector2i(), _region_sizev));
+			if (_edited_rects.has(offset)) {
+				rect = rect.merge(_edited_rects[offset]);
+			}
+			_edited_rects[offset] = rect;
+		}
+	}
+
 	if (_edited_area.has_surface()) {
 		_edited_area = _edited_area.merge(p_area);
 	} else {
@@ -96,18 +1559,48 @@ void Terrain3DStorage::add_edited_area(AABB p_area) {
 	emit_signal("maps_edited", _edited_area);
 }
 
+/**
+ * Sets the size of all regions. If regions already exist, their maps are re-sliced into the
+ * new size, keeping all data in place in the world. See _resize_regions().
+ */
 void Terrain3DStorage::set_region_size(RegionSize p_size) {
 	LOG(INFO, p_size);
-	//ERR_FAIL_COND(p_size < SIZE_64);
-	//ERR_FAIL_COND(p_size > SIZE_2048);
-	ERR_FAIL_COND(p_size != SIZE_1024);
+	ERR_FAIL_COND(p_size < SIZE_64);
+	ERR_FAIL_COND(p_size > SIZE_2048);
+	ERR_FAIL_COND_MSG((p_size & (p_size - 1)) != 0, "Region size must be a power of 2");
+	if (p_size == _region_size) {
+		return;
+	}
+	if (!_region_offsets.is_empty()) {
+		_resize_regions(p_size);
+		return;
+	}
+	WriteLock lock(_map_lock);
 	_region_size = p_size;
 	_region_sizev = Vector2i(_region_size, _region_size);
+	_data_version++;
+	lock.unlock();
 	emit_signal("region_size_changed", _region_size);
 }
 
 void Terrain3DStorage::set_region_offsets(const TypedArray<Vector2i> &p_offsets) {
 	LOG(INFO, "Setting region offsets with array sized: ", p_offsets.size());
+	// Track regions added or removed, eg. by undo. Skipped on load, when there are none yet
+	if (!_region_offsets.is_empty()) {
+		Dictionary previous;
+		for (int i = 0; i < _region_offsets.size(); i++) {
+			previous[_region_offsets[i]] = true;
+		}
+		for (int i = 0; i < p_offsets.size(); i++) {
+			if (!previous.erase(p_offsets[i])) {
+				_set_region_modified(p_offsets[i], REGION_ALL_MAPS);
+			}
+		}
+		Array removed = previous.keys();
+		for (int i = 0; i < removed.size(); i++) {
+			_set_region_modified(removed[i], REGION_REMOVED);
+		}
+	}
 	_region_offsets = p_offsets;
 	_region_map_dirty = true;
 	update_regions();
@@ -120,12 +1613,8 @@ Vector2i Terrain3DStorage::get_region_offset(Vector3 p_global_position) {
 }
 
 int Terrain3DStorage::get_region_index(Vector3 p_global_position) {
-	Vector2i uv_offset = get_region_offset(p_global_position);
-	Vector2i pos = Vector2i(uv_offset + (REGION_MAP_VSIZE / 2));
-	if (pos.x >= REGION_MAP_SIZE || pos.y >= REGION_MAP_SIZE || pos.x < 0 || pos.y < 0) {
-		return -1;
-	}
-	return _region_map[pos.y * REGION_MAP_SIZE + pos.x] - 1;
+	ReadLock lock(_map_lock);
+	return _region_map.get(get_region_offset(p_global_position));
 }
 
 /** Adds a region to the terrain
@@ -143,15 +1632,20 @@ Error Terrain3DStorage::add_region(Vector3 p_global_position, const TypedArray<I
 			", array size: ", p_images.size(),
 			", update maps: ", p_update ? "yes" : "no");
 
-	Vector2i region_pos = Vector2i(uv_offset + (REGION_MAP_VSIZE / 2));
-	if (region_pos.x >= REGION_MAP_SIZE || region_pos.y >= REGION_MAP_SIZE || region_pos.x < 0 || region_pos.y < 0) {
+	if (ABS(uv_offset.x) > REGION_OFFSET_MAX || ABS(uv_offset.y) > REGION_OFFSET_MAX) {
 		uint64_t time = Time::get_singleton()->get_ticks_msec();
 		if (time - _last_region_bounds_error > 1000) {
 			_last_region_bounds_error = time;
-			LOG(ERROR, "Specified position outside of maximum region map size: +/-", real_t((REGION_MAP_SIZE / 2) * _region_size) * _mesh_vertex_spacing);
+			LOG(ERROR, "Specified position outside of maximum world size: +/-", real_t(REGION_OFFSET_MAX * _region_size) * _mesh_vertex_spacing);
 		}
 		return FAILED;
 	}
+	Rect2i bounds = _region_map.size() == 0 ? Rect2i(uv_offset, Vector2i(1, 1)) : _region_map.get_bounds().expand(uv_offset).expand(uv_offset + Vector2i(1, 1));
+	if (!RegionMap::fits(bounds)) {
+		LOG(ERROR, "Region ", uv_offset, " is too far from the other regions. Regions may span at most ",
+				RegionMap::get_max_size(), " regions on either axis");
+		return FAILED;
+	}
 
 	if (has_region(p_global_position)) {
 		if (p_images.is_empty()) {
@@ -169,22 +1663,15 @@ Error Terrain3DStorage::add_region(Vector3 p_global_position, const TypedArray<I
 		return FAILED;
 	}
 
-	// If we're importing data into a region, check its heights for aabbs
-	Vector2 min_max = Vector2(0.f, 0.f);
-	if (p_images.size() > TYPE_HEIGHT) {
-		min_max = Util::get_min_max(images[TYPE_HEIGHT]);
-		LOG(DEBUG, "Checking imported height range: ", min_max);
-		update_heights(min_max);
-	}
-
 	LOG(DEBUG, "Pushing back ", images.size(), " images");
 	_height_maps.push_back(images[TYPE_HEIGHT]);
 	_control_maps.push_back(images[TYPE_CONTROL]);
 	_color_maps.push_back(images[TYPE_COLOR]);
 	_region_offsets.push_back(uv_offset);
 	LOG(DEBUG, "Total regions after pushback: ", _region_offsets.size());
+	_set_region_modified(uv_offset, REGION_ALL_MAPS);
 
-	// Region_map is used by get_region_index so must be updated every time
+	// Region_map is used by get_region_index so must be updated every time. The GPU region map waits for update_regions()
 	_region_map_dirty = true;
 	if (p_update) {
 		LOG(DEBUG, "Updating generated maps");
@@ -195,7 +1682,7 @@ Error Terrain3DStorage::add_region(Vector3 p_global_position, const TypedArray<I
 		notify_property_list_changed();
 		emit_changed();
 	} else {
-		update_regions();
+		_update_region_map();
 	}
 	return OK;
 }
@@ -206,6 +1693,7 @@ void Terrain3DStorage::remove_region(Vector3 p_global_position, bool p_update) {
 	ERR_FAIL_COND_MSG(index == -1, "Map does not exist.");
 
 	LOG(INFO, "Removing region at: ", get_region_offset(p_global_position));
+	_set_region_modified(_region_offsets[index], REGION_REMOVED);
 	_region_offsets.remove_at(index);
 	LOG(DEBUG, "Removed region_offsets, new size: ", _region_offsets.size());
 	_height_maps.remove_at(index);
@@ -215,11 +1703,7 @@ void Terrain3DStorage::remove_region(Vector3 p_global_position, bool p_update) {
 	_color_maps.remove_at(index);
 	LOG(DEBUG, "Removed colormaps, new size: ", _color_maps.size());
 
-	if (_height_maps.size() == 0) {
-		_height_range = Vector2(0.f, 0.f);
-	}
-
-	// Region_map is used by get_region_index so must be updated
+	// Region_map is used by get_region_index so must be updated. The GPU region map waits for update_regions()
 	_region_map_dirty = true;
 	if (p_update) {
 		LOG(DEBUG, "Updating generated maps");
@@ -230,50 +1714,62 @@ void Terrain3DStorage::remove_region(Vector3 p_global_position, bool p_update) {
 		notify_property_list_changed();
 		emit_changed();
 	} else {
-		update_regions();
+		_update_region_map();
 	}
 }
 
+/**
+ * Uploads changed maps to the GPU and rebuilds the region map.
+ * Layers marked by force_update_maps() with a region index are uploaded individually,
+ * keeping the TextureArray RIDs. Arrays are only recreated if cleared or the region
+ * count changed, in which case regions_changed is emitted so the material rebinds them.
+ */
 void Terrain3DStorage::update_regions(bool force_emit) {
-	if (_generated_height_maps.is_dirty()) {
-		LOG(DEBUG_CONT, "Regenerating height layered texture from ", _height_maps.size(), " maps");
-		_generated_height_maps.create(_height_maps);
-		force_emit = true;
+	bool maps_changed = false;
+	bool heights_changed = false;
+	if (_generated_height_maps.needs_update()) {
+		LOG(DEBUG_CONT, "Updating height layered texture from ", _height_maps.size(), " maps");
+		force_emit = _generated_height_maps.update(_height_maps) || force_emit;
+		maps_changed = true;
+		heights_changed = true;
 		_modified = true;
-		emit_signal("height_maps_changed");
 	}
 
-	if (_generated_control_maps.is_dirty()) {
-		LOG(DEBUG_CONT, "Regenerating control layered texture from ", _control_maps.size(), " maps");
-		_generated_control_maps.create(_control_maps);
-		force_emit = true;
+	if (_generated_control_maps.needs_update()) {
+		LOG(DEBUG_CONT, "Updating control layered texture from ", _control_maps.size(), " maps");
+		force_emit = _generated_control_maps.update(_control_maps) || force_emit;
+		maps_changed = true;
 		_modified = true;
 	}
 
-	if (_generated_color_maps.is_dirty()) {
-		LOG(DEBUG_CONT, "Regenerating color layered texture from ", _color_maps.size(), " maps");
-		for (int i = 0; i < _color_maps.size(); i++) {
-			Ref<Image> map = _color_maps[i];
-			map->generate_mipmaps();
-		}
-		_generated_color_maps.create(_color_maps);
-		force_emit = true;
+	if (_generated_color_maps.needs_update()) {
+		LOG(DEBUG_CONT, "Updating color layered texture from ", _color_maps.size(), " maps");
+		_update_color_mipmaps();
+		force_emit = _generated_color_maps.update(_color_maps) || force_emit;
+		maps_changed = true;
 		_modified = true;
 	}
 
+	// The sampler and region map are swapped together, so queries never mix old and new regions
+	if (force_emit || maps_changed || _region_map_dirty) {
+		WriteLock lock(_map_lock);
+		_update_sampler();
+		if (_region_map_dirty) {
+			LOG(DEBUG_CONT, "Regenerating region map from ", _region_offsets.size(), " regions");
+			_region_map.build(_region_offsets);
+		}
+		_data_version++;
+	}
+
+	// Emitted after the sampler so the height range includes new or replaced maps
+	if (heights_changed) {
+		emit_signal("height_maps_changed");
+	}
+
 	if (_region_map_dirty) {
-		LOG(DEBUG_CONT, "Regenerating ", REGION_MAP_VSIZE, " region map array");
-		_region_map.clear();
-		_region_map.resize(REGION_MAP_SIZE * REGION_MAP_SIZE);
+		_generated_region_map.clear();
+		_generated_region_map.create(_region_map.get_image());
 		_region_map_dirty = false;
-		for (int i = 0; i < _region_offsets.size(); i++) {
-			Vector2i ofs = _region_offsets[i];
-			Vector2i pos = Vector2i(ofs + (REGION_MAP_VSIZE / 2));
-			if (pos.x >= REGION_MAP_SIZE || pos.y >= REGION_MAP_SIZE || pos.x < 0 || pos.y < 0) {
-				continue;
-			}
-			_region_map[pos.y * REGION_MAP_SIZE + pos.x] = i + 1; // 0 = no region
-		}
 		force_emit = true;
 		_modified = true;
 	}
@@ -284,18 +1780,282 @@ void Terrain3DStorage::update_regions(bool force_emit) {
 		region_signal_args.push_back(_generated_height_maps.get_rid());
 		region_signal_args.push_back(_generated_control_maps.get_rid());
 		region_signal_args.push_back(_generated_color_maps.get_rid());
-		region_signal_args.push_back(_region_map);
+		region_signal_args.push_back(_generated_region_map.get_rid());
+		region_signal_args.push_back(_region_map.get_bounds().position);
 		region_signal_args.push_back(_region_offsets);
 		emit_signal("regions_changed", region_signal_args);
 	}
 }
 
+void Terrain3DStorage::set_streaming_enabled(bool p_enabled) {
+	LOG(INFO, "Setting streaming enabled: ", p_enabled);
+	if (_streaming_enabled == p_enabled) {
+		return;
+	}
+	_streaming_enabled = p_enabled;
+	if (_streaming_enabled) {
+		_scan_stream_files();
+	} else {
+		_cancel_stream_jobs();
+	}
+}
+
+void Terrain3DStorage::set_streaming_directory(const String &p_directory) {
+	LOG(INFO, "Setting streaming directory: ", p_directory);
+	if (_streaming_directory == p_directory) {
+		return;
+	}
+	_cancel_stream_jobs();
+	_streaming_directory = p_directory;
+	if (_streaming_enabled) {
+		_scan_stream_files();
+	}
+}
+
+void Terrain3DStorage::set_stream_load_radius(real_t p_radius) {
+	LOG(INFO, "Setting stream load radius: ", p_radius);
+	_stream_load_radius = MAX(p_radius, 0.f);
+	if (_stream_unload_radius < _stream_load_radius) {
+		LOG(WARN, "Unload radius is less than the load radius. Regions will only unload beyond ", _stream_load_radius);
+	}
+	_stream_last_position = Vector2(FLT_MAX, FLT_MAX);
+}
+
+void Terrain3DStorage::set_stream_unload_radius(real_t p_radius) {
+	LOG(INFO, "Setting stream unload radius: ", p_radius);
+	_stream_unload_radius = MAX(p_radius, 0.f);
+	if (_stream_unload_radius < _stream_load_radius) {
+		LOG(WARN, "Unload radius is less than the load radius. Regions will only unload beyond ", _stream_load_radius);
+	}
+	_stream_last_position = Vector2(FLT_MAX, FLT_MAX);
+}
+
+/**
+ * Streams regions in and out around p_global_position. Call every frame, eg. with the camera position.
+ * Finished loads are added, then if the position moved more than 1/8 of a region, regions
+ * beyond the unload radius are removed and loads are started for files within the load radius.
+ * The gap between the radii is hysteresis, so regions on the edge don't load and unload repeatedly.
+ * All changes are applied together, so the maps and region map are rebuilt and regions_changed
+ * emitted once per call. Returns true if any regions were added or removed.
+ */
+bool Terrain3DStorage::update_streaming(Vector3 p_global_position) {
+	if (!_streaming_enabled || _streaming_directory.is_empty()) {
+		return false;
+	}
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	real_t region_world_size = real_t(_region_size) * _mesh_vertex_spacing;
+
+	// Regions are added and removed together at the end, so the maps and signals update once
+	Dictionary loaded; // Offset -> sanitized maps
+	Dictionary unloaded;
+
+	// Collect regions that finished loading
+	for (int i = 0; i < _stream_jobs.size();) {
+		StreamJob *job = _stream_jobs[i];
+		if (!wtp->is_task_completed(job->task_id)) {
+			i++;
+			continue;
+		}
+		wtp->wait_for_task_completion(job->task_id);
+		_stream_jobs.remove_at(i);
+		Vector3 global_pos = Vector3(job->offset.x, 0.f, job->offset.y) * region_world_size;
+		if (job->error != OK) {
+			LOG(ERROR, "Failed to stream region ", job->offset, " from ", job->path, ", error: ", job->error);
+			_stream_files.erase(job->offset); // Don't retry every frame
+		} else if (job->region_size != _region_size || has_region(global_pos) || _is_region_saving(job->offset)) {
+			LOG(DEBUG, "Discarding streamed region ", job->offset, ", region size changed, region already exists or is being saved");
+		} else {
+			TypedArray<Image> maps = sanitize_maps(TYPE_MAX, job->maps);
+			if (maps.is_empty()) {
+				LOG(ERROR, "Streamed region ", job->offset, " has invalid maps: ", job->path);
+				_stream_files.erase(job->offset);
+			} else {
+				loaded[job->offset] = maps;
+			}
+		}
+		memdelete(job);
+	}
+
+	Vector2 pos = Vector2(p_global_position.x, p_global_position.z);
+	if (pos.distance_to(_stream_last_position) > region_world_size * 0.125f) {
+		_stream_last_position = pos;
+		real_t unload_radius = MAX(_stream_unload_radius, _stream_load_radius);
+
+		Array streamed = _streamed_regions.keys();
+		for (int i = 0; i < streamed.size(); i++) {
+			Vector2i offset = streamed[i];
+			// Modified regions stay loaded until saved, including while a save is writing them
+			if (_get_region_distance(offset, pos) > unload_radius && !_modified_regions.has(offset) &&
+					!_is_region_saving(offset)) {
+				_streamed_regions.erase(offset);
+				unloaded[offset] = true;
+			}
+		}
+
+		Array offsets = _stream_files.keys();
+		for (int i = 0; i < offsets.size(); i++) {
+			Vector2i offset = offsets[i];
+			if (_get_region_distance(offset, pos) > _stream_load_radius || loaded.has(offset) ||
+					has_region(Vector3(offset.x, 0.f, offset.y) * region_world_size) || _is_region_saving(offset)) {
+				continue;
+			}
+			bool pending = false;
+			for (int j = 0; j < _stream_jobs.size() && !pending; j++) {
+				pending = _stream_jobs[j]->offset == offset;
+			}
+			if (pending) {
+				continue;
+			}
+			StreamJob *job = memnew(StreamJob);
+			Variant source = _stream_files[offset];
+			if (source.get_type() == Variant::VECTOR2I) {
+				Vector2i entry = source;
+				job->container = _stream_containers[entry.x];
+				job->container_index = entry.y;
+				job->path = job->container->get_path();
+			} else {
+				job->path = source;
+			}
+			job->offset = offset;
+			job->region_size = _region_size;
+			job->task_id = wtp->add_native_task(&Terrain3DStorage::_stream_load_task, job, false, "Terrain3DStorage region stream");
+			_stream_jobs.push_back(job);
+			LOG(DEBUG, "Streaming in region ", offset);
+		}
+	}
+
+	if (loaded.is_empty() && unloaded.is_empty()) {
+		return false;
+	}
+	TypedArray<Vector2i> added = _swap_streamed_regions(loaded, unloaded);
+	for (int i = 0; i < added.size(); i++) {
+		_modified_regions.erase(added[i]); // Identical to its file
+		_streamed_regions[added[i]] = true;
+	}
+	LOG(DEBUG, "Streamed in ", added.size(), " regions, out ", unloaded.size(), ", total: ", _region_offsets.size());
+	_generated_height_maps.clear();
+	_generated_control_maps.clear();
+	_generated_color_maps.clear();
+	update_regions();
+	Array removed = unloaded.keys();
+	for (int i = 0; i < removed.size(); i++) {
+		emit_signal("region_unloaded", removed[i]);
+	}
+	for (int i = 0; i < added.size(); i++) {
+		emit_signal("region_loaded", added[i]);
+	}
+	return true;
+}
+
+/**
+ * Writes every region to its own file in p_directory for streaming, eg. res://terrain/region_0_-1.t3dr.
+ * Existing files for other regions are left in place.
+ */
+Error Terrain3DStorage::save_region_files(const String &p_directory) {
+	LOG(INFO, "Saving ", _region_offsets.size(), " region files to ", p_directory);
+	Error err = DirAccess::make_dir_recursive_absolute(p_directory);
+	if (err != OK) {
+		LOG(ERROR, "Cannot create directory: ", p_directory);
+		return err;
+	}
+	for (int i = 0; i < _region_offsets.size(); i++) {
+		Vector2i offset = _region_offsets[i];
+		TypedArray<Image> maps;
+		maps.push_back(_height_maps[i]);
+		maps.push_back(_control_maps[i]);
+		maps.push_back(_color_maps[i]);
+		err = RegionFile::save(p_directory.path_join(RegionFile::get_file_name(offset)), offset, _region_size, maps);
+		if (err != OK) {
+			LOG(ERROR, "Failed to save region ", offset, ", error: ", err);
+			return err;
+		}
+		_modified_regions.erase(offset);
+	}
+	if (FileAccess::file_exists(p_directory.path_join(RegionFile::INDEX_FILE_NAME))) {
+		_update_region_index(p_directory, _region_offsets, TypedArray<Vector2i>());
+	}
+	if (_streaming_enabled && p_directory == _streaming_directory) {
+		_scan_stream_files();
+	}
+	return OK;
+}
+
+/**
+ * Writes only the regions modified since they were last saved to p_directory, and any region that
+ * has no file there yet. Then the directory index is replaced, and files of removed regions deleted.
+ * Save time scales with the size of the edit rather than the world.
+ */
+Error Terrain3DStorage::save_modified_regions(const String &p_directory) {
+	_wait_for_save();
+	SaveJob *job = _create_save_job(String(), p_directory);
+	_write_save_job(job);
+	return _finish_save_job(job);
+}
+
+void Terrain3DStorage::set_region_modified(int p_region_index, MapType p_map_type) {
+	ERR_FAIL_INDEX(p_region_index, _region_offsets.size());
+	_set_region_modified(_region_offsets[p_region_index], (p_map_type == TYPE_MAX) ? REGION_ALL_MAPS : 1 << p_map_type);
+}
+
+// With TYPE_MAX, returns if any map of the region is modified
+bool Terrain3DStorage::is_region_modified(int p_region_index, MapType p_map_type) const {
+	ERR_FAIL_INDEX_V(p_region_index, _region_offsets.size(), false);
+	int bits = _modified_regions.get(_region_offsets[p_region_index], 0);
+	return (p_map_type == TYPE_MAX) ? bits != 0 : (bits & (1 << p_map_type)) != 0;
+}
+
+// Includes removed regions
+TypedArray<Vector2i> Terrain3DStorage::get_modified_regions() const {
+	TypedArray<Vector2i> offsets;
+	Array keys = _modified_regions.keys();
+	for (int i = 0; i < keys.size(); i++) {
+		offsets.push_back(keys[i]);
+	}
+	return offsets;
+}
+
+/**
+ * Converts all regions into a single region container file, eg. res://terrain/regions.t3dc.
+ * Placed in streaming_directory, regions are streamed from it with only the index read up front.
+ */
+Error Terrain3DStorage::save_region_container(const String &p_path) {
+	LOG(INFO, "Saving ", _region_offsets.size(), " regions to container ", p_path);
+	if (p_path.get_extension() != RegionContainer::EXTENSION) {
+		LOG(WARN, "Region containers are only found in streaming_directory with the extension .", RegionContainer::EXTENSION);
+	}
+	Error err = DirAccess::make_dir_recursive_absolute(p_path.get_base_dir());
+	if (err != OK) {
+		LOG(ERROR, "Cannot create directory: ", p_path.get_base_dir());
+		return err;
+	}
+	// An open container may be mapping the file being replaced
+	bool rescan = _streaming_enabled && p_path.get_base_dir() == _streaming_directory;
+	if (rescan) {
+		_cancel_stream_jobs();
+		for (int i = 0; i < _stream_containers.size(); i++) {
+			_stream_containers[i]->close();
+		}
+	}
+	Vector<TypedArray<Image>> maps;
+	maps.push_back(_height_maps);
+	maps.push_back(_control_maps);
+	maps.push_back(_color_maps);
+	err = RegionContainer::write(p_path, _region_size, _region_offsets, maps);
+	if (err == OK && FileAccess::file_exists(p_path.get_base_dir().path_join(RegionFile::INDEX_FILE_NAME))) {
+		_update_region_index(p_path.get_base_dir(), _region_offsets, TypedArray<Vector2i>());
+	}
+	if (rescan) {
+		_scan_stream_files();
+	}
+	return err;
+}
+
 void Terrain3DStorage::set_map_region(MapType p_map_type, int p_region_index, const Ref<Image> p_image) {
 	switch (p_map_type) {
 		case TYPE_HEIGHT:
 			if (p_region_index >= 0 && p_region_index < _height_maps.size()) {
 				_height_maps[p_region_index] = p_image;
-				force_update_maps(TYPE_HEIGHT);
+				force_update_maps(TYPE_HEIGHT, p_region_index);
 			} else {
 				LOG(ERROR, "Requested index is out of bounds. height_maps size: ", _height_maps.size());
 			}
@@ -303,7 +2063,7 @@ void Terrain3DStorage::set_map_region(MapType p_map_type, int p_region_index, co
 		case TYPE_CONTROL:
 			if (p_region_index >= 0 && p_region_index < _control_maps.size()) {
 				_control_maps[p_region_index] = p_image;
-				force_update_maps(TYPE_CONTROL);
+				force_update_maps(TYPE_CONTROL, p_region_index);
 			} else {
 				LOG(ERROR, "Requested index is out of bounds. control_maps size: ", _control_maps.size());
 			}
@@ -311,7 +2071,8 @@ void Terrain3DStorage::set_map_region(MapType p_map_type, int p_region_index, co
 		case TYPE_COLOR:
 			if (p_region_index >= 0 && p_region_index < _color_maps.size()) {
 				_color_maps[p_region_index] = p_image;
-				force_update_maps(TYPE_COLOR);
+				_set_color_mipmaps_dirty(_region_offsets[p_region_index]);
+				force_update_maps(TYPE_COLOR, p_region_index);
 			} else {
 				LOG(ERROR, "Requested index is out of bounds. color_maps size: ", _color_maps.size());
 			}
@@ -355,6 +2116,13 @@ Ref<Image> Terrain3DStorage::get_map_region(MapType p_map_type, int p_region_ind
 void Terrain3DStorage::set_maps(MapType p_map_type, const TypedArray<Image> &p_maps) {
 	ERR_FAIL_COND_MSG(p_map_type < 0 || p_map_type >= TYPE_MAX, "Specified map type out of range");
 	LOG(INFO, "Setting ", TYPESTR[p_map_type], " maps: ", p_maps.size());
+	// Replaced Images mark their regions modified, eg. on undo. Nothing is marked on load
+	TypedArray<Image> previous = get_maps(p_map_type);
+	for (int i = 0; i < MIN(previous.size(), p_maps.size()) && i < _region_offsets.size(); i++) {
+		if (previous[i] != p_maps[i]) {
+			_set_region_modified(_region_offsets[i], 1 << p_map_type);
+		}
+	}
 	switch (p_map_type) {
 		case TYPE_HEIGHT:
 			_height_maps = sanitize_maps(TYPE_HEIGHT, p_maps);
@@ -368,7 +2136,7 @@ void Terrain3DStorage::set_maps(MapType p_map_type, const TypedArray<Image> &p_m
 		default:
 			break;
 	}
-	force_update_maps(p_map_type);
+	_update_maps(p_map_type, -1, false);
 }
 
 TypedArray<Image> Terrain3DStorage::get_maps(MapType p_map_type) const {
@@ -409,23 +2177,75 @@ TypedArray<Image> Terrain3DStorage::get_maps_copy(MapType p_map_type) const {
 	return newmaps;
 }
 
+/**
+ * Returns an immutable view of the terrain data as it is now, for consumers that read it over
+ * time while editing continues, such as bakers and exporters. No pixels are copied: each region
+ * map is shared copy on write, so a map is only copied when it is next edited here, and only that
+ * region's. The sampler, region map and height pyramids are shared the same way. Taking a
+ * snapshot costs O(regions) references, and may be done from any thread. One taken on another
+ * thread while the editor is operating may include part of the operation.
+ */
+Ref<Terrain3DSnapshot> Terrain3DStorage::create_snapshot() const {
+	Ref<Terrain3DSnapshot> snapshot;
+	snapshot.instantiate();
+	Terrain3DStorage *storage = snapshot->_storage.ptr();
+	TypedArray<Image> *maps[] = { &storage->_height_maps, &storage->_control_maps, &storage->_color_maps };
+	ReadLock lock(_map_lock);
+	snapshot->_version = _data_version;
+	storage->_region_size = _region_size;
+	storage->_region_sizev = _region_sizev;
+	storage->_resident_16_bit = _resident_16_bit;
+	storage->_mesh_vertex_spacing = _mesh_vertex_spacing;
+	storage->_region_map = _region_map;
+	storage->_sampler_offsets = _sampler_offsets;
+	storage->_height_pyramids = _height_pyramids;
+	for (int i = 0; i < _sampler_offsets.size(); i++) {
+		storage->_region_offsets.push_back(_sampler_offsets[i]);
+	}
+	for (int t = 0; t < TYPE_MAX; t++) {
+		storage->_sampler_maps[t].resize(_sampler_offsets.size());
+		for (int i = 0; i < _sampler_offsets.size(); i++) {
+			Ref<Image> map = _sampler_maps[t][i]->duplicate();
+			storage->_sampler_maps[t].set(i, map);
+			maps[t]->push_back(map);
+		}
+	}
+	lock.unlock();
+	storage->_region_map_dirty = false;
+	storage->_height_range_dirty = true;
+	LOG(DEBUG, "Created snapshot of ", storage->_region_offsets.size(), " regions at data version ", snapshot->_version);
+	return snapshot;
+}
+
+// Returns a counter that changes with every edit or region change, to check whether a snapshot is current
+uint64_t Terrain3DStorage::get_data_version() const {
+	ReadLock lock(_map_lock);
+	return _data_version;
+}
+
 void Terrain3DStorage::set_pixel(MapType p_map_type, Vector3 p_global_position, Color p_pixel) {
 	if (p_map_type < 0 || p_map_type >= TYPE_MAX) {
 		LOG(ERROR, "Specified map type out of range");
 		return;
 	}
-	int region = get_region_index(p_global_position);
-	if (region < 0 || region >= _region_offsets.size()) {
+	WriteLock lock(_map_lock);
+	Vector2i px = _get_px(p_global_position);
+	int region = _get_region_index_px(px);
+	if (region < 0 || region >= _sampler_offsets.size()) {
 		return;
 	}
-	Vector2i global_offset = Vector2i(get_region_offsets()[region]) * _region_size;
-	Vector3 descaled_position = p_global_position / _mesh_vertex_spacing;
-	Vector2i img_pos = Vector2i(
-			Vector2(descaled_position.x - global_offset.x,
-					descaled_position.z - global_offset.y)
-					.floor());
-	Ref<Image> map = get_map_region(p_map_type, region);
+	Vector2i img_pos = px - _sampler_offsets[region] * int(_region_size);
+	const Ref<Image> &map = _sampler_maps[p_map_type][region];
 	map->set_pixelv(img_pos, p_pixel);
+	_data_version++;
+	_set_region_modified(_sampler_offsets[region], 1 << p_map_type);
+	if (p_map_type == TYPE_COLOR) {
+		_set_color_mipmaps_dirty(_sampler_offsets[region], Rect2i(img_pos, Vector2i(1, 1)));
+	}
+	if (p_map_type == TYPE_HEIGHT && _has_pyramid(region)) {
+		_height_pyramids.ptrw()[region].update(_get_heights(map), Rect2i(img_pos, Vector2i(1, 1)));
+		_height_range_dirty = true;
+	}
 }
 
 Color Terrain3DStorage::get_pixel(MapType p_map_type, Vector3 p_global_position) {
@@ -433,47 +2253,47 @@ Color Terrain3DStorage::get_pixel(MapType p_map_type, Vector3 p_global_position)
 		LOG(ERROR, "Specified map type out of range");
 		return COLOR_NAN;
 	}
-	int region = get_region_index(p_global_position);
-	if (region < 0 || region >= _region_offsets.size()) {
+	ReadLock lock(_map_lock);
+	Vector2i px = _get_px(p_global_position);
+	if (p_map_type == TYPE_HEIGHT) {
+		if (_get_region_index_px(px) < 0) {
+			return COLOR_NAN;
+		}
+		return Color(_get_height_px(px), 0.f, 0.f, 1.f);
+	}
+	const uint32_t *texel = _get_texel(p_map_type, px);
+	if (!texel) {
 		return COLOR_NAN;
 	}
-	Vector2i global_offset = Vector2i(get_region_offsets()[region]) * _region_size;
-	Vector3 descaled_position = p_global_position / _mesh_vertex_spacing;
-	Vector2i img_pos = Vector2i(
-			Vector2(descaled_position.x - global_offset.x,
-					descaled_position.z - global_offset.y)
-					.floor());
-	img_pos = img_pos.clamp(Vector2i(), Vector2i(_region_size - 1, _region_size - 1));
-	Ref<Image> map = get_map_region(p_map_type, region);
-	return map->get_pixelv(img_pos);
+	if (p_map_type == TYPE_COLOR) {
+		const uint8_t *rgba = reinterpret_cast<const uint8_t *>(texel);
+		return Color(rgba[0] / 255.f, rgba[1] / 255.f, rgba[2] / 255.f, rgba[3] / 255.f);
+	}
+	return Color(as_float(*texel), 0.f, 0.f, 1.f);
 }
 
 real_t Terrain3DStorage::get_height(Vector3 p_global_position) {
-	if (is_hole(get_control(p_global_position))) {
+	ReadLock lock(_map_lock);
+	return _get_height(p_global_position);
+}
+
+real_t Terrain3DStorage::_get_height(Vector3 p_global_position) const {
+	Vector2 pos = Vector2(p_global_position.x, p_global_position.z) / _mesh_vertex_spacing;
+	Vector2i px = Vector2i(pos.floor());
+	if (is_hole(_get_control_px(px))) {
 		return NAN;
 	}
-	Vector3 &pos = p_global_position;
-	real_t &step = _mesh_vertex_spacing;
-	pos.y = 0.f;
-	// Round to nearest vertex
-	Vector3 pos_round = Vector3(
-			round_multiple(pos.x, step),
-			0.f,
-			round_multiple(pos.z, step));
 	// If requested position is close to a vertex, return its height
-	if ((pos - pos_round).length() < 0.01f) {
-		return get_pixel(TYPE_HEIGHT, pos).r;
+	Vector2 pos_round = pos.round();
+	if ((pos - pos_round).length() * _mesh_vertex_spacing < 0.01f) {
+		return _get_height_px(Vector2i(pos_round));
 	} else {
 		// Otherwise, bilinearly interpolate 4 surrounding vertices
-		Vector3 pos00 = Vector3(floor(pos.x / step) * step, 0.f, floor(pos.z / step) * step);
-		real_t ht00 = get_pixel(TYPE_HEIGHT, pos00).r;
-		Vector3 pos01 = pos00 + Vector3(0.f, 0.f, step);
-		real_t ht01 = get_pixel(TYPE_HEIGHT, pos01).r;
-		Vector3 pos10 = pos00 + Vector3(step, 0.f, 0.f);
-		real_t ht10 = get_pixel(TYPE_HEIGHT, pos10).r;
-		Vector3 pos11 = pos00 + Vector3(step, 0.f, step);
-		real_t ht11 = get_pixel(TYPE_HEIGHT, pos11).r;
-		return bilerp(ht00, ht01, ht10, ht11, pos00, pos11, pos);
+		real_t ht00 = _get_height_px(px);
+		real_t ht01 = _get_height_px(px + Vector2i(0, 1));
+		real_t ht10 = _get_height_px(px + Vector2i(1, 0));
+		real_t ht11 = _get_height_px(px + Vector2i(1, 1));
+		return bilerp(ht00, ht01, ht10, ht11, Vector2(px), Vector2(px + Vector2i(1, 1)), pos);
 	}
 }
 
@@ -488,13 +2308,266 @@ real_t Terrain3DStorage::get_height(Vector3 p_global_position) {
  * value of .3-.5, otherwise it's the base texture.
  **/
 Vector3 Terrain3DStorage::get_texture_id(Vector3 p_global_position) {
-	float src = get_pixel(TYPE_CONTROL, p_global_position).r; // Must be 32-bit float, not double/real
+	uint32_t src = get_control(p_global_position);
 	uint32_t base_id = get_base(src);
 	uint32_t overlay_id = get_overlay(src);
 	real_t blend = real_t(get_blend(src)) / 255.0f;
 	return Vector3(real_t(base_id), real_t(overlay_id), blend);
 }
 
+/**
+ * Batched versions of get_height(), get_normal() and get_control(). Results are in the
+ * same order as p_global_positions. Large batches are processed on multiple threads.
+ * The read lock is taken once per chunk rather than per point.
+ */
+PackedRealArray Terrain3DStorage::get_heights(const PackedVector3Array &p_global_positions) {
+	PackedRealArray heights;
+	heights.resize(p_global_positions.size());
+	real_t *out = heights.ptrw();
+	_process_batch(p_global_positions, [this, out](int p_index, const Vector3 &p_pos) {
+		out[p_index] = _get_height(p_pos);
+	});
+	return heights;
+}
+
+PackedVector3Array Terrain3DStorage::get_normals(const PackedVector3Array &p_global_positions) {
+	PackedVector3Array normals;
+	normals.resize(p_global_positions.size());
+	Vector3 *out = normals.ptrw();
+	_process_batch(p_global_positions, [this, out](int p_index, const Vector3 &p_pos) {
+		out[p_index] = _get_normal(p_pos);
+	});
+	return normals;
+}
+
+PackedInt32Array Terrain3DStorage::get_controls(const PackedVector3Array &p_global_positions) {
+	PackedInt32Array controls;
+	controls.resize(p_global_positions.size());
+	int32_t *out = controls.ptrw();
+	_process_batch(p_global_positions, [this, out](int p_index, const Vector3 &p_pos) {
+		out[p_index] = int32_t(_get_control_px(_get_px(p_pos)));
+	});
+	return controls;
+}
+
+/**
+ * Decodes the control texels of a rect of global pixels into lanes, a row at a time.
+ * Rows of byte lanes are p_rect.size.x bytes apart, and rows of mask lanes
+ * (p_rect.size.x + 7) / 8 bytes apart. Texels outside of regions decode as 0.
+ */
+void Terrain3DStorage::decode_control_rect_px(Rect2i p_rect, const ControlLanes &r_lanes) const {
+	ReadLock lock(_map_lock);
+	_decode_control_rect_px(p_rect, r_lanes);
+}
+
+void Terrain3DStorage::_decode_control_rect_px(Rect2i p_rect, const ControlLanes &r_lanes) const {
+	int width = p_rect.size.x;
+	if (width <= 0 || p_rect.size.y <= 0) {
+		return;
+	}
+	int mask_stride = (width + 7) / 8;
+	Vector<uint32_t> row;
+	row.resize(width);
+	uint32_t *row_ptr = row.ptrw();
+	for (int y = 0; y < p_rect.size.y; y++) {
+		// Copy the row in spans, one per region crossed
+		for (int x = 0; x < width;) {
+			Vector2i px = p_rect.position + Vector2i(x, y);
+			int span = MIN(width - x, (floor_div(px.x, _region_size) + 1) * _region_size - px.x);
+			const uint32_t *texel = _get_texel(TYPE_CONTROL, px);
+			if (texel) {
+				memcpy(row_ptr + x, texel, span * sizeof(uint32_t));
+			} else {
+				memset(row_ptr + x, 0, span * sizeof(uint32_t));
+			}
+			x += span;
+		}
+		Util::decode_controls(row_ptr, width, r_lanes.offset(y * width, y * mask_stride));
+	}
+}
+
+// Encodes lanes laid out as by decode_control_rect_px() into the control maps. Texels outside of regions are skipped
+void Terrain3DStorage::encode_control_rect_px(Rect2i p_rect, const ControlLanes &p_lanes) {
+	int width = p_rect.size.x;
+	if (width <= 0 || p_rect.size.y <= 0) {
+		return;
+	}
+	int mask_stride = (width + 7) / 8;
+	Vector<uint32_t> row;
+	row.resize(width);
+	uint32_t *row_ptr = row.ptrw();
+	HashMap<int, bool> edited;
+	WriteLock lock(_map_lock);
+	for (int y = 0; y < p_rect.size.y; y++) {
+		Util::encode_controls(p_lanes.offset(y * width, y * mask_stride), width, row_ptr);
+		for (int x = 0; x < width;) {
+			Vector2i px = p_rect.position + Vector2i(x, y);
+			int span = MIN(width - x, (floor_div(px.x, _region_size) + 1) * _region_size - px.x);
+			int region = _get_region_index_px(px);
+			if (region >= 0 && region < _sampler_offsets.size()) {
+				const Ref<Image> &map = _sampler_maps[TYPE_CONTROL][region];
+				Vector2i img_pos = px - _sampler_offsets[region] * int(_region_size);
+				uint32_t *dst = reinterpret_cast<uint32_t *>(map->ptrw()) + img_pos.y * _region_size + img_pos.x;
+				memcpy(dst, row_ptr + x, span * sizeof(uint32_t));
+				edited.insert(region, true);
+			}
+			x += span;
+		}
+	}
+	_data_version++;
+	lock.unlock();
+	for (const KeyValue<int, bool> &E : edited) {
+		force_update_maps(TYPE_CONTROL, E.key);
+	}
+}
+
+/**
+ * Decodes the control map over p_size pixels from p_global_position into a Dictionary of lanes:
+ * size: Vector2i, base, overlay, blend: PackedByteArray of one byte per texel, row by row,
+ * hole, nav, auto: PackedByteArray bit masks, each row starting on a new byte.
+ */
+Dictionary Terrain3DStorage::decode_control_rect(Vector3 p_global_position, Vector2i p_size) const {
+	Dictionary dict;
+	if (p_size.x <= 0 || p_size.y <= 0) {
+		LOG(ERROR, "Invalid size: ", p_size);
+		return dict;
+	}
+	int count = p_size.x * p_size.y;
+	int mask_size = (p_size.x + 7) / 8 * p_size.y;
+	PackedByteArray base, overlay, blend, hole, nav, autoshader;
+	base.resize(count);
+	overlay.resize(count);
+	blend.resize(count);
+	hole.resize(mask_size);
+	nav.resize(mask_size);
+	autoshader.resize(mask_size);
+	ControlLanes lanes;
+	lanes.base = base.ptrw();
+	lanes.overlay = overlay.ptrw();
+	lanes.blend = blend.ptrw();
+	lanes.hole = hole.ptrw();
+	lanes.nav = nav.ptrw();
+	lanes.autoshader = autoshader.ptrw();
+	decode_control_rect_px(Rect2i(_get_px(p_global_position), p_size), lanes);
+	dict["size"] = p_size;
+	dict["base"] = base;
+	dict["overlay"] = overlay;
+	dict["blend"] = blend;
+	dict["hole"] = hole;
+	dict["nav"] = nav;
+	dict["auto"] = autoshader;
+	return dict;
+}
+
+// Writes lanes from decode_control_rect() back to the control map. Missing lanes encode as 0
+void Terrain3DStorage::encode_control_rect(Vector3 p_global_position, const Dictionary &p_lanes) {
+	Vector2i size = p_lanes.get("size", Vector2i());
+	if (size.x <= 0 || size.y <= 0) {
+		LOG(ERROR, "Lanes have an invalid size: ", size);
+		return;
+	}
+	int count = size.x * size.y;
+	int mask_size = (size.x + 7) / 8 * size.y;
+	const char *names[] = { "base", "overlay", "blend", "hole", "nav", "auto" };
+	PackedByteArray arrays[6];
+	for (int i = 0; i < 6; i++) {
+		if (!p_lanes.has(names[i])) {
+			continue;
+		}
+		arrays[i] = p_lanes[names[i]];
+		if (arrays[i].size() != ((i < 3) ? count : mask_size)) {
+			LOG(ERROR, "Lane ", names[i], " has ", arrays[i].size(), " bytes, expected ", (i < 3) ? count : mask_size);
+			return;
+		}
+	}
+	ControlLanes lanes;
+	uint8_t **ptrs[] = { &lanes.base, &lanes.overlay, &lanes.blend, &lanes.hole, &lanes.nav, &lanes.autoshader };
+	for (int i = 0; i < 6; i++) {
+		*ptrs[i] = arrays[i].is_empty() ? nullptr : arrays[i].ptrw();
+	}
+	encode_control_rect_px(Rect2i(_get_px(p_global_position), size), lanes);
+}
+
+/**
+ * Casts a ray against the height maps on the CPU, returning the first hit position.
+ * Regions are stepped through with a DDA, then each region's height pyramid is descended
+ * to the quads the ray crosses, which are intersected exactly. Holes are ignored.
+ * Returns Vector3(FLT_MAX, FLT_MAX, FLT_MAX) if nothing is hit within p_max_distance.
+ */
+Vector3 Terrain3DStorage::raycast(Vector3 p_from, Vector3 p_direction, real_t p_max_distance) const {
+	ReadLock lock(_map_lock);
+	return _raycast(p_from, p_direction, p_max_distance);
+}
+
+Vector3 Terrain3DStorage::_raycast(Vector3 p_from, Vector3 p_direction, real_t p_max_distance) const {
+	Vector3 miss = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	if (p_direction.length_squared() < CMP_EPSILON2 || _height_pyramids.is_empty()) {
+		return miss;
+	}
+	p_direction.normalize();
+	// Descale X/Z so pixels are unit sized. t remains in world units
+	Vector3 origin = Vector3(p_from.x / _mesh_vertex_spacing, p_from.y, p_from.z / _mesh_vertex_spacing);
+	Vector3 dir = Vector3(p_direction.x / _mesh_vertex_spacing, p_direction.y, p_direction.z / _mesh_vertex_spacing);
+
+	// Clip to the bounds of all regions
+	int rs = _region_size;
+	Rect2i bounds = _region_map.get_bounds();
+	real_t t0 = 0.f;
+	real_t t1 = p_max_distance;
+	if (!_clip_ray(origin, dir, Vector2(bounds.position * rs), Vector2(bounds.get_end() * rs), t0, t1)) {
+		return miss;
+	}
+
+	// DDA over the region grid
+	Vector3 p = origin + dir * t0;
+	Vector2i cell = Vector2i(floor_div(int(Math::floor(p.x)), rs), floor_div(int(Math::floor(p.z)), rs));
+	cell = Vector2i(CLAMP(cell.x, bounds.position.x, bounds.get_end().x - 1), CLAMP(cell.y, bounds.position.y, bounds.get_end().y - 1));
+	Vector2i step = Vector2i(dir.x > 0.f ? 1 : -1, dir.z > 0.f ? 1 : -1);
+	real_t t_delta_x = (dir.x != 0.f) ? Math::abs(real_t(rs) / dir.x) : real_t(FLT_MAX);
+	real_t t_delta_z = (dir.z != 0.f) ? Math::abs(real_t(rs) / dir.z) : real_t(FLT_MAX);
+	real_t t_max_x = (dir.x != 0.f) ? (real_t((cell.x + (step.x > 0 ? 1 : 0)) * rs) - origin.x) / dir.x : real_t(FLT_MAX);
+	real_t t_max_z = (dir.z != 0.f) ? (real_t((cell.y + (step.y > 0 ? 1 : 0)) * rs) - origin.z) / dir.z : real_t(FLT_MAX);
+	real_t t = t0;
+	while (t <= t1) {
+		real_t t_next = MIN(MIN(t_max_x, t_max_z), t1);
+		int region = _region_map.get(cell);
+		if (_has_pyramid(region)) {
+			real_t hit = _raycast_region(region, origin, dir, t, t_next);
+			if (hit >= 0.f) {
+				return p_from + p_direction * hit;
+			}
+		}
+		if (t_next >= t1) {
+			break;
+		}
+		if (t_max_x < t_max_z) {
+			cell.x += step.x;
+			t_max_x += t_delta_x;
+		} else {
+			cell.y += step.y;
+			t_max_z += t_delta_z;
+		}
+		if (!bounds.has_point(cell)) {
+			break;
+		}
+		t = t_next;
+	}
+	return miss;
+}
+
+// Casts many rays on the WorkerThreadPool. See raycast()
+PackedVector3Array Terrain3DStorage::raycasts(const PackedVector3Array &p_from, const PackedVector3Array &p_directions, real_t p_max_distance) {
+	PackedVector3Array hits;
+	ERR_FAIL_COND_V_MSG(p_from.size() != p_directions.size(), hits, "from and directions must be the same size");
+	hits.resize(p_from.size());
+	Vector3 *out = hits.ptrw();
+	const Vector3 *dirs = p_directions.ptr();
+	_process_batch(p_from, [this, out, dirs, p_max_distance](int p_index, const Vector3 &p_pos) {
+		out[p_index] = _raycast(p_pos, dirs[p_index], p_max_distance);
+	});
+	return hits;
+}
+
 /**
  * Returns sanitized maps of either a region set or a uniform set
  * Verifies size, vailidity, and format of maps
@@ -521,19 +2594,10 @@ TypedArray<Image> Terrain3DStorage::sanitize_maps(MapType p_map_type, const Type
 		}
 	}
 
-	Image::Format format;
-	const char *type_str;
-	Color color;
 	for (int i = 0; i < iterations; i++) {
-		if (p_map_type == TYPE_MAX) {
-			format = FORMAT[i];
-			type_str = TYPESTR[i];
-			color = COLOR[i];
-		} else {
-			format = FORMAT[p_map_type];
-			type_str = TYPESTR[p_map_type];
-			color = COLOR[p_map_type];
-		}
+		MapType type = (p_map_type == TYPE_MAX) ? static_cast<MapType>(i) : p_map_type;
+		Image::Format format = _get_format(type);
+		const char *type_str = TYPESTR[type];
 
 		if (i < p_maps.size()) {
 			Ref<Image> img;
@@ -542,14 +2606,18 @@ TypedArray<Image> Terrain3DStorage::sanitize_maps(MapType p_map_type, const Type
 				if (img->get_size() == _region_sizev) {
 					if (img->get_format() == format) {
 						LOG(DEBUG, "Map type ", type_str, " correct format, size. Using image");
-						images[i] = img;
+						images[i] = _get_shared_map(img);
 					} else {
 						LOG(DEBUG, "Provided ", type_str, " map wrong format: ", img->get_format(), ". Converting copy to: ", format);
 						Ref<Image> newimg;
 						newimg.instantiate();
 						newimg->copy_from(img);
-						newimg->convert(format);
-						images[i] = newimg;
+						if (format == Image::FORMAT_RH && newimg->get_format() == Image::FORMAT_RF) {
+							_quantize_heights(newimg);
+						} else {
+							newimg->convert(format);
+						}
+						images[i] = _get_shared_map(newimg);
 					}
 					continue; // Continue for loop
 				} else {
@@ -561,33 +2629,118 @@ TypedArray<Image> Terrain3DStorage::sanitize_maps(MapType p_map_type, const Type
 		} else {
 			LOG(DEBUG, "p_images.size() < ", i, ". Creating blank");
 		}
-		images[i] = Util::get_filled_image(_region_sizev, color, false, format);
+		images[i] = _get_blank_map(type);
 	}
 
 	return images;
 }
 
-void Terrain3DStorage::force_update_maps(MapType p_map_type) {
-	switch (p_map_type) {
-		case TYPE_HEIGHT:
-			_generated_height_maps.clear();
-			break;
-		case TYPE_CONTROL:
-			_generated_control_maps.clear();
-			break;
-		case TYPE_COLOR:
-			_generated_color_maps.clear();
-			break;
-		default:
-			_generated_height_maps.clear();
-			_generated_control_maps.clear();
-			_generated_color_maps.clear();
-			break;
+/**
+ * Returns the memory used by the maps, in bytes:
+ *	maps - number of maps
+ *	shared - maps sharing their data with other uniform maps
+ *	memory - bytes allocated for map data
+ *	saved - bytes not allocated because maps share data
+ *	gpu - bytes in the texture arrays. Each region has its own layer, shared or not
+ */
+Dictionary Terrain3DStorage::get_map_memory_usage() const {
+	int64_t maps = 0;
+	int64_t shared = 0;
+	int64_t total = 0;
+	int64_t memory = 0;
+	HashSet<const uint8_t *> buffers;
+	const TypedArray<Image> *types[] = { &_height_maps, &_control_maps, &_color_maps };
+	for (int t = 0; t < TYPE_MAX; t++) {
+		for (int i = 0; i < types[t]->size(); i++) {
+			Ref<Image> map = (*types[t])[i];
+			if (map.is_null() || map->is_empty()) {
+				continue;
+			}
+			int64_t size = map->get_data().size();
+			maps++;
+			total += size;
+			// Maps sharing data copy-on-write point to the same buffer
+			if (buffers.has(map->ptr())) {
+				shared++;
+			} else {
+				buffers.insert(map->ptr());
+				memory += size;
+			}
+		}
+	}
+	Dictionary dict;
+	dict["maps"] = maps;
+	dict["shared"] = shared;
+	dict["memory"] = memory;
+	dict["saved"] = total - memory;
+	dict["gpu"] = total;
+	return dict;
+}
+
+/**
+ * Uploads the specified maps to the GPU. If p_region_index is specified, only that region's
+ * layer is uploaded, otherwise all layers are. The TextureArrays are only recreated if the
+ * number of regions changed. The uploaded maps are marked modified, as they may have been
+ * edited in place.
+ */
+void Terrain3DStorage::force_update_maps(MapType p_map_type, int p_region_index) {
+	_update_maps(p_map_type, p_region_index, true);
+}
+
+// As force_update_maps(). Without p_mark_modified, eg. on load, all layers are uploaded without marking regions
+void Terrain3DStorage::_update_maps(MapType p_map_type, int p_region_index, bool p_mark_modified) {
+	if (p_region_index < 0 && (p_map_type == TYPE_HEIGHT || p_map_type == TYPE_MAX)) {
+		_height_pyramids_dirty = true;
+	}
+	// Pixels edited in this region since it last updated, or empty if unknown
+	Rect2i edited_rect;
+	if (p_region_index >= 0 && p_region_index < _region_offsets.size() && _edited_rects.has(_region_offsets[p_region_index])) {
+		edited_rect = _edited_rects[_region_offsets[p_region_index]];
+		_edited_rects.erase(_region_offsets[p_region_index]);
+	}
+	GeneratedTexture *gen[] = { &_generated_height_maps, &_generated_control_maps, &_generated_color_maps };
+	for (int t = 0; t < TYPE_MAX; t++) {
+		if (p_map_type != TYPE_MAX && p_map_type != t) {
+			continue;
+		}
+		int layer_count = get_maps(static_cast<MapType>(t)).size();
+		if (p_region_index >= 0) {
+			gen[t]->set_layer_dirty(p_region_index);
+			if (p_region_index < _region_offsets.size()) {
+				_set_region_modified(_region_offsets[p_region_index], 1 << t);
+				if (t == TYPE_COLOR) {
+					_set_color_mipmaps_dirty(_region_offsets[p_region_index], edited_rect);
+				}
+			}
+			continue;
+		}
+		for (int i = 0; i < _region_offsets.size(); i++) {
+			if (p_mark_modified) {
+				_set_region_modified(_region_offsets[i], 1 << t);
+			}
+			if (t == TYPE_COLOR) {
+				_set_color_mipmaps_dirty(_region_offsets[i]);
+			}
+		}
+		if (gen[t]->needs_rebuild(layer_count)) {
+			gen[t]->clear();
+		} else {
+			for (int i = 0; i < layer_count; i++) {
+				gen[t]->set_layer_dirty(i);
+			}
+		}
 	}
 	update_regions();
 }
 
-void Terrain3DStorage::save() {
+/**
+ * Saves to the external resource file. With p_background, region files are written and the
+ * snapshot compressed on the WorkerThreadPool, so editing can continue, then the resource is saved
+ * on the main thread. save_progress is emitted as it goes and save_finished when done.
+ * A save in progress is finished before another starts.
+ */
+void Terrain3DStorage::save(bool p_background) {
+	_wait_for_save();
 	if (!_modified) {
 		LOG(INFO, "Save requested, but not modified. Skipping");
 		return;
@@ -598,36 +2751,126 @@ void Terrain3DStorage::save() {
 		LOG(DEBUG, "Attempting to save terrain data to external file: " + path);
 		LOG(DEBUG, "Saving storage version: ", vformat("%.3f", CURRENT_VERSION));
 		set_version(CURRENT_VERSION);
-		Error err;
-		if (_save_16_bit) {
-			LOG(DEBUG, "16-bit save requested, converting heightmaps");
-			TypedArray<Image> original_maps;
-			original_maps = get_maps_copy(Terrain3DStorage::MapType::TYPE_HEIGHT);
-			for (int i = 0; i < _height_maps.size(); i++) {
-				Ref<Image> img = _height_maps[i];
-				img->convert(Image::FORMAT_RH);
-			}
-			LOG(DEBUG, "Images converted, saving");
-			err = ResourceSaver::get_singleton()->save(this, path, ResourceSaver::FLAG_COMPRESS);
-
-			LOG(DEBUG, "Restoring 32-bit maps");
-			_height_maps = original_maps;
-
+		// With streaming, regions live in streaming_directory, where only modified ones are
+		// rewritten. The resource keeps the settings
+		String directory = (_streaming_enabled && !_streaming_directory.is_empty()) ? _streaming_directory : String();
+		SaveJob *job = _create_save_job(path, directory);
+		if (p_background) {
+			job->background = true;
+			_save_job = job;
+			job->task_id = WorkerThreadPool::get_singleton()->add_native_task(&Terrain3DStorage::_save_task, job, false, "Terrain3DStorage save");
+			LOG(INFO, "Saving terrain data in the background");
 		} else {
-			err = ResourceSaver::get_singleton()->save(this, path, ResourceSaver::FLAG_COMPRESS);
+			_write_save_job(job);
+			_finish_save_job(job);
 		}
-		ERR_FAIL_COND(err);
-		LOG(DEBUG, "ResourceSaver return error (0 is OK): ", err);
-		if (err == OK) {
-			_modified = false;
-		}
-		LOG(INFO, "Finished saving terrain data");
 	}
 	if (path.get_extension() != "res") {
 		LOG(WARN, "Storage resource is not saved as an external, binary .res file");
 	}
 }
 
+/**
+ * Losslessly compresses all regions with RegionCodec, in parallel on the WorkerThreadPool.
+ * Returns an Array of PackedByteArrays, parallel to region_offsets, or an empty Array on failure.
+ */
+Array Terrain3DStorage::compress_regions() const {
+	int count = _region_offsets.size();
+	if (count == 0) {
+		return Array();
+	}
+	if (_height_maps.size() != count || _control_maps.size() != count || _color_maps.size() != count) {
+		LOG(ERROR, "Map counts don't match ", count, " regions. Cannot compress");
+		return Array();
+	}
+	Vector<TypedArray<Image>> maps;
+	Vector<PackedByteArray> data;
+	Vector<Error> errors;
+	maps.resize(count);
+	data.resize(count);
+	errors.resize(count);
+	for (int i = 0; i < count; i++) {
+		TypedArray<Image> region_maps;
+		region_maps.push_back(_height_maps[i]);
+		region_maps.push_back(_control_maps[i]);
+		region_maps.push_back(_color_maps[i]);
+		maps.set(i, region_maps);
+	}
+	CodecJob job;
+	job.encode = true;
+	job.maps = maps.ptrw();
+	job.data = data.ptrw();
+	job.errors = errors.ptrw();
+	uint64_t start = Time::get_singleton()->get_ticks_msec();
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	int64_t task_id = wtp->add_native_group_task(&Terrain3DStorage::_codec_task, &job, count, -1, true, "Terrain3DStorage compress regions");
+	wtp->wait_for_group_task_completion(task_id);
+
+	Array out;
+	uint64_t packed_size = 0;
+	for (int i = 0; i < count; i++) {
+		if (errors[i] != OK) {
+			LOG(ERROR, "Failed to compress region ", _region_offsets[i]);
+			return Array();
+		}
+		packed_size += data[i].size();
+		out.push_back(data[i]);
+	}
+	LOG(INFO, "Compressed ", count, " regions to ", packed_size / 1024, " KB in ", Time::get_singleton()->get_ticks_msec() - start, " ms");
+	return out;
+}
+
+// Replaces all maps with those decoded from compress_regions() data, in parallel
+Error Terrain3DStorage::decompress_regions(const Array &p_data) {
+	int count = p_data.size();
+	if (count != _region_offsets.size()) {
+		LOG(ERROR, "Compressed data has ", count, " regions, but there are ", _region_offsets.size(), " region offsets");
+		return ERR_INVALID_DATA;
+	}
+	Vector<TypedArray<Image>> maps;
+	Vector<PackedByteArray> data;
+	Vector<Error> errors;
+	maps.resize(count);
+	data.resize(count);
+	errors.resize(count);
+	for (int i = 0; i < count; i++) {
+		data.set(i, p_data[i]);
+	}
+	CodecJob job;
+	job.encode = false;
+	job.maps = maps.ptrw();
+	job.data = data.ptrw();
+	job.errors = errors.ptrw();
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	int64_t task_id = wtp->add_native_group_task(&Terrain3DStorage::_codec_task, &job, count, -1, true, "Terrain3DStorage decompress regions");
+	wtp->wait_for_group_task_completion(task_id);
+
+	TypedArray<Image> type_maps[TYPE_MAX];
+	for (int i = 0; i < count; i++) {
+		if (errors[i] != OK || maps[i].size() != TYPE_MAX) {
+			LOG(ERROR, "Failed to decompress region ", _region_offsets[i]);
+			return ERR_FILE_CORRUPT;
+		}
+		for (int t = 0; t < TYPE_MAX; t++) {
+			type_maps[t].push_back(maps[i][t]);
+		}
+	}
+	_height_maps = sanitize_maps(TYPE_HEIGHT, type_maps[TYPE_HEIGHT]);
+	_control_maps = sanitize_maps(TYPE_CONTROL, type_maps[TYPE_CONTROL]);
+	_color_maps = sanitize_maps(TYPE_COLOR, type_maps[TYPE_COLOR]);
+	force_update_maps();
+	return OK;
+}
+
+// Storage only property, empty unless saved with save_compressed
+void Terrain3DStorage::set_compressed_regions(const Array &p_data) {
+	if (p_data.is_empty()) {
+		return;
+	}
+	LOG(INFO, "Decompressing ", p_data.size(), " regions");
+	decompress_regions(p_data);
+}
+
 /**
  * Imports an Image set (Height, Control, Color) into Terrain3DStorage
  * It does NOT normalize values to 0-1. You must do that using get_min_max() and adjusting scale and offset.
@@ -664,85 +2907,178 @@ void Terrain3DStorage::import_images(const TypedArray<Image> &p_images, Vector3
 		return;
 	}
 
-	Vector3 descaled_position = p_global_position / _mesh_vertex_spacing;
-	int max_dimension = _region_size * REGION_MAP_SIZE / 2;
-	if ((abs(descaled_position.x) > max_dimension) || (abs(descaled_position.z) > max_dimension)) {
-		LOG(ERROR, "Specify a position within +/-", Vector3(max_dimension, 0.f, max_dimension) * _mesh_vertex_spacing);
-		return;
-	}
-	if ((descaled_position.x + img_size.x > max_dimension) ||
-			(descaled_position.z + img_size.y > max_dimension)) {
-		LOG(ERROR, img_size, " image will not fit at ", p_global_position,
-				". Try ", -(img_size * _mesh_vertex_spacing) / 2.f, " to center");
+	if (!_check_import_area(p_global_position, img_size)) {
 		return;
 	}
+	Vector3 descaled_position = p_global_position / _mesh_vertex_spacing;
 
-	TypedArray<Image> tmp_images;
-	tmp_images.resize(TYPE_MAX);
+	uint64_t start_time = Time::get_singleton()->get_ticks_msec();
 
+	// Sources are read directly in their map's format. Only images in other formats are copied
+	ImportJob job;
+	PackedByteArray sources[TYPE_MAX];
 	for (int i = 0; i < TYPE_MAX; i++) {
+		PackedByteArray fill = Util::get_filled_image(Vector2i(1, 1), COLOR[i], false, FORMAT[i])->get_data();
+		memcpy(&job.fill[i], fill.ptr(), sizeof(uint32_t));
 		Ref<Image> img = p_images[i];
-		tmp_images[i] = img;
-		if (img.is_null()) {
+		if (img.is_null() || img->is_empty()) {
 			continue;
 		}
-
-		// Apply scale and offsets to a new heightmap if applicable
-		if (i == TYPE_HEIGHT && (p_offset != 0.f || p_scale != 1.f)) {
-			LOG(DEBUG, "Creating new temp image to adjust scale: ", p_scale, " offset: ", p_offset);
-			Ref<Image> newimg = Image::create(img->get_size().x, img->get_size().y, false, FORMAT[TYPE_HEIGHT]);
-			for (int y = 0; y < img->get_height(); y++) {
-				for (int x = 0; x < img->get_width(); x++) {
-					Color clr = img->get_pixel(x, y);
-					clr.r = (clr.r * p_scale) + p_offset;
-					newimg->set_pixel(x, y, clr);
-				}
-			}
-			tmp_images[i] = newimg;
+		if (img->get_format() != FORMAT[i]) {
+			LOG(DEBUG, "Converting ", TYPESTR[i], " image from format ", img->get_format(), " to ", FORMAT[i]);
+			img = img->duplicate();
+			img->convert(FORMAT[i]);
 		}
+		sources[i] = img->get_data();
+		job.sources[i] = sources[i].ptr();
 	}
 
 	// Slice up incoming image into segments of region_size^2, and pad any remainder
-	int slices_width = ceil(real_t(img_size.x) / real_t(_region_size));
-	int slices_height = ceil(real_t(img_size.y) / real_t(_region_size));
-	slices_width = CLAMP(slices_width, 1, REGION_MAP_SIZE);
-	slices_height = CLAMP(slices_height, 1, REGION_MAP_SIZE);
+	int slices_width = MAX(1, (img_size.x + _region_size - 1) / _region_size);
+	int slices_height = MAX(1, (img_size.y + _region_size - 1) / _region_size);
+	int slice_count = slices_width * slices_height;
 	LOG(DEBUG, "Creating ", Vector2i(slices_width, slices_height), " slices for ", img_size, " images.");
 
-	for (int y = 0; y < slices_height; y++) {
-		for (int x = 0; x < slices_width; x++) {
-			Vector2i start_coords = Vector2i(x * _region_size, y * _region_size);
-			Vector2i end_coords = Vector2i((x + 1) * _region_size, (y + 1) * _region_size);
-			LOG(DEBUG, "Reviewing image section ", start_coords, " to ", end_coords);
+	Vector<Ref<Image>> maps;
+	maps.resize(slice_count * TYPE_MAX);
+	job.img_size = img_size;
+	job.region_size = _region_size;
+	job.slices_width = slices_width;
+	job.offset = p_offset;
+	job.scale = p_scale;
+	job.maps = maps.ptrw();
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	int64_t group_id = wtp->add_native_group_task(&Terrain3DStorage::_import_task, &job, slice_count, -1, true, "Terrain3DStorage import");
+	wtp->wait_for_group_task_completion(group_id);
+
+	// Add every region, then rebuild the texture arrays once
+	Dictionary indices = _get_region_indices();
+	for (int i = 0; i < slice_count; i++) {
+		Vector2i start_coords = Vector2i(i % slices_width, i / slices_width) * _region_size;
+		Vector3 position = Vector3(descaled_position.x + start_coords.x, 0.f, descaled_position.z + start_coords.y);
+		TypedArray<Image> images;
+		for (int t = 0; t < TYPE_MAX; t++) {
+			images.push_back(maps[i * TYPE_MAX + t]);
+		}
+		_add_imported_region(get_region_offset(position * _mesh_vertex_spacing), images, indices);
+	}
+	_region_map_dirty = true;
+	_generated_height_maps.clear();
+	_generated_control_maps.clear();
+	_generated_color_maps.clear();
+	update_regions();
+	notify_property_list_changed();
+	emit_changed();
+
+	uint64_t msec = MAX(Time::get_singleton()->get_ticks_msec() - start_time, uint64_t(1));
+	real_t megapixels = real_t(img_size.x) * real_t(img_size.y) / 1000000.f;
+	LOG(INFO, "Imported ", slice_count, " regions from ", img_size, " images in ", msec, " ms, ",
+			vformat("%.1f", megapixels * 1000.f / real_t(msec)), " megapixels/s");
+}
 
-			Vector2i size_to_copy;
-			if (end_coords.x <= img_size.x && end_coords.y <= img_size.y) {
-				size_to_copy = _region_sizev;
-			} else {
-				size_to_copy.x = img_size.x - start_coords.x;
-				size_to_copy.y = img_size.y - start_coords.y;
-				LOG(DEBUG, "Uneven end piece. Copying padded slice ", Vector2i(x, y), " size to copy: ", size_to_copy);
+/**
+ * Imports an r16/raw heightmap directly from disk, without loading the whole file into an Image.
+ * The file is read one band of regions at a time, one row per read, and each row is converted and
+ * split straight into the band's height maps. Peak memory beyond the storage itself is one band.
+ * Control and color maps are blank. Use import_images() to import those.
+ * Parameters:
+ *	p_file_name - r16 or raw file of little endian, unsigned 16-bit heights
+ *	p_global_position - X,0,Z location on the region map. Valid range is ~ (+/-8192, +/-8192)
+ *	p_height_range - Heights 0 and 65535 are mapped to x and y
+ *	p_size - Image dimensions. Default (0,0) auto detects square images. Required for non-square files
+ */
+Error Terrain3DStorage::import_r16(const String &p_file_name, Vector3 p_global_position, Vector2 p_height_range, Vector2i p_size) {
+	Ref<FileAccess> file = FileAccess::open(p_file_name, FileAccess::READ);
+	if (file.is_null()) {
+		LOG(ERROR, "Cannot open file: ", p_file_name);
+		return FileAccess::get_open_error();
+	}
+	uint64_t length = file->get_length();
+	if (p_size <= Vector2i(0, 0)) {
+		int width = int(Math::sqrt(double(length / 2)));
+		p_size = Vector2i(width, width);
+		LOG(DEBUG, "Total file size is: ", length, " calculated dimensions: ", p_size);
+	}
+	if (p_size.x <= 0 || p_size.y <= 0 || uint64_t(p_size.x) * uint64_t(p_size.y) * 2 > length) {
+		LOG(ERROR, "File ", p_file_name, " of ", length, " bytes is too small for ", p_size, " heights");
+		return ERR_FILE_CORRUPT;
+	}
+	if (!_check_import_area(p_global_position, p_size)) {
+		return ERR_PARAMETER_RANGE_ERROR;
+	}
+	LOG(INFO, "Importing r16 file: ", p_file_name, ", size: ", p_size, ", height range: ", p_height_range);
+	uint64_t start_time = Time::get_singleton()->get_ticks_msec();
+
+	Vector3 descaled_position = p_global_position / _mesh_vertex_spacing;
+	int slices_width = (p_size.x + _region_size - 1) / _region_size;
+	int slices_height = (p_size.y + _region_size - 1) / _region_size;
+	float scale = float(p_height_range.y - p_height_range.x) / 65535.f;
+	float offset = float(p_height_range.x);
+	float blank = float(COLOR[TYPE_HEIGHT].r);
+	int64_t region_pixels = int64_t(_region_size) * _region_size;
+
+	Vector<PackedByteArray> band;
+	band.resize(slices_width);
+	Dictionary indices = _get_region_indices();
+	Error err = OK;
+	for (int sy = 0; sy < slices_height && err == OK; sy++) {
+		for (int sx = 0; sx < slices_width; sx++) {
+			PackedByteArray &data = band.write[sx];
+			data.resize(region_pixels * sizeof(float));
+			float *dst = reinterpret_cast<float *>(data.ptrw());
+			for (int64_t i = 0; i < region_pixels; i++) {
+				dst[i] = blank;
 			}
+		}
 
-			LOG(DEBUG, "Copying ", size_to_copy, " sized segment");
-			TypedArray<Image> images;
-			images.resize(TYPE_MAX);
-			for (int i = 0; i < TYPE_MAX; i++) {
-				Ref<Image> img = tmp_images[i];
-				Ref<Image> img_slice;
-				if (img.is_valid() && !img->is_empty()) {
-					img_slice = Util::get_filled_image(_region_sizev, COLOR[i], false, img->get_format());
-					img_slice->blit_rect(tmp_images[i], Rect2i(start_coords, size_to_copy), Vector2i(0, 0));
-				} else {
-					img_slice = Util::get_filled_image(_region_sizev, COLOR[i], false, FORMAT[i]);
+		int rows = MIN(_region_size, p_size.y - sy * _region_size);
+		for (int y = 0; y < rows; y++) {
+			PackedByteArray row = file->get_buffer(int64_t(p_size.x) * 2);
+			if (row.size() != int64_t(p_size.x) * 2) {
+				LOG(ERROR, "Read failed at row ", sy * _region_size + y, " of ", p_file_name);
+				err = ERR_FILE_CORRUPT;
+				break;
+			}
+			const uint8_t *src = row.ptr();
+			for (int sx = 0; sx < slices_width; sx++) {
+				float *dst = reinterpret_cast<float *>(band.write[sx].ptrw()) + int64_t(y) * _region_size;
+				int x0 = sx * _region_size;
+				int count = MIN(_region_size, p_size.x - x0);
+				const uint8_t *src_px = src + int64_t(x0) * 2;
+				for (int x = 0; x < count; x++) {
+					uint16_t h = uint16_t(src_px[x * 2]) | (uint16_t(src_px[x * 2 + 1]) << 8);
+					dst[x] = float(h) * scale + offset;
 				}
-				images[i] = img_slice;
 			}
-			// Add the heightmap slice and only regenerate on the last one
-			Vector3 position = Vector3(descaled_position.x + start_coords.x, 0.f, descaled_position.z + start_coords.y);
-			add_region(position * _mesh_vertex_spacing, images, (x == slices_width - 1 && y == slices_height - 1));
 		}
-	} // for y < slices_height, x < slices_width
+		if (err != OK) {
+			break;
+		}
+
+		for (int sx = 0; sx < slices_width; sx++) {
+			Vector3 position = Vector3(descaled_position.x + sx * _region_size, 0.f, descaled_position.z + sy * _region_size);
+			TypedArray<Image> images;
+			images.resize(TYPE_MAX);
+			images[TYPE_HEIGHT] = Image::create_from_data(_region_size, _region_size, false, FORMAT[TYPE_HEIGHT], band[sx]);
+			_add_imported_region(get_region_offset(position * _mesh_vertex_spacing), images, indices);
+		}
+		LOG(DEBUG, "Imported band ", sy + 1, " of ", slices_height);
+	}
+
+	// Regions imported before an error are kept
+	_region_map_dirty = true;
+	_generated_height_maps.clear();
+	_generated_control_maps.clear();
+	_generated_color_maps.clear();
+	update_regions();
+	notify_property_list_changed();
+	emit_changed();
+
+	uint64_t msec = MAX(Time::get_singleton()->get_ticks_msec() - start_time, uint64_t(1));
+	real_t megapixels = real_t(p_size.x) * real_t(p_size.y) / 1000000.f;
+	LOG(INFO, "Imported ", slices_width * slices_height, " regions from ", p_file_name, " in ", msec, " ms, ",
+			vformat("%.1f", megapixels * 1000.f / real_t(msec)), " megapixels/s");
+	return err;
 }
 
 /** Exports a specified map as one of r16/raw, exr, jpg, png, webp, res, tres
@@ -801,79 +3137,134 @@ Error Terrain3DStorage::export_image(String p_file_name, MapType p_map_type) {
 	}
 	file_ref->close();
 
-	// Filename is validated. Begin export image generation
+	// Filename is validated. Heights for r16 are streamed, other formats need the full sized image
+	String ext = p_file_name.get_extension().to_lower();
+	if (ext == "r16" || ext == "raw") {
+		if (p_map_type != TYPE_HEIGHT) {
+			LOG(ERROR, "Only height maps can be exported as r16/raw");
+			return FAILED;
+		}
+		return _export_r16(p_file_name);
+	}
 	Ref<Image> img = layered_to_image(p_map_type);
 	if (img.is_null() || img->is_empty()) {
 		LOG(ERROR, "Could not create an export image for map type: ", TYPESTR[p_map_type]);
 		return FAILED;
 	}
 
-	String ext = p_file_name.get_extension().to_lower();
 	LOG(MESG, "Saving ", img->get_size(), " sized ", TYPESTR[p_map_type],
 			" map in format ", img->get_format(), " as ", ext, " to: ", p_file_name);
-	if (ext == "r16" || ext == "raw") {
-		Vector2i minmax = Util::get_min_max(img);
-		Ref<FileAccess> file = FileAccess::open(p_file_name, FileAccess::WRITE);
-		real_t height_min = minmax.x;
-		real_t height_max = minmax.y;
-		real_t hscale = 65535.0 / (height_max - height_min);
-		for (int y = 0; y < img->get_height(); y++) {
-			for (int x = 0; x < img->get_width(); x++) {
-				int h = int((img->get_pixel(x, y).r - height_min) * hscale);
-				h = CLAMP(h, 0, 65535);
-				file->store_16(h);
-			}
-		}
-		return file->get_error();
-	} else if (ext == "exr") {
-		return img->save_exr(p_file_name, (p_map_type == TYPE_HEIGHT) ? true : false);
-	} else if (ext == "png") {
-		return img->save_png(p_file_name);
-	} else if (ext == "jpg") {
-		return img->save_jpg(p_file_name);
-	} else if (ext == "webp") {
-		return img->save_webp(p_file_name);
-	} else if ((ext == "res") || (ext == "tres")) {
-		return ResourceSaver::get_singleton()->save(img, p_file_name, ResourceSaver::FLAG_COMPRESS);
+	return _save_image(img, p_file_name, p_map_type);
+}
+
+/**
+ * Exports a map as one file per region, named <type>_<x>_<y>.<extension> after the region offset,
+ * e.g. height_-1_0.exr. Files are written in parallel. r16 heights share one range over all regions,
+ * the same as export_image().
+ */
+Error Terrain3DStorage::export_region_images(const String &p_directory, MapType p_map_type, const String &p_extension) {
+	if (p_map_type < 0 || p_map_type >= TYPE_MAX) {
+		LOG(ERROR, "Invalid map type specified: ", p_map_type, " max: ", TYPE_MAX - 1);
+		return FAILED;
+	}
+	if (get_region_count() == 0) {
+		LOG(ERROR, "No valid regions. Nothing to export");
+		return FAILED;
+	}
+	String ext = p_extension.trim_prefix(".").to_lower();
+	if ((ext == "r16" || ext == "raw") && p_map_type != TYPE_HEIGHT) {
+		LOG(ERROR, "Only height maps can be exported as r16/raw");
+		return FAILED;
+	}
+	Error err = DirAccess::make_dir_recursive_absolute(p_directory);
+	if (err != OK) {
+		LOG(ERROR, "Cannot create directory: ", p_directory);
+		return err;
 	}
 
-	LOG(ERROR, "No recognized file type. See docs for valid extensions");
-	return FAILED;
+	ExportTilesJob job;
+	job.map_type = p_map_type;
+	if (p_map_type == TYPE_HEIGHT) {
+		Vector2 range = _get_export_height_range();
+		job.height_min = float(range.x);
+		job.height_scale = (range.y > range.x) ? 65535.f / float(range.y - range.x) : 0.f;
+		LOG(MESG, "Exporting heights with range: ", range);
+	}
+	String type = String(TYPESTR[p_map_type]).trim_prefix("TYPE_").to_lower();
+	for (int i = 0; i < _region_offsets.size(); i++) {
+		Vector2i offset = _region_offsets[i];
+		job.maps.push_back(get_map_region(p_map_type, i));
+		job.paths.push_back(p_directory.path_join(vformat("%s_%d_%d.%s", type, offset.x, offset.y, ext)));
+	}
+	Vector<Error> errors;
+	errors.resize(job.maps.size());
+	job.errors = errors.ptrw();
+	LOG(INFO, "Exporting ", job.maps.size(), " ", TYPESTR[p_map_type], " maps as ", ext, " to: ", p_directory);
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	int64_t group_id = wtp->add_native_group_task(&Terrain3DStorage::_export_tile_task, &job, job.maps.size(), -1, true, "Terrain3DStorage export regions");
+	wtp->wait_for_group_task_completion(group_id);
+
+	for (int i = 0; i < errors.size(); i++) {
+		if (errors[i] != OK) {
+			LOG(ERROR, "Error ", errors[i], " exporting: ", job.paths[i]);
+			err = errors[i];
+		}
+	}
+	return err;
 }
 
+// Copies all regions into one full sized image in parallel, one region per task
 Ref<Image> Terrain3DStorage::layered_to_image(MapType p_map_type) {
 	LOG(INFO, "Generating a full sized image for all regions including empty regions");
 	if (p_map_type >= TYPE_MAX) {
 		p_map_type = TYPE_HEIGHT;
 	}
-	Vector2i top_left = Vector2i(0, 0);
-	Vector2i bottom_right = Vector2i(0, 0);
+	Vector2i top_left;
+	Vector2i bottom_right;
+	_get_region_bounds(top_left, bottom_right);
+	Vector2i slots = bottom_right - top_left + Vector2i(1, 1);
+	Vector2i img_size = slots * _region_size;
+	LOG(DEBUG, "Image size: ", img_size);
+
+	Image::Format format = _get_format(p_map_type);
+	int pixel_size = (format == Image::FORMAT_RH) ? 2 : 4;
+	PackedByteArray fill = Util::get_filled_image(Vector2i(1, 1), COLOR[p_map_type], false, format)->get_data();
+	PackedByteArray data;
+	data.resize(int64_t(img_size.x) * img_size.y * pixel_size);
+
+	ExportJob job;
+	job.sources.resize(slots.x * slots.y);
+	for (int i = 0; i < job.sources.size(); i++) {
+		job.sources.write[i] = nullptr;
+	}
+	Vector<Ref<Image>> converted; // Keeps maps in other formats alive until the copy is done
 	for (int i = 0; i < _region_offsets.size(); i++) {
-		LOG(DEBUG, "Region offsets[", i, "]: ", _region_offsets[i]);
-		Vector2i region = _region_offsets[i];
-		if (region.x < top_left.x) {
-			top_left.x = region.x;
-		} else if (region.x > bottom_right.x) {
-			bottom_right.x = region.x;
+		Vector2i slot = Vector2i(_region_offsets[i]) - top_left;
+		Ref<Image> map = get_map_region(p_map_type, i);
+		if (map.is_null() || map->get_size() != _region_sizev) {
+			continue;
 		}
-		if (region.y < top_left.y) {
-			top_left.y = region.y;
-		} else if (region.y > bottom_right.y) {
-			bottom_right.y = region.y;
+		if (map->get_format() != format) {
+			map = map->duplicate();
+			map->convert(format);
+			converted.push_back(map);
 		}
+		job.sources.write[slot.y * slots.x + slot.x] = map->ptr();
 	}
-
-	LOG(DEBUG, "Full range to cover all regions: ", top_left, " to ", bottom_right);
-	Vector2i img_size = Vector2i(1 + bottom_right.x - top_left.x, 1 + bottom_right.y - top_left.y) * _region_size;
-	LOG(DEBUG, "Image size: ", img_size);
-	Ref<Image> img = Util::get_filled_image(img_size, COLOR[p_map_type], false, FORMAT[p_map_type]);
-
-	for (int i = 0; i < _region_offsets.size(); i++) {
-		Vector2i region = _region_offsets[i];
-		int index = get_region_index(Vector3(region.x, 0, region.y) * _region_size);
-		Vector2i img_location = (region - top_left) * _region_size;
-		LOG(DEBUG, "Region to blit: ", region, " Export image coords: ", img_location);
-		img->blit_rect(get_map_region(p_map_type, index), Rect2i(Vector2i(0, 0), _region_sizev), img_location);
+	job.slots = slots;
+	job.region_size = _region_size;
+	job.src_pixel_size = pixel_size;
+	job.pixel_size = pixel_size;
+	job.fill = fill.ptr();
+	job.dst = data.ptrw();
+	job.dst_stride = int64_t(img_size.x) * pixel_size;
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	int64_t group_id = wtp->add_native_group_task(&Terrain3DStorage::_export_task, &job, job.sources.size(), -1, true, "Terrain3DStorage export");
+	wtp->wait_for_group_task_completion(group_id);
+
+	Ref<Image> img = Image::create_from_data(img_size.x, img_size.y, false, format, data);
+	if (img->get_format() != FORMAT[p_map_type]) {
+		img->convert(FORMAT[p_map_type]);
 	}
 	return img;
 }
@@ -891,43 +3282,58 @@ Vector3 Terrain3DStorage::get_mesh_vertex(int32_t p_lod, HeightFilter p_filter,
 	LOG(INFO, "Calculating vertex location");
 	int32_t step = 1 << CLAMP(p_lod, 0, 8);
 	real_t height = 0.0f;
+	ReadLock lock(_map_lock);
 
 	switch (p_filter) {
 		case HEIGHT_FILTER_NEAREST: {
-			if (is_hole(get_control(p_global_position))) {
+			if (is_hole(_get_control_px(_get_px(p_global_position)))) {
 				height = NAN;
 			} else {
-				height = get_height(p_global_position);
+				height = _get_height(p_global_position);
 			}
 		} break;
 		case HEIGHT_FILTER_MINIMUM: {
-			height = get_height(p_global_position);
-			for (int32_t dx = -step / 2; dx < step / 2; dx += 1) {
-				for (int32_t dz = -step / 2; dz < step / 2; dz += 1) {
-					Vector3 position = p_global_position + Vector3(dx, 0.f, dz) * _mesh_vertex_spacing;
-					if (is_hole(get_control(position))) {
-						height = NAN;
-						break;
-					}
-					real_t h = get_height(position);
-					if (h < height) {
-						height = h;
-					}
+			height = _get_height(p_global_position);
+			if (step < 2) {
+				break;
+			}
+			// Lowest height from the pyramids, holes decoded from the control maps as one bit mask
+			Vector2i px = _get_px(p_global_position);
+			Rect2i area = Rect2i(px - Vector2i(step / 2, step / 2), Vector2i(step, step));
+			PackedByteArray holes;
+			holes.resize((step + 7) / 8 * step);
+			ControlLanes lanes;
+			lanes.hole = holes.ptrw();
+			_decode_control_rect_px(area, lanes);
+			const uint8_t *hole_ptr = holes.ptr();
+			for (int64_t i = 0; i < holes.size(); i++) {
+				if (hole_ptr[i]) {
+					height = NAN;
+					break;
 				}
 			}
+			real_t min_height = _get_height_range_px(area).x;
+			if (min_height < height) {
+				height = min_height;
+			}
 		} break;
 	}
 	return Vector3(p_global_position.x, height, p_global_position.z);
 }
 
 Vector3 Terrain3DStorage::get_normal(Vector3 p_global_position) {
-	int region = get_region_index(p_global_position);
-	if (region < 0 || region >= _region_offsets.size() || is_hole(get_control(p_global_position))) {
+	ReadLock lock(_map_lock);
+	return _get_normal(p_global_position);
+}
+
+Vector3 Terrain3DStorage::_get_normal(Vector3 p_global_position) const {
+	Vector2i px = _get_px(p_global_position);
+	if (_get_region_index_px(px) < 0 || is_hole(_get_control_px(px))) {
 		return Vector3(NAN, NAN, NAN);
 	}
-	real_t height = get_height(p_global_position);
-	real_t u = height - get_height(p_global_position + Vector3(_mesh_vertex_spacing, 0.0f, 0.0f));
-	real_t v = height - get_height(p_global_position + Vector3(0.f, 0.f, _mesh_vertex_spacing));
+	real_t height = _get_height(p_global_position);
+	real_t u = height - _get_height(p_global_position + Vector3(_mesh_vertex_spacing, 0.0f, 0.0f));
+	real_t v = height - _get_height(p_global_position + Vector3(0.f, 0.f, _mesh_vertex_spacing));
 	Vector3 normal = Vector3(u, _mesh_vertex_spacing, v);
 	normal.normalize();
 	return normal;
@@ -937,11 +3343,10 @@ void Terrain3DStorage::print_audit_data() {
 	LOG(INFO, "Dumping storage data");
 	LOG(INFO, "_modified: ", _modified);
 	LOG(INFO, "Region_offsets size: ", _region_offsets.size(), " ", _region_offsets);
-	LOG(INFO, "Region map");
-	for (int i = 0; i < _region_map.size(); i++) {
-		if (_region_map[i]) {
-			LOG(INFO, "Region id: ", _region_map[i], " array index: ", i);
-		}
+	LOG(INFO, "Region map: ", _region_map.size(), " regions, bounds: ", _region_map.get_bounds());
+	for (int i = 0; i < _region_offsets.size(); i++) {
+		Vector2i offset = _region_offsets[i];
+		LOG(INFO, "Region offset: ", offset, " array index: ", _region_map.get(offset));
 	}
 	Util::dump_maps(_height_maps, "Height maps");
 	Util::dump_maps(_control_maps, "Control maps");
@@ -962,26 +3367,34 @@ void Terrain3DStorage::_bind_methods() {
 	BIND_ENUM_CONSTANT(TYPE_COLOR);
 	BIND_ENUM_CONSTANT(TYPE_MAX);
 
-	//BIND_ENUM_CONSTANT(SIZE_64);
-	//BIND_ENUM_CONSTANT(SIZE_128);
-	//BIND_ENUM_CONSTANT(SIZE_256);
-	//BIND_ENUM_CONSTANT(SIZE_512);
+	BIND_ENUM_CONSTANT(SIZE_64);
+	BIND_ENUM_CONSTANT(SIZE_128);
+	BIND_ENUM_CONSTANT(SIZE_256);
+	BIND_ENUM_CONSTANT(SIZE_512);
 	BIND_ENUM_CONSTANT(SIZE_1024);
-	//BIND_ENUM_CONSTANT(SIZE_2048);
+	BIND_ENUM_CONSTANT(SIZE_2048);
 
 	BIND_ENUM_CONSTANT(HEIGHT_FILTER_NEAREST);
 	BIND_ENUM_CONSTANT(HEIGHT_FILTER_MINIMUM);
 
 	BIND_CONSTANT(REGION_MAP_SIZE);
+	BIND_CONSTANT(REGION_OFFSET_MAX);
 
 	ClassDB::bind_method(D_METHOD("set_version", "version"), &Terrain3DStorage::set_version);
 	ClassDB::bind_method(D_METHOD("get_version"), &Terrain3DStorage::get_version);
 	ClassDB::bind_method(D_METHOD("set_save_16_bit", "enabled"), &Terrain3DStorage::set_save_16_bit);
 	ClassDB::bind_method(D_METHOD("get_save_16_bit"), &Terrain3DStorage::get_save_16_bit);
+	ClassDB::bind_method(D_METHOD("set_resident_16_bit", "enabled"), &Terrain3DStorage::set_resident_16_bit);
+	ClassDB::bind_method(D_METHOD("get_resident_16_bit"), &Terrain3DStorage::get_resident_16_bit);
+	ClassDB::bind_method(D_METHOD("get_height_quantization_error"), &Terrain3DStorage::get_height_quantization_error);
+	ClassDB::bind_method(D_METHOD("set_save_compressed", "enabled"), &Terrain3DStorage::set_save_compressed);
+	ClassDB::bind_method(D_METHOD("get_save_compressed"), &Terrain3DStorage::get_save_compressed);
 
 	ClassDB::bind_method(D_METHOD("set_height_range", "range"), &Terrain3DStorage::set_height_range);
 	ClassDB::bind_method(D_METHOD("get_height_range"), &Terrain3DStorage::get_height_range);
 	ClassDB::bind_method(D_METHOD("update_height_range"), &Terrain3DStorage::update_height_range);
+	ClassDB::bind_method(D_METHOD("get_height_range_rect", "global_rect"), &Terrain3DStorage::get_height_range_rect);
+	ClassDB::bind_method(D_METHOD("get_region_height_range", "region_index"), &Terrain3DStorage::get_region_height_range);
 
 	ClassDB::bind_method(D_METHOD("set_region_size", "size"), &Terrain3DStorage::set_region_size);
 	ClassDB::bind_method(D_METHOD("get_region_size"), &Terrain3DStorage::get_region_size);
@@ -994,11 +3407,30 @@ void Terrain3DStorage::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("add_region", "global_position", "images", "update"), &Terrain3DStorage::add_region, DEFVAL(TypedArray<Image>()), DEFVAL(true));
 	ClassDB::bind_method(D_METHOD("remove_region", "global_position", "update"), &Terrain3DStorage::remove_region, DEFVAL(true));
 
+	ClassDB::bind_method(D_METHOD("set_streaming_enabled", "enabled"), &Terrain3DStorage::set_streaming_enabled);
+	ClassDB::bind_method(D_METHOD("get_streaming_enabled"), &Terrain3DStorage::get_streaming_enabled);
+	ClassDB::bind_method(D_METHOD("set_streaming_directory", "directory"), &Terrain3DStorage::set_streaming_directory);
+	ClassDB::bind_method(D_METHOD("get_streaming_directory"), &Terrain3DStorage::get_streaming_directory);
+	ClassDB::bind_method(D_METHOD("set_stream_load_radius", "radius"), &Terrain3DStorage::set_stream_load_radius);
+	ClassDB::bind_method(D_METHOD("get_stream_load_radius"), &Terrain3DStorage::get_stream_load_radius);
+	ClassDB::bind_method(D_METHOD("set_stream_unload_radius", "radius"), &Terrain3DStorage::set_stream_unload_radius);
+	ClassDB::bind_method(D_METHOD("get_stream_unload_radius"), &Terrain3DStorage::get_stream_unload_radius);
+	ClassDB::bind_method(D_METHOD("get_stream_pending_count"), &Terrain3DStorage::get_stream_pending_count);
+	ClassDB::bind_method(D_METHOD("update_streaming", "global_position"), &Terrain3DStorage::update_streaming);
+	ClassDB::bind_method(D_METHOD("save_region_files", "directory"), &Terrain3DStorage::save_region_files);
+	ClassDB::bind_method(D_METHOD("save_region_container", "path"), &Terrain3DStorage::save_region_container);
+	ClassDB::bind_method(D_METHOD("save_modified_regions", "directory"), &Terrain3DStorage::save_modified_regions);
+	ClassDB::bind_method(D_METHOD("set_region_modified", "region_index", "map_type"), &Terrain3DStorage::set_region_modified, DEFVAL(TYPE_MAX));
+	ClassDB::bind_method(D_METHOD("is_region_modified", "region_index", "map_type"), &Terrain3DStorage::is_region_modified, DEFVAL(TYPE_MAX));
+	ClassDB::bind_method(D_METHOD("get_modified_regions"), &Terrain3DStorage::get_modified_regions);
+
 	ClassDB::bind_method(D_METHOD("set_map_region", "map_type", "region_index", "image"), &Terrain3DStorage::set_map_region);
 	ClassDB::bind_method(D_METHOD("get_map_region", "map_type", "region_index"), &Terrain3DStorage::get_map_region);
 	ClassDB::bind_method(D_METHOD("set_maps", "map_type", "maps"), &Terrain3DStorage::set_maps);
 	ClassDB::bind_method(D_METHOD("get_maps", "map_type"), &Terrain3DStorage::get_maps);
 	ClassDB::bind_method(D_METHOD("get_maps_copy", "map_type"), &Terrain3DStorage::get_maps_copy);
+	ClassDB::bind_method(D_METHOD("create_snapshot"), &Terrain3DStorage::create_snapshot);
+	ClassDB::bind_method(D_METHOD("get_data_version"), &Terrain3DStorage::get_data_version);
 	ClassDB::bind_method(D_METHOD("set_height_maps", "maps"), &Terrain3DStorage::set_height_maps);
 	ClassDB::bind_method(D_METHOD("get_height_maps"), &Terrain3DStorage::get_height_maps);
 	ClassDB::bind_method(D_METHOD("set_control_maps", "maps"), &Terrain3DStorage::set_control_maps);
@@ -1016,11 +3448,26 @@ void Terrain3DStorage::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_roughness", "global_position", "roughness"), &Terrain3DStorage::set_roughness);
 	ClassDB::bind_method(D_METHOD("get_roughness", "global_position"), &Terrain3DStorage::get_roughness);
 	ClassDB::bind_method(D_METHOD("get_texture_id", "global_position"), &Terrain3DStorage::get_texture_id);
-	ClassDB::bind_method(D_METHOD("force_update_maps", "map_type"), &Terrain3DStorage::force_update_maps, DEFVAL(TYPE_MAX));
-
-	ClassDB::bind_method(D_METHOD("save"), &Terrain3DStorage::save);
+	ClassDB::bind_method(D_METHOD("get_heights", "global_positions"), &Terrain3DStorage::get_heights);
+	ClassDB::bind_method(D_METHOD("get_normals", "global_positions"), &Terrain3DStorage::get_normals);
+	ClassDB::bind_method(D_METHOD("get_controls", "global_positions"), &Terrain3DStorage::get_controls);
+	ClassDB::bind_method(D_METHOD("decode_control_rect", "global_position", "size"), &Terrain3DStorage::decode_control_rect);
+	ClassDB::bind_method(D_METHOD("encode_control_rect", "global_position", "lanes"), &Terrain3DStorage::encode_control_rect);
+	ClassDB::bind_method(D_METHOD("raycast", "from", "direction", "max_distance"), &Terrain3DStorage::raycast, DEFVAL(100000.f));
+	ClassDB::bind_method(D_METHOD("raycasts", "from", "directions", "max_distance"), &Terrain3DStorage::raycasts, DEFVAL(100000.f));
+	ClassDB::bind_method(D_METHOD("get_map_memory_usage"), &Terrain3DStorage::get_map_memory_usage);
+	ClassDB::bind_method(D_METHOD("force_update_maps", "map_type", "region_index"), &Terrain3DStorage::force_update_maps, DEFVAL(TYPE_MAX), DEFVAL(-1));
+
+	ClassDB::bind_method(D_METHOD("save", "background"), &Terrain3DStorage::save, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("is_saving"), &Terrain3DStorage::is_saving);
+	ClassDB::bind_method(D_METHOD("compress_regions"), &Terrain3DStorage::compress_regions);
+	ClassDB::bind_method(D_METHOD("decompress_regions", "data"), &Terrain3DStorage::decompress_regions);
+	ClassDB::bind_method(D_METHOD("set_compressed_regions", "data"), &Terrain3DStorage::set_compressed_regions);
+	ClassDB::bind_method(D_METHOD("get_compressed_regions"), &Terrain3DStorage::get_compressed_regions);
 	ClassDB::bind_method(D_METHOD("import_images", "images", "global_position", "offset", "scale"), &Terrain3DStorage::import_images, DEFVAL(Vector3(0, 0, 0)), DEFVAL(0.0), DEFVAL(1.0));
+	ClassDB::bind_method(D_METHOD("import_r16", "file_name", "global_position", "height_range", "size"), &Terrain3DStorage::import_r16, DEFVAL(Vector3(0, 0, 0)), DEFVAL(Vector2(0, 255)), DEFVAL(Vector2i(0, 0)));
 	ClassDB::bind_method(D_METHOD("export_image", "file_name", "map_type"), &Terrain3DStorage::export_image);
+	ClassDB::bind_method(D_METHOD("export_region_images", "directory", "map_type", "extension"), &Terrain3DStorage::export_region_images, DEFVAL(TYPE_HEIGHT), DEFVAL("exr"));
 	ClassDB::bind_method(D_METHOD("layered_to_image", "map_type"), &Terrain3DStorage::layered_to_image);
 
 	ClassDB::bind_method(D_METHOD("get_mesh_vertex", "lod", "filter", "global_position"), &Terrain3DStorage::get_mesh_vertex);
@@ -1028,17 +3475,28 @@ void Terrain3DStorage::_bind_methods() {
 
 	int ro_flags = PROPERTY_USAGE_STORAGE | PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY;
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "version", PROPERTY_HINT_NONE, "", ro_flags), "set_version", "get_version");
-	//ADD_PROPERTY(PropertyInfo(Variant::INT, "region_size", PROPERTY_HINT_ENUM, "64:64, 128:128, 256:256, 512:512, 1024:1024, 2048:2048"), "set_region_size", "get_region_size");
-	ADD_PROPERTY(PropertyInfo(Variant::INT, "region_size", PROPERTY_HINT_ENUM, "1024:1024"), "set_region_size", "get_region_size");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "region_size", PROPERTY_HINT_ENUM, "64:64, 128:128, 256:256, 512:512, 1024:1024, 2048:2048"), "set_region_size", "get_region_size");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "save_16_bit", PROPERTY_HINT_NONE), "set_save_16_bit", "get_save_16_bit");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "resident_16_bit", PROPERTY_HINT_NONE), "set_resident_16_bit", "get_resident_16_bit");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "save_compressed", PROPERTY_HINT_NONE), "set_save_compressed", "get_save_compressed");
 	ADD_PROPERTY(PropertyInfo(Variant::VECTOR2, "height_range", PROPERTY_HINT_NONE, "", ro_flags), "set_height_range", "get_height_range");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "region_offsets", PROPERTY_HINT_ARRAY_TYPE, vformat("%tex_size/%tex_size:%tex_size", Variant::VECTOR2, PROPERTY_HINT_NONE), ro_flags), "set_region_offsets", "get_region_offsets");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "height_maps", PROPERTY_HINT_ARRAY_TYPE, vformat("%tex_size/%tex_size:%tex_size", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "Image"), ro_flags), "set_height_maps", "get_height_maps");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "control_maps", PROPERTY_HINT_ARRAY_TYPE, vformat("%tex_size/%tex_size:%tex_size", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "Image"), ro_flags), "set_control_maps", "get_control_maps");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "color_maps", PROPERTY_HINT_ARRAY_TYPE, vformat("%tex_size/%tex_size:%tex_size", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "Image"), ro_flags), "set_color_maps", "get_color_maps");
+	// Must follow region_offsets and the maps, which are saved empty when this is used
+	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "compressed_regions", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_STORAGE), "set_compressed_regions", "get_compressed_regions");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "streaming_enabled", PROPERTY_HINT_NONE), "set_streaming_enabled", "get_streaming_enabled");
+	ADD_PROPERTY(PropertyInfo(Variant::STRING, "streaming_directory", PROPERTY_HINT_DIR), "set_streaming_directory", "get_streaming_directory");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "stream_load_radius", PROPERTY_HINT_RANGE, "0,65536,1,or_greater,suffix:m"), "set_stream_load_radius", "get_stream_load_radius");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "stream_unload_radius", PROPERTY_HINT_RANGE, "0,65536,1,or_greater,suffix:m"), "set_stream_unload_radius", "get_stream_unload_radius");
 
 	ADD_SIGNAL(MethodInfo("height_maps_changed"));
 	ADD_SIGNAL(MethodInfo("region_size_changed"));
 	ADD_SIGNAL(MethodInfo("regions_changed"));
 	ADD_SIGNAL(MethodInfo("maps_edited", PropertyInfo(Variant::AABB, "edited_area")));
+	ADD_SIGNAL(MethodInfo("region_loaded", PropertyInfo(Variant::VECTOR2I, "region_offset")));
+	ADD_SIGNAL(MethodInfo("region_unloaded", PropertyInfo(Variant::VECTOR2I, "region_offset")));
+	ADD_SIGNAL(MethodInfo("save_progress", PropertyInfo(Variant::FLOAT, "progress")));
+	ADD_SIGNAL(MethodInfo("save_finished", PropertyInfo(Variant::INT, "error")));
 }
@@ -3,15 +3,24 @@
 #ifndef TERRAIN3D_STORAGE_CLASS_H
 #define TERRAIN3D_STORAGE_CLASS_H
 
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
 #include <godot_cpp/classes/resource_loader.hpp>
 #include <godot_cpp/classes/shader.hpp>
 
 #include "constants.h"
 #include "generated_texture.h"
+#include "height_pyramid.h"
+#include "region_codec.h"
+#include "region_container.h"
+#include "region_map.h"
 #include "terrain_3d_texture_list.h"
 #include "terrain_3d_util.h"
 
 class Terrain3D;
+class Terrain3DSnapshot;
 
 using namespace godot;
 
@@ -23,8 +32,11 @@ class Terrain3DStorage : public Resource {
 
 public: // Constants
 	static inline const real_t CURRENT_VERSION = 0.842f;
+	// Region offsets are limited to +/- this many regions on each axis, to keep global pixel
+	// coordinates within int range. Their span is also limited by RegionMap::get_max_size()
+	static inline const int REGION_OFFSET_MAX = 8192;
+	// Deprecated. Regions are no longer limited to a fixed grid. Kept for scripts that read it
 	static inline const int REGION_MAP_SIZE = 16;
-	static inline const Vector2i REGION_MAP_VSIZE = Vector2i(REGION_MAP_SIZE, REGION_MAP_SIZE);
 
 	enum MapType {
 		TYPE_HEIGHT,
@@ -54,13 +66,21 @@ public: // Constants
 		COLOR_NAN, // TYPE_MAX, unused just in case someone indexes the array
 	};
 
+	// RegionCodec filter suited to each map type
+	static inline const RegionCodec::Filter CODEC_FILTER[] = {
+		RegionCodec::FILTER_HEIGHT, // TYPE_HEIGHT
+		RegionCodec::FILTER_BITFIELD, // TYPE_CONTROL
+		RegionCodec::FILTER_BYTES, // TYPE_COLOR
+		RegionCodec::FILTER_NONE, // TYPE_MAX
+	};
+
 	enum RegionSize {
-		//SIZE_64 = 64,
-		//SIZE_128 = 128,
-		//SIZE_256 = 256,
-		//SIZE_512 = 512,
+		SIZE_64 = 64,
+		SIZE_128 = 128,
+		SIZE_256 = 256,
+		SIZE_512 = 512,
 		SIZE_1024 = 1024,
-		//SIZE_2048 = 2048,
+		SIZE_2048 = 2048,
 	};
 
 	enum HeightFilter {
@@ -68,18 +88,38 @@ public: // Constants
 		HEIGHT_FILTER_MINIMUM
 	};
 
+	typedef std::shared_lock<std::shared_mutex> ReadLock;
+	typedef std::unique_lock<std::shared_mutex> WriteLock;
+
 private:
 	// Storage Settings & flags
 	real_t _version = 0.8f; // Set to ensure Godot always saves this
 	bool _modified = false;
 	bool _save_16_bit = false;
+	bool _resident_16_bit = false; // Height maps held as FORMAT_RH in RAM and VRAM
+	real_t _height_quantization_error = 0.f; // Largest error from converting heights to 16-bit
+	bool _save_compressed = false;
+	Array _compressed_regions; // Only filled while saving with _save_compressed
 	RegionSize _region_size = SIZE_1024;
 	Vector2i _region_sizev = Vector2i(_region_size, _region_size);
 	real_t _mesh_vertex_spacing = 1.0f; // Set by Terrain3D for get_normal()
 
 	// Stored Data
-	Vector2 _height_range = Vector2(0.f, 0.f);
+	// Recomputed lazily from the height pyramids after edits, so it shrinks as well as grows.
+	// Guarded by _height_range_mutex, as get_height_range() may recompute it on any thread
+	mutable std::mutex _height_range_mutex;
+	mutable Vector2 _height_range = Vector2(0.f, 0.f);
+	mutable std::atomic<bool> _height_range_dirty = false; // Set by writers under _map_lock
 	AABB _edited_area;
+	Dictionary _edited_rects; // Region offset -> Rect2i of pixels reported by add_edited_area(), until the maps update
+	Dictionary _color_mipmap_rects; // Region offset -> Rect2i of color map pixels with stale mipmaps
+
+	/**
+	 * Uniform maps, such as blank ones, share the data of one Image per value. Images are
+	 * copy-on-write, so editing a shared map gives it its own copy. Keyed by
+	 * Vector4i(format, size, has mipmaps, texel bits).
+	 */
+	Dictionary _shared_maps;
 
 	/**
 	 * These arrays house all of the map data.
@@ -88,7 +128,7 @@ private:
 	 * texture in generated_*_maps.
 	 */
 	bool _region_map_dirty = true;
-	PackedInt32Array _region_map; // 16x16 Region grid with index into region_offsets (1 based array)
+	RegionMap _region_map; // Sparse lookup of region offset to index into region_offsets
 	TypedArray<Vector2i> _region_offsets; // Array of active region coordinates
 	TypedArray<Image> _height_maps;
 	TypedArray<Image> _control_maps;
@@ -99,11 +139,222 @@ private:
 	GeneratedTexture _generated_height_maps;
 	GeneratedTexture _generated_control_maps;
 	GeneratedTexture _generated_color_maps;
+	GeneratedTexture _generated_region_map; // RF image over the region bounds, index + 1 per region
+
+	/**
+	 * CPU sampler cache. Native copies of the region offsets and map references so
+	 * queries can read texels straight from Image memory, skipping the TypedArray/Variant
+	 * conversions and Image::get_pixel(). Rebuilt by _update_sampler() in update_regions().
+	 * All map formats are 4 bytes per pixel (RF, RF, RGBA8), so texels are read as uint32_t.
+	 */
+	Vector<Vector2i> _sampler_offsets;
+	Vector<Ref<Image>> _sampler_maps[TYPE_MAX];
+
+	/**
+	 * Concurrency model. Queries may run on any number of threads while the main thread edits.
+	 * _map_lock guards what queries read: the sampler cache, region map, height pyramids,
+	 * region size, vertex spacing and the texels of the sampled maps.
+	 *	Readers: the public query functions take it shared, batches once per chunk, and call
+	 *		the unlocked private versions. Private _px functions expect it held, or to
+	 *		be on the main thread.
+	 *	Writers: edits and region changes must come from one thread, normally the main thread.
+	 *		They take it exclusively only while swapping or writing that data, never while
+	 *		waiting on the WorkerThreadPool, as its threads may be readers waiting for the lock.
+	 * The region arrays, generated textures and modified flags are main thread only. C++ code
+	 * writing texels into map Images directly, like the editor, holds write_lock() meanwhile.
+	 * The cached height range has its own mutex, which is always taken before _map_lock.
+	 */
+	mutable std::shared_mutex _map_lock;
+	uint64_t _data_version = 0; // Incremented under _map_lock by every change queries can see
+
+	/**
+	 * Min/max height pyramids, one per region, parallel to the sampler cache.
+	 * Kept by height map instance id, so pyramids are only rebuilt for new or replaced maps.
+	 * Edits to existing maps are applied incrementally by set_pixel() and add_edited_area().
+	 */
+	Vector<HeightPyramid> _height_pyramids;
+	Vector<uint64_t> _height_pyramid_ids;
+	bool _height_pyramids_dirty = false;
+
+	// Batched queries are split into chunks of this many points across WorkerThreadPool
+	static inline const int BATCH_CHUNK_SIZE = 2048;
+
+	/**
+	 * Region streaming. Regions are stored as their own files, or in region containers,
+	 * in _streaming_directory. Regions within the load radius of the camera are read on the
+	 * WorkerThreadPool, then added on the main thread by update_streaming(). Regions streamed
+	 * in are removed again beyond the unload radius.
+	 */
+	struct StreamJob {
+		String path;
+		const RegionContainer *container = nullptr;
+		int container_index = -1;
+		Vector2i offset;
+		int region_size = 0;
+		TypedArray<Image> maps;
+		Error error = OK;
+		int64_t task_id = -1;
+	};
+	bool _streaming_enabled = false;
+	String _streaming_directory;
+	real_t _stream_load_radius = 2048.f;
+	real_t _stream_unload_radius = 3072.f;
+	Dictionary _stream_files; // Region offset -> file path, or Vector2i(container, index) for containers
+	Vector<RegionContainer *> _stream_containers; // Open, memory mapped containers in the directory
+	Dictionary _streamed_regions; // Region offsets loaded from files, which may be unloaded
+	Vector<StreamJob *> _stream_jobs;
+	Vector2 _stream_last_position = Vector2(FLT_MAX, FLT_MAX);
+
+	/**
+	 * Incremental saves. Tracks which maps of which regions changed since they were last written
+	 * to region files, so save_modified_regions() rewrites only those.
+	 * Region offset -> bits of (1 << MapType), or REGION_REMOVED.
+	 */
+	static inline const int REGION_ALL_MAPS = (1 << TYPE_MAX) - 1;
+	static inline const int REGION_REMOVED = 1 << TYPE_MAX;
+	Dictionary _modified_regions;
+
+	// Compressed saves code each region with RegionCodec, one region per WorkerThreadPool task
+	struct CodecJob {
+		bool encode = true;
+		TypedArray<Image> *maps = nullptr;
+		PackedByteArray *data = nullptr;
+		Error *errors = nullptr;
+	};
+
+	// Imports build one region's maps per WorkerThreadPool group task, from the raw source data
+	struct ImportJob {
+		const uint8_t *sources[TYPE_MAX] = {}; // Base level data in FORMAT[], or null for blank maps
+		uint32_t fill[TYPE_MAX] = {}; // Texel for blank maps and padding
+		Vector2i img_size;
+		int region_size = 0;
+		int slices_width = 0;
+		real_t offset = 0.f;
+		real_t scale = 1.f;
+		Ref<Image> *maps = nullptr; // TYPE_MAX per slice
+	};
+
+	// Color map mipmaps regenerated per WorkerThreadPool group task
+	struct MipmapJob {
+		Vector<Ref<Image>> maps; // Copies, swapped into the color maps afterwards
+		Vector<Rect2i> rects; // Pixels with stale mipmaps
+	};
+
+	// Exports copy or convert the maps of one region per WorkerThreadPool group task into a buffer
+	struct ExportJob {
+		Vector<const uint8_t *> sources; // Base level data per slot, or null for empty slots
+		Vector2i slots; // Regions across and down in dst
+		int region_size = 0;
+		int src_pixel_size = 0;
+		int pixel_size = 0; // Bytes per pixel in dst
+		const uint8_t *fill = nullptr; // One dst pixel for empty slots
+		uint8_t *dst = nullptr;
+		int64_t dst_stride = 0; // Bytes per dst row
+		bool r16 = false; // Converts heights to unsigned 16-bit
+		bool half = false; // Source heights are FORMAT_RH
+		float height_min = 0.f;
+		float height_scale = 0.f;
+	};
+
+	// Per region image files written on the WorkerThreadPool
+	struct ExportTilesJob {
+		Vector<Ref<Image>> maps;
+		Vector<String> paths;
+		Error *errors = nullptr;
+		MapType map_type = TYPE_HEIGHT;
+		float height_min = 0.f;
+		float height_scale = 0.f;
+	};
+
+	/**
+	 * Background saves. A SaveJob is a snapshot of everything a save writes. The snapshot holds
+	 * duplicates of the maps, which share their data with the live maps until either is written,
+	 * so taking it is cheap. The job is then written on the WorkerThreadPool while editing
+	 * continues, and edits after the snapshot go to the next save.
+	 */
+	struct SaveJob {
+		Terrain3DStorage *storage = nullptr; // Receives progress
+		int id = 0;
+		bool background = false;
+		Ref<Terrain3DStorage> snapshot; // Resource written to path, if any
+		String path;
+		String directory; // Where modified regions are written as region files, if any
+		int region_size = 0;
+		TypedArray<Vector2i> offsets; // Regions written to directory
+		Vector<TypedArray<Image>> maps;
+		TypedArray<Vector2i> removed; // Region files deleted from directory
+		Dictionary modified_regions; // Taken from _modified_regions, restored if the save fails
+		bool compressed = false; // The snapshot holds compressed_regions instead of maps
+		Error error = OK;
+		int64_t task_id = -1;
+	};
+	SaveJob *_save_job = nullptr;
+	int _save_job_id = 0;
 
 	uint64_t _last_region_bounds_error = 0;
 
 	// Functions
 	void _clear();
+	Image::Format _get_format(MapType p_map_type) const;
+	static HeightPyramid::Heights _get_heights(const Ref<Image> &p_map);
+	real_t _quantize_heights(const Ref<Image> &p_map);
+	void _clear_sampler();
+	void _update_sampler();
+	void _update_region_map();
+	void _update_height_pyramids();
+	void _update_height_pyramids(Rect2i p_px_rect);
+	Vector2 _get_height_range_px(Rect2i p_px_rect) const;
+	void _update_height_range() const;
+	Ref<Image> _get_shared_map(const Ref<Image> &p_map);
+	Ref<Image> _get_blank_map(MapType p_map_type);
+	void _set_color_mipmaps_dirty(Vector2i p_region_offset, Rect2i p_rect = Rect2i());
+	static void _mipmap_task(void *p_job, uint32_t p_index);
+	void _update_color_mipmaps();
+	static bool _clip_ray(const Vector3 &p_origin, const Vector3 &p_dir, Vector2 p_min, Vector2 p_max, real_t &r_t0, real_t &r_t1);
+	bool _raycast_quad(Vector2i p_px, const Vector3 &p_origin, const Vector3 &p_dir, real_t p_t0, real_t p_t1, real_t &r_t) const;
+	real_t _raycast_leaf(Vector2i p_min, Vector2i p_max, const Vector3 &p_origin, const Vector3 &p_dir, real_t p_t0, real_t p_t1) const;
+	real_t _raycast_region(int p_region, const Vector3 &p_origin, const Vector3 &p_dir, real_t p_t0, real_t p_t1) const;
+	Error _resize_regions(RegionSize p_size);
+	void _scan_stream_files();
+	void _cancel_stream_jobs();
+	static void _stream_load_task(void *p_job);
+	TypedArray<Vector2i> _swap_streamed_regions(const Dictionary &p_loaded, const Dictionary &p_unloaded);
+	static void _codec_task(void *p_job, uint32_t p_index);
+	static void _import_task(void *p_job, uint32_t p_index);
+	bool _check_import_area(Vector3 p_global_position, Vector2i p_size) const;
+	Dictionary _get_region_indices() const;
+	void _add_imported_region(Vector2i p_region_offset, const TypedArray<Image> &p_maps, Dictionary &r_indices);
+	static void _encode_r16(const HeightPyramid::Heights &p_heights, int p_count, float p_min, float p_scale, uint8_t *r_dst);
+	static void _export_task(void *p_job, uint32_t p_index);
+	static void _export_tile_task(void *p_job, uint32_t p_index);
+	static Error _save_image(const Ref<Image> &p_image, const String &p_file_name, MapType p_map_type);
+	void _get_region_bounds(Vector2i &r_top_left, Vector2i &r_bottom_right) const;
+	Vector2 _get_export_height_range() const;
+	Error _export_r16(const String &p_file_name);
+	real_t _get_region_distance(Vector2i p_offset, Vector2 p_global_xz) const;
+	void _set_region_modified(Vector2i p_region_offset, int p_map_bits);
+	static Dictionary _get_region_index(const String &p_directory);
+	static Error _update_region_index(const String &p_directory, const TypedArray<Vector2i> &p_saved, const TypedArray<Vector2i> &p_removed);
+	SaveJob *_create_save_job(const String &p_path, const String &p_directory);
+	static void _write_save_job(SaveJob *p_job);
+	static void _save_task(void *p_job);
+	Error _finish_save_job(SaveJob *p_job);
+	bool _is_region_saving(Vector2i p_region_offset) const;
+	void _update_maps(MapType p_map_type, int p_region_index, bool p_mark_modified);
+	void _finish_save(int p_id);
+	void _wait_for_save();
+	template <typename TFunc>
+	void _process_batch(const PackedVector3Array &p_global_positions, TFunc p_func);
+	int _get_region_index_px(Vector2i p_px) const;
+	bool _has_pyramid(int p_region) const;
+	const uint32_t *_get_texel(MapType p_map_type, Vector2i p_px) const;
+	Vector2i _get_px(Vector3 p_global_position) const;
+	real_t _get_height_px(Vector2i p_px) const;
+	uint32_t _get_control_px(Vector2i p_px) const;
+	real_t _get_height(Vector3 p_global_position) const;
+	Vector3 _get_normal(Vector3 p_global_position) const;
+	Vector3 _raycast(Vector3 p_from, Vector3 p_direction, real_t p_max_distance) const;
+	void _decode_control_rect_px(Rect2i p_rect, const ControlLanes &r_lanes) const;
 
 public:
 	Terrain3DStorage();
@@ -113,12 +364,19 @@ public:
 	real_t get_version() const { return _version; }
 	void set_save_16_bit(bool p_enabled);
 	bool get_save_16_bit() const { return _save_16_bit; }
+	void set_resident_16_bit(bool p_enabled);
+	bool get_resident_16_bit() const { return _resident_16_bit; }
+	real_t get_height_quantization_error() const { return _height_quantization_error; }
+	void set_save_compressed(bool p_enabled);
+	bool get_save_compressed() const { return _save_compressed; }
 
 	void set_height_range(Vector2 p_range);
-	Vector2 get_height_range() const { return _height_range; }
+	Vector2 get_height_range() const;
 	void update_heights(real_t p_height);
 	void update_heights(Vector2 p_heights);
 	void update_height_range();
+	Vector2 get_region_height_range(int p_region_index) const;
+	Vector2 get_height_range_rect(Rect2 p_global_rect) const;
 
 	void clear_edited_area();
 	void add_edited_area(AABB p_area);
@@ -127,6 +385,7 @@ public:
 	// Regions
 	void set_region_size(RegionSize p_size);
 	RegionSize get_region_size() const { return _region_size; }
+	Vector2i get_region_sizev() const { return _region_sizev; }
 	void set_region_offsets(const TypedArray<Vector2i> &p_offsets);
 	TypedArray<Vector2i> get_region_offsets() const { return _region_offsets; }
 	int get_region_count() const { return _region_offsets.size(); }
@@ -136,6 +395,24 @@ public:
 	Error add_region(Vector3 p_global_position, const TypedArray<Image> &p_images = TypedArray<Image>(), bool p_update = true);
 	void remove_region(Vector3 p_global_position, bool p_update = true);
 	void update_regions(bool force_emit = false);
+	void set_region_modified(int p_region_index, MapType p_map_type = TYPE_MAX);
+	bool is_region_modified(int p_region_index, MapType p_map_type = TYPE_MAX) const;
+	TypedArray<Vector2i> get_modified_regions() const;
+
+	// Streaming
+	void set_streaming_enabled(bool p_enabled);
+	bool get_streaming_enabled() const { return _streaming_enabled; }
+	void set_streaming_directory(const String &p_directory);
+	String get_streaming_directory() const { return _streaming_directory; }
+	void set_stream_load_radius(real_t p_radius);
+	real_t get_stream_load_radius() const { return _stream_load_radius; }
+	void set_stream_unload_radius(real_t p_radius);
+	real_t get_stream_unload_radius() const { return _stream_unload_radius; }
+	int get_stream_pending_count() const { return _stream_jobs.size(); }
+	bool update_streaming(Vector3 p_global_position);
+	Error save_region_files(const String &p_directory);
+	Error save_region_container(const String &p_path);
+	Error save_modified_regions(const String &p_directory);
 
 	// Maps
 	void set_map_region(MapType p_map_type, int p_region_index, const Ref<Image> p_image);
@@ -143,6 +420,8 @@ public:
 	void set_maps(MapType p_map_type, const TypedArray<Image> &p_maps);
 	TypedArray<Image> get_maps(MapType p_map_type) const;
 	TypedArray<Image> get_maps_copy(MapType p_map_type) const;
+	Ref<Terrain3DSnapshot> create_snapshot() const;
+	uint64_t get_data_version() const;
 	void set_height_maps(const TypedArray<Image> &p_maps) { set_maps(TYPE_HEIGHT, p_maps); }
 	TypedArray<Image> get_height_maps() const { return _height_maps; }
 	void set_control_maps(const TypedArray<Image> &p_maps) { set_maps(TYPE_CONTROL, p_maps); }
@@ -160,16 +439,35 @@ public:
 	void set_roughness(Vector3 p_global_position, real_t p_roughness);
 	real_t get_roughness(Vector3 p_global_position);
 	Vector3 get_texture_id(Vector3 p_global_position);
+	PackedRealArray get_heights(const PackedVector3Array &p_global_positions);
+	PackedVector3Array get_normals(const PackedVector3Array &p_global_positions);
+	PackedInt32Array get_controls(const PackedVector3Array &p_global_positions);
+	void decode_control_rect_px(Rect2i p_rect, const ControlLanes &r_lanes) const;
+	void encode_control_rect_px(Rect2i p_rect, const ControlLanes &p_lanes);
+	Dictionary decode_control_rect(Vector3 p_global_position, Vector2i p_size) const;
+	void encode_control_rect(Vector3 p_global_position, const Dictionary &p_lanes);
+	Vector3 raycast(Vector3 p_from, Vector3 p_direction, real_t p_max_distance = 100000.f) const;
+	PackedVector3Array raycasts(const PackedVector3Array &p_from, const PackedVector3Array &p_directions, real_t p_max_distance = 100000.f);
 	TypedArray<Image> sanitize_maps(MapType p_map_type, const TypedArray<Image> &p_maps);
-	void force_update_maps(MapType p_map = TYPE_MAX);
+	Dictionary get_map_memory_usage() const;
+	WriteLock write_lock() const { return WriteLock(_map_lock); }
+	void force_update_maps(MapType p_map = TYPE_MAX, int p_region_index = -1);
 
 	// File I/O
-	void save();
+	void save(bool p_background = false);
+	bool is_saving() const { return _save_job != nullptr; }
+	Array compress_regions() const;
+	Error decompress_regions(const Array &p_data);
+	void set_compressed_regions(const Array &p_data);
+	Array get_compressed_regions() const { return _compressed_regions; }
 	void clear_modified() { _modified = false; }
 	void set_modified() { _modified = true; }
 	void import_images(const TypedArray<Image> &p_images, Vector3 p_global_position = Vector3(0.f, 0.f, 0.f),
 			real_t p_offset = 0.f, real_t p_scale = 1.f);
+	Error import_r16(const String &p_file_name, Vector3 p_global_position = Vector3(0.f, 0.f, 0.f),
+			Vector2 p_height_range = Vector2(0.f, 255.f), Vector2i p_size = Vector2i(0, 0));
 	Error export_image(String p_file_name, MapType p_map_type = TYPE_HEIGHT);
+	Error export_region_images(const String &p_directory, MapType p_map_type = TYPE_HEIGHT, const String &p_extension = "exr");
 	Ref<Image> layered_to_image(MapType p_map_type);
 
 	// Utility
@@ -207,7 +505,8 @@ inline void Terrain3DStorage::set_control(Vector3 p_global_position, uint32_t p_
 }
 
 inline uint32_t Terrain3DStorage::get_control(Vector3 p_global_position) {
-	return as_uint(get_pixel(TYPE_CONTROL, p_global_position).r);
+	ReadLock lock(_map_lock);
+	return _get_control_px(_get_px(p_global_position));
 }
 
 inline void Terrain3DStorage::set_roughness(Vector3 p_global_position, real_t p_roughness) {
@@ -220,4 +519,64 @@ inline real_t Terrain3DStorage::get_roughness(Vector3 p_global_position) {
 	return get_pixel(TYPE_COLOR, p_global_position).a;
 }
 
+// Height maps are FORMAT_RH when resident in 16-bit, otherwise maps use the standard formats
+inline Image::Format Terrain3DStorage::_get_format(MapType p_map_type) const {
+	return (p_map_type == TYPE_HEIGHT && _resident_16_bit) ? Image::FORMAT_RH : FORMAT[p_map_type];
+}
+
+inline HeightPyramid::Heights Terrain3DStorage::_get_heights(const Ref<Image> &p_map) {
+	HeightPyramid::Heights heights;
+	heights.data = p_map->ptr();
+	heights.half = p_map->get_format() == Image::FORMAT_RH;
+	return heights;
+}
+
+// Converts a global position to a descaled, global pixel location
+inline Vector2i Terrain3DStorage::_get_px(Vector3 p_global_position) const {
+	return Vector2i(int(Math::floor(p_global_position.x / _mesh_vertex_spacing)),
+			int(Math::floor(p_global_position.z / _mesh_vertex_spacing)));
+}
+
+// Returns the region index containing a global pixel location, or -1
+inline int Terrain3DStorage::_get_region_index_px(Vector2i p_px) const {
+	return _region_map.get(Vector2i(floor_div(p_px.x, int(_region_size)), floor_div(p_px.y, int(_region_size))));
+}
+
+// Returns true if the region index has sampler maps and a height pyramid, which may be cleared by invalid maps
+inline bool Terrain3DStorage::_has_pyramid(int p_region) const {
+	return p_region >= 0 && p_region < _sampler_offsets.size() && p_region < _height_pyramids.size();
+}
+
+// Returns a pointer to the raw 32-bit texel in the control or color map at a global pixel location, or nullptr
+inline const uint32_t *Terrain3DStorage::_get_texel(MapType p_map_type, Vector2i p_px) const {
+	int region = _get_region_index_px(p_px);
+	if (region < 0 || region >= _sampler_offsets.size()) {
+		return nullptr;
+	}
+	const Ref<Image> &map = _sampler_maps[p_map_type][region];
+	Vector2i img_pos = p_px - _sampler_offsets[region] * int(_region_size);
+	return reinterpret_cast<const uint32_t *>(map->ptr()) + (img_pos.y * _region_size + img_pos.x);
+}
+
+// Decodes 16-bit heights on the fly if resident in 16-bit
+inline real_t Terrain3DStorage::_get_height_px(Vector2i p_px) const {
+	int region = _get_region_index_px(p_px);
+	if (region < 0 || region >= _sampler_offsets.size()) {
+		return NAN;
+	}
+	const Ref<Image> &map = _sampler_maps[TYPE_HEIGHT][region];
+	Vector2i img_pos = p_px - _sampler_offsets[region] * int(_region_size);
+	int index = img_pos.y * _region_size + img_pos.x;
+	if (_resident_16_bit) {
+		return real_t(Math::half_to_float(reinterpret_cast<const uint16_t *>(map->ptr())[index]));
+	}
+	return real_t(reinterpret_cast<const float *>(map->ptr())[index]);
+}
+
+// Returns the control bits, or the bits of a NAN float if there is no region, matching get_pixel()
+inline uint32_t Terrain3DStorage::_get_control_px(Vector2i p_px) const {
+	const uint32_t *texel = _get_texel(TYPE_CONTROL, p_px);
+	return (texel) ? *texel : as_uint(NAN);
+}
+
 #endif // TERRAIN3D_STORAGE_CLASS_H
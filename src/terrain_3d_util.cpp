@@ -2,10 +2,15 @@
 
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 
 #include "logger.h"
 #include "terrain_3d_util.h"
 
+#ifdef TERRAIN3D_SSE2
+#include <emmintrin.h>
+#endif
+
 ///////////////////////////
 // Public Functions
 ///////////////////////////
@@ -45,8 +50,163 @@ Ref<Image> Terrain3DUtil::black_to_alpha(const Ref<Image> p_image) {
 	return img;
 }
 
+// Min, max, sum and count of float texels. NaNs are only counted
+struct FloatStats {
+	float min = FLT_MAX;
+	float max = -FLT_MAX;
+	double sum = 0.0;
+	int64_t count = 0;
+	int64_t nan_count = 0;
+
+	void merge(const FloatStats &p_other) {
+		min = MIN(min, p_other.min);
+		max = MAX(max, p_other.max);
+		sum += p_other.sum;
+		count += p_other.count;
+		nan_count += p_other.nan_count;
+	}
+};
+
+// Accumulates p_count floats. The sum and NaN count are only kept if p_stats is true
+static void accumulate_floats(const float *p_src, int p_count, bool p_stats, FloatStats &r_stats) {
+	int i = 0;
+	float sum = 0.f;
+	int64_t nan_count = 0;
+#ifdef TERRAIN3D_SSE2
+	if (p_count >= 4) {
+		// _mm_min_ps() and _mm_max_ps() return the second operand if either is NaN, so NaNs are skipped
+		__m128 vmin = _mm_set1_ps(r_stats.min);
+		__m128 vmax = _mm_set1_ps(r_stats.max);
+		__m128 vsum = _mm_setzero_ps();
+		__m128i vnan = _mm_setzero_si128();
+		for (; i + 4 <= p_count; i += 4) {
+			__m128 v = _mm_loadu_ps(p_src + i);
+			vmin = _mm_min_ps(v, vmin);
+			vmax = _mm_max_ps(v, vmax);
+			if (p_stats) {
+				__m128 nan = _mm_cmpunord_ps(v, v);
+				vsum = _mm_add_ps(vsum, _mm_andnot_ps(nan, v));
+				vnan = _mm_sub_epi32(vnan, _mm_castps_si128(nan));
+			}
+		}
+		alignas(16) float mins[4], maxs[4], sums[4];
+		alignas(16) int32_t nans[4];
+		_mm_store_ps(mins, vmin);
+		_mm_store_ps(maxs, vmax);
+		_mm_store_ps(sums, vsum);
+		_mm_store_si128(reinterpret_cast<__m128i *>(nans), vnan);
+		for (int l = 0; l < 4; l++) {
+			r_stats.min = MIN(r_stats.min, mins[l]);
+			r_stats.max = MAX(r_stats.max, maxs[l]);
+			sum += sums[l];
+			nan_count += nans[l];
+		}
+	}
+#endif
+	for (; i < p_count; i++) {
+		float v = p_src[i];
+		if (v != v) {
+			nan_count++;
+			continue;
+		}
+		r_stats.min = MIN(r_stats.min, v);
+		r_stats.max = MAX(r_stats.max, v);
+		sum += v;
+	}
+	if (p_stats) {
+		r_stats.sum += sum;
+		r_stats.nan_count += nan_count;
+		r_stats.count += p_count - nan_count;
+	}
+}
+
+// Rows of an FORMAT_RF or FORMAT_RH image, split into bands for the WorkerThreadPool
+struct FloatStatsJob {
+	const uint8_t *data = nullptr;
+	bool half = false;
+	int width = 0;
+	int height = 0;
+	int band_rows = 0;
+	bool stats = false;
+	FloatStats *results = nullptr; // One per band
+};
+
+static void float_stats_task(void *p_job, uint32_t p_index) {
+	const FloatStatsJob *job = static_cast<const FloatStatsJob *>(p_job);
+	int start = p_index * job->band_rows;
+	int end = MIN(start + job->band_rows, job->height);
+	FloatStats stats;
+	if (!job->half) {
+		const float *src = reinterpret_cast<const float *>(job->data);
+		for (int y = start; y < end; y++) {
+			accumulate_floats(src + int64_t(y) * job->width, job->width, job->stats, stats);
+		}
+	} else {
+		// Converted in blocks small enough to stay in cache
+		const uint16_t *src = reinterpret_cast<const uint16_t *>(job->data);
+		float block[1024];
+		int64_t i = int64_t(start) * job->width;
+		int64_t i_end = int64_t(end) * job->width;
+		while (i < i_end) {
+			int count = int(MIN(int64_t(1024), i_end - i));
+			for (int b = 0; b < count; b++) {
+				block[b] = Math::half_to_float(src[i + b]);
+			}
+			accumulate_floats(block, count, job->stats, stats);
+			i += count;
+		}
+	}
+	job->results[p_index] = stats;
+}
+
+/**
+ * Analyzes the red channel of an image. FORMAT_RF and FORMAT_RH are read directly and
+ * large images are split across the WorkerThreadPool. Other formats fall back to get_pixel().
+ */
+static FloatStats get_float_stats(const Ref<Image> &p_image, bool p_stats) {
+	FloatStats stats;
+	int width = p_image->get_width();
+	int height = p_image->get_height();
+	Image::Format format = p_image->get_format();
+	if (format != Image::FORMAT_RF && format != Image::FORMAT_RH) {
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				float v = p_image->get_pixel(x, y).r;
+				accumulate_floats(&v, 1, p_stats, stats);
+			}
+		}
+		return stats;
+	}
+
+	// Bands of about 256k texels, or one band for small images
+	const int64_t band_texels = 1 << 18;
+	FloatStatsJob job;
+	job.data = p_image->ptr();
+	job.half = format == Image::FORMAT_RH;
+	job.width = width;
+	job.height = height;
+	job.band_rows = int(CLAMP(band_texels / MAX(width, 1), int64_t(1), int64_t(height)));
+	job.stats = p_stats;
+	int bands = (height + job.band_rows - 1) / job.band_rows;
+	Vector<FloatStats> results;
+	results.resize(bands);
+	job.results = results.ptrw();
+	if (bands == 1) {
+		float_stats_task(&job, 0);
+	} else {
+		WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+		int64_t group_id = wtp->add_native_group_task(&float_stats_task, &job, bands, -1, true, "Terrain3DUtil image stats");
+		wtp->wait_for_group_task_completion(group_id);
+	}
+	for (int i = 0; i < bands; i++) {
+		stats.merge(results[i]);
+	}
+	return stats;
+}
+
 /**
  * Returns the minimum and maximum values for a heightmap (red channel only)
+ * The range always includes 0. NaNs are ignored.
  */
 Vector2 Terrain3DUtil::get_min_max(const Ref<Image> p_image) {
 	if (p_image.is_null()) {
@@ -57,22 +217,84 @@ Vector2 Terrain3DUtil::get_min_max(const Ref<Image> p_image) {
 		return Vector2(INFINITY, INFINITY);
 	}
 
-	Vector2 min_max = Vector2(0.f, 0.f);
+	FloatStats stats = get_float_stats(p_image, false);
+	Vector2 min_max = Vector2(MIN(stats.min, 0.f), MAX(stats.max, 0.f));
+	LOG(INFO, "Calculating minimum and maximum values of the image: ", min_max);
+	return min_max;
+}
 
-	for (int y = 0; y < p_image->get_height(); y++) {
-		for (int x = 0; x < p_image->get_width(); x++) {
-			Color col = p_image->get_pixel(x, y);
-			if (col.r < min_max.x) {
-				min_max.x = col.r;
-			}
-			if (col.r > min_max.y) {
-				min_max.y = col.r;
-			}
-		}
+/**
+ * Returns statistics of a heightmap (red channel only) in one pass, as a Dictionary with:
+ *	min, max, mean - Of all texels that aren't NaN, or 0 if there are none
+ *	count - Texels that aren't NaN
+ *	nan_count - NaN texels
+ */
+Dictionary Terrain3DUtil::get_stats(const Ref<Image> p_image) {
+	Dictionary dict;
+	if (p_image.is_null() || p_image->is_empty()) {
+		LOG(ERROR, "Provided image is not valid or empty. Nothing to analyze");
+		return dict;
 	}
 
-	LOG(INFO, "Calculating minimum and maximum values of the image: ", min_max);
-	return min_max;
+	FloatStats stats = get_float_stats(p_image, true);
+	bool valid = stats.count > 0;
+	dict["min"] = valid ? real_t(stats.min) : 0.f;
+	dict["max"] = valid ? real_t(stats.max) : 0.f;
+	dict["mean"] = valid ? stats.sum / double(stats.count) : 0.0;
+	dict["count"] = stats.count;
+	dict["nan_count"] = stats.nan_count;
+	return dict;
+}
+
+/**
+ * Returns true if every texel of the base level is identical, and that texel in r_texel.
+ * Supports the 2 and 4 byte formats of the maps: FORMAT_RH, FORMAT_RF and FORMAT_RGBA8.
+ * Non-uniform maps usually differ within the first few texels, so this is cheap to call on load.
+ */
+bool Terrain3DUtil::is_uniform(const Ref<Image> &p_image, uint32_t *r_texel) {
+	if (p_image.is_null() || p_image->is_empty()) {
+		return false;
+	}
+	int pixel_size;
+	switch (p_image->get_format()) {
+		case Image::FORMAT_RH:
+			pixel_size = 2;
+			break;
+		case Image::FORMAT_RF:
+		case Image::FORMAT_RGBA8:
+			pixel_size = 4;
+			break;
+		default:
+			return false;
+	}
+	const uint8_t *data = p_image->ptr();
+	int64_t size = int64_t(p_image->get_width()) * p_image->get_height() * pixel_size;
+	alignas(16) uint8_t pattern[16];
+	for (int i = 0; i < 16; i++) {
+		pattern[i] = data[i % pixel_size];
+	}
+	int64_t i = 0;
+#ifdef TERRAIN3D_SSE2
+	const __m128i p = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern));
+	for (; i + 64 <= size; i += 64) {
+		const __m128i *src = reinterpret_cast<const __m128i *>(data + i);
+		__m128i a = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(src), p), _mm_cmpeq_epi8(_mm_loadu_si128(src + 1), p));
+		__m128i b = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(src + 2), p), _mm_cmpeq_epi8(_mm_loadu_si128(src + 3), p));
+		if (_mm_movemask_epi8(_mm_and_si128(a, b)) != 0xFFFF) {
+			return false;
+		}
+	}
+#endif
+	for (; i < size; i++) {
+		if (data[i] != pattern[i % pixel_size]) {
+			return false;
+		}
+	}
+	if (r_texel) {
+		*r_texel = 0;
+		memcpy(r_texel, data, pixel_size);
+	}
+	return true;
 }
 
 /**
@@ -230,14 +452,24 @@ Ref<Image> Terrain3DUtil::load_image(String p_file_name, int p_cache_mode, Vecto
 			LOG(DEBUG, "Total file size is: ", fsize, " calculated width: ", fwidth, " dimensions: ", p_r16_size);
 			file->seek(0);
 		}
-		img = Image::create(p_r16_size.x, p_r16_size.y, false, Terrain3DStorage::FORMAT[Terrain3DStorage::TYPE_HEIGHT]);
-		for (int y = 0; y < p_r16_size.y; y++) {
-			for (int x = 0; x < p_r16_size.x; x++) {
-				real_t h = real_t(file->get_16()) / 65535.0f;
-				h = h * (p_r16_height_range.y - p_r16_height_range.x) + p_r16_height_range.x;
-				img->set_pixel(x, y, Color(h, 0.f, 0.f));
-			}
+		// Read in one call and convert in place. Storage::import_r16() streams files too large for this
+		int64_t count = int64_t(p_r16_size.x) * p_r16_size.y;
+		PackedByteArray src = file->get_buffer(count * 2);
+		if (src.size() != count * 2) {
+			LOG(ERROR, "File ", p_file_name, " is too small for ", p_r16_size, " heights");
+			return Ref<Image>();
+		}
+		PackedByteArray data;
+		data.resize(count * sizeof(float));
+		const uint8_t *src_ptr = src.ptr();
+		float *dst = reinterpret_cast<float *>(data.ptrw());
+		float scale = float(p_r16_height_range.y - p_r16_height_range.x) / 65535.f;
+		float offset = float(p_r16_height_range.x);
+		for (int64_t i = 0; i < count; i++) {
+			uint16_t h = uint16_t(src_ptr[i * 2]) | (uint16_t(src_ptr[i * 2 + 1]) << 8);
+			dst[i] = float(h) * scale + offset;
 		}
+		img = Image::create_from_data(p_r16_size.x, p_r16_size.y, false, Terrain3DStorage::FORMAT[Terrain3DStorage::TYPE_HEIGHT], data);
 
 		// If an Image extension, use Image loader
 	} else if (imgloader_extensions.has(ext)) {
@@ -293,6 +525,279 @@ Ref<Image> Terrain3DUtil::pack_image(const Ref<Image> p_src_rgb, const Ref<Image
 	return dst;
 }
 
+/**
+ * Regenerates the mipmaps of an existing chain over the pixels in p_rect only, with the same 2x2
+ * box filter as Image::generate_mipmaps(). Supports square, power of 2 FORMAT_RGBA8 images.
+ * Others, images without mipmaps and rects covering the whole image get generate_mipmaps().
+ */
+void Terrain3DUtil::generate_mipmaps_rect(const Ref<Image> &p_image, Rect2i p_rect) {
+	int size = p_image->get_width();
+	Rect2i full = Rect2i(0, 0, size, p_image->get_height());
+	Rect2i rect = p_rect.intersection(full);
+	if (p_image->get_format() != Image::FORMAT_RGBA8 || !p_image->has_mipmaps() || size != full.size.y ||
+			(size & (size - 1)) != 0 || rect == full) {
+		p_image->generate_mipmaps();
+		return;
+	}
+	if (!rect.has_area()) {
+		return;
+	}
+
+	uint8_t *data = p_image->ptrw();
+	Vector2i start = rect.position;
+	Vector2i end = rect.get_end();
+	int levels = p_image->get_mipmap_count();
+	for (int level = 1; level <= levels; level++) {
+		int src_size = size >> (level - 1);
+		int dst_size = MAX(size >> level, 1);
+		const uint8_t *src = data + p_image->get_mipmap_offset(level - 1);
+		uint8_t *dst = data + p_image->get_mipmap_offset(level);
+		start = Vector2i(start.x >> 1, start.y >> 1);
+		end = Vector2i(MIN((end.x + 1) >> 1, dst_size), MIN((end.y + 1) >> 1, dst_size));
+		for (int y = start.y; y < end.y; y++) {
+			const uint8_t *up = src + int64_t(y * 2) * src_size * 4;
+			const uint8_t *down = up + src_size * 4;
+			uint8_t *out = dst + int64_t(y) * dst_size * 4;
+			for (int x = start.x; x < end.x; x++) {
+				for (int c = 0; c < 4; c++) {
+					int i = x * 8 + c;
+					out[x * 4 + c] = uint8_t((up[i] + up[i + 4] + down[i] + down[i + 4] + 2) >> 2);
+				}
+			}
+		}
+	}
+}
+
+// Bytes per pixel of an uncompressed format, or 0 for compressed or unknown formats
+int Terrain3DUtil::get_format_pixel_size(Image::Format p_format) {
+	switch (p_format) {
+		case Image::FORMAT_L8:
+		case Image::FORMAT_R8:
+			return 1;
+		case Image::FORMAT_LA8:
+		case Image::FORMAT_RG8:
+		case Image::FORMAT_RGBA4444:
+		case Image::FORMAT_RGB565:
+		case Image::FORMAT_RH:
+			return 2;
+		case Image::FORMAT_RGB8:
+			return 3;
+		case Image::FORMAT_RGBA8:
+		case Image::FORMAT_RF:
+		case Image::FORMAT_RGH:
+		case Image::FORMAT_RGBE9995:
+			return 4;
+		case Image::FORMAT_RGBH:
+			return 6;
+		case Image::FORMAT_RGF:
+		case Image::FORMAT_RGBAH:
+			return 8;
+		case Image::FORMAT_RGBF:
+			return 12;
+		case Image::FORMAT_RGBAF:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Bytes of Image data for these dimensions, including mipmaps down to 1x1, as
+ * Image::get_image_data_size() computes for uncompressed formats. That isn't exposed to
+ * extensions. Returns 0 for compressed or unknown formats.
+ */
+int64_t Terrain3DUtil::get_image_data_size(int p_width, int p_height, Image::Format p_format, bool p_mipmaps) {
+	int pixel_size = get_format_pixel_size(p_format);
+	int64_t size = 0;
+	int w = p_width;
+	int h = p_height;
+	while (pixel_size > 0) {
+		size += int64_t(w) * h * pixel_size;
+		if (!p_mipmaps || (w == 1 && h == 1)) {
+			break;
+		}
+		w = MAX(w / 2, 1);
+		h = MAX(h / 2, 1);
+	}
+	return size;
+}
+
+// Writes p_src * p_scale + p_offset to r_dst, 8 floats at a time with SSE2 where available
+void Terrain3DUtil::scale_floats(const float *p_src, int p_count, float p_scale, float p_offset, float *r_dst) {
+	int i = 0;
+#ifdef TERRAIN3D_SSE2
+	const __m128 scale = _mm_set1_ps(p_scale);
+	const __m128 offset = _mm_set1_ps(p_offset);
+	for (; i + 8 <= p_count; i += 8) {
+		__m128 a = _mm_loadu_ps(p_src + i);
+		__m128 b = _mm_loadu_ps(p_src + i + 4);
+		_mm_storeu_ps(r_dst + i, _mm_add_ps(_mm_mul_ps(a, scale), offset));
+		_mm_storeu_ps(r_dst + i + 4, _mm_add_ps(_mm_mul_ps(b, scale), offset));
+	}
+#endif
+	for (; i < p_count; i++) {
+		r_dst[i] = p_src[i] * p_scale + p_offset;
+	}
+}
+
+#ifdef TERRAIN3D_SSE2
+// Extracts a field from 16 texels in 4 registers, and packs it into 16 bytes
+static inline __m128i pack_field(const __m128i *p_texels, __m128i p_shift, __m128i p_mask) {
+	__m128i a = _mm_and_si128(_mm_srl_epi32(p_texels[0], p_shift), p_mask);
+	__m128i b = _mm_and_si128(_mm_srl_epi32(p_texels[1], p_shift), p_mask);
+	__m128i c = _mm_and_si128(_mm_srl_epi32(p_texels[2], p_shift), p_mask);
+	__m128i d = _mm_and_si128(_mm_srl_epi32(p_texels[3], p_shift), p_mask);
+	return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+}
+
+// Gathers one bit from 16 texels into 16 mask bits, by moving it to the sign bit
+static inline int pack_bit(const __m128i *p_texels, __m128i p_shift) {
+	int bits = 0;
+	for (int k = 0; k < 4; k++) {
+		bits |= _mm_movemask_ps(_mm_castsi128_ps(_mm_sll_epi32(p_texels[k], p_shift))) << (4 * k);
+	}
+	return bits;
+}
+
+// Widens 16 bytes to a field of 16 texels in 4 registers, ORed into them
+static inline void unpack_field(__m128i *r_texels, const uint8_t *p_values, __m128i p_shift, __m128i p_mask) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_values));
+	__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+	__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+	__m128i words[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+		_mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+	for (int k = 0; k < 4; k++) {
+		r_texels[k] = _mm_or_si128(r_texels[k], _mm_sll_epi32(_mm_and_si128(words[k], p_mask), p_shift));
+	}
+}
+
+// Spreads 16 mask bits to one bit of 16 texels, ORed into them
+static inline void unpack_bit(__m128i *r_texels, int p_bits, uint32_t p_bit) {
+	const __m128i lane_bits = _mm_set_epi32(8, 4, 2, 1);
+	__m128i bit = _mm_set1_epi32(int(p_bit));
+	for (int k = 0; k < 4; k++) {
+		__m128i nibble = _mm_and_si128(_mm_set1_epi32((p_bits >> (4 * k)) & 0xF), lane_bits);
+		r_texels[k] = _mm_or_si128(r_texels[k], _mm_and_si128(_mm_cmpeq_epi32(nibble, lane_bits), bit));
+	}
+}
+#endif
+
+/**
+ * Decodes p_count control texels into the lanes of r_lanes. Processes 16 texels at a time with
+ * SSE2 where available, and the remainder with the scalar helpers.
+ */
+void Terrain3DUtil::decode_controls(const uint32_t *p_src, int p_count, const ControlLanes &r_lanes) {
+	int i = 0;
+#ifdef TERRAIN3D_SSE2
+	const __m128i mask5 = _mm_set1_epi32(0x1F);
+	const __m128i mask8 = _mm_set1_epi32(0xFF);
+	for (; i + 16 <= p_count; i += 16) {
+		__m128i texels[4];
+		for (int k = 0; k < 4; k++) {
+			texels[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_src + i + 4 * k));
+		}
+		if (r_lanes.base) {
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(r_lanes.base + i), pack_field(texels, _mm_cvtsi32_si128(27), mask5));
+		}
+		if (r_lanes.overlay) {
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(r_lanes.overlay + i), pack_field(texels, _mm_cvtsi32_si128(22), mask5));
+		}
+		if (r_lanes.blend) {
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(r_lanes.blend + i), pack_field(texels, _mm_cvtsi32_si128(14), mask8));
+		}
+		uint8_t *masks[] = { r_lanes.hole, r_lanes.nav, r_lanes.autoshader };
+		for (int m = 0; m < 3; m++) {
+			if (masks[m]) {
+				// Hole is bit 2, nav bit 1, auto bit 0
+				int bits = pack_bit(texels, _mm_cvtsi32_si128(29 + m));
+				masks[m][i >> 3] = uint8_t(bits);
+				masks[m][(i >> 3) + 1] = uint8_t(bits >> 8);
+			}
+		}
+	}
+#endif
+	uint8_t *masks[] = { r_lanes.hole, r_lanes.nav, r_lanes.autoshader };
+	for (int m = 0; m < 3; m++) {
+		if (masks[m]) {
+			for (int b = i >> 3; b < (p_count + 7) >> 3; b++) {
+				masks[m][b] = 0;
+			}
+		}
+	}
+	for (; i < p_count; i++) {
+		uint32_t pixel = p_src[i];
+		if (r_lanes.base) {
+			r_lanes.base[i] = get_base(pixel);
+		}
+		if (r_lanes.overlay) {
+			r_lanes.overlay[i] = get_overlay(pixel);
+		}
+		if (r_lanes.blend) {
+			r_lanes.blend[i] = get_blend(pixel);
+		}
+		bool bits[] = { is_hole(pixel), is_nav(pixel), is_auto(pixel) };
+		for (int m = 0; m < 3; m++) {
+			if (masks[m] && bits[m]) {
+				masks[m][i >> 3] |= uint8_t(1 << (i & 7));
+			}
+		}
+	}
+}
+
+// Encodes p_count control texels from the lanes of p_lanes. Unused bits are 0
+void Terrain3DUtil::encode_controls(const ControlLanes &p_lanes, int p_count, uint32_t *r_dst) {
+	int i = 0;
+#ifdef TERRAIN3D_SSE2
+	const __m128i mask5 = _mm_set1_epi32(0x1F);
+	const __m128i mask8 = _mm_set1_epi32(0xFF);
+	for (; i + 16 <= p_count; i += 16) {
+		__m128i texels[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+		if (p_lanes.base) {
+			unpack_field(texels, p_lanes.base + i, _mm_cvtsi32_si128(27), mask5);
+		}
+		if (p_lanes.overlay) {
+			unpack_field(texels, p_lanes.overlay + i, _mm_cvtsi32_si128(22), mask5);
+		}
+		if (p_lanes.blend) {
+			unpack_field(texels, p_lanes.blend + i, _mm_cvtsi32_si128(14), mask8);
+		}
+		const uint8_t *masks[] = { p_lanes.hole, p_lanes.nav, p_lanes.autoshader };
+		for (int m = 0; m < 3; m++) {
+			if (masks[m]) {
+				int bits = masks[m][i >> 3] | (masks[m][(i >> 3) + 1] << 8);
+				unpack_bit(texels, bits, 1u << (2 - m));
+			}
+		}
+		for (int k = 0; k < 4; k++) {
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(r_dst + i + 4 * k), texels[k]);
+		}
+	}
+#endif
+	for (; i < p_count; i++) {
+		uint32_t pixel = 0;
+		if (p_lanes.base) {
+			pixel |= enc_base(p_lanes.base[i]);
+		}
+		if (p_lanes.overlay) {
+			pixel |= enc_overlay(p_lanes.overlay[i]);
+		}
+		if (p_lanes.blend) {
+			pixel |= enc_blend(p_lanes.blend[i]);
+		}
+		if (p_lanes.hole) {
+			pixel |= enc_hole(get_mask_bit(p_lanes.hole, i));
+		}
+		if (p_lanes.nav) {
+			pixel |= enc_nav(get_mask_bit(p_lanes.nav, i));
+		}
+		if (p_lanes.autoshader) {
+			pixel |= enc_auto(get_mask_bit(p_lanes.autoshader, i));
+		}
+		r_dst[i] = pixel;
+	}
+}
+
 ///////////////////////////
 // Protected Functions
 ///////////////////////////
@@ -317,6 +822,7 @@ void Terrain3DUtil::_bind_methods() {
 	// Image handling
 	ClassDB::bind_static_method("Terrain3DUtil", D_METHOD("black_to_alpha", "image"), &Terrain3DUtil::black_to_alpha);
 	ClassDB::bind_static_method("Terrain3DUtil", D_METHOD("get_min_max", "image"), &Terrain3DUtil::get_min_max);
+	ClassDB::bind_static_method("Terrain3DUtil", D_METHOD("get_stats", "image"), &Terrain3DUtil::get_stats);
 	ClassDB::bind_static_method("Terrain3DUtil", D_METHOD("get_thumbnail", "image", "size"), &Terrain3DUtil::get_thumbnail, DEFVAL(Vector2i(256, 256)));
 	ClassDB::bind_static_method("Terrain3DUtil", D_METHOD("get_filled_image", "size", "color", "create_mipmaps", "format"), &Terrain3DUtil::get_filled_image);
 	ClassDB::bind_static_method("Terrain3DUtil", D_METHOD("load_image", "file_name", "cache_mode", "r16_height_range", "r16_size"), &Terrain3DUtil::load_image, DEFVAL(ResourceLoader::CACHE_MODE_IGNORE), DEFVAL(Vector2(0, 255)), DEFVAL(Vector2i(0, 0)));
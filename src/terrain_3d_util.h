@@ -10,6 +10,36 @@
 
 using namespace godot;
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TERRAIN3D_SSE2
+#endif
+
+/**
+ * Structure of arrays of control texels, for decoding and encoding many texels at once.
+ * Byte lanes hold one value per texel. Mask lanes hold one bit per texel, least significant bit
+ * first, starting on a new byte. Null lanes are skipped when decoding, and encoded as 0.
+ */
+struct ControlLanes {
+	uint8_t *base = nullptr;
+	uint8_t *overlay = nullptr;
+	uint8_t *blend = nullptr;
+	uint8_t *hole = nullptr;
+	uint8_t *nav = nullptr;
+	uint8_t *autoshader = nullptr;
+
+	// Returns lanes starting p_texels into the byte lanes, and p_mask_bytes into the mask lanes
+	ControlLanes offset(int p_texels, int p_mask_bytes) const {
+		ControlLanes lanes;
+		lanes.base = base ? base + p_texels : nullptr;
+		lanes.overlay = overlay ? overlay + p_texels : nullptr;
+		lanes.blend = blend ? blend + p_texels : nullptr;
+		lanes.hole = hole ? hole + p_mask_bytes : nullptr;
+		lanes.nav = nav ? nav + p_mask_bytes : nullptr;
+		lanes.autoshader = autoshader ? autoshader + p_mask_bytes : nullptr;
+		return lanes;
+	}
+};
+
 class Terrain3DUtil : public Object {
 	GDCLASS(Terrain3DUtil, Object);
 	CLASS_NAME_STATIC("Terrain3DUtil");
@@ -23,6 +53,8 @@ public:
 	// Image operations
 	static Ref<Image> black_to_alpha(const Ref<Image> p_image);
 	static Vector2 get_min_max(const Ref<Image> p_image);
+	static bool is_uniform(const Ref<Image> &p_image, uint32_t *r_texel = nullptr);
+	static Dictionary get_stats(const Ref<Image> p_image);
 	static Ref<Image> get_thumbnail(const Ref<Image> p_image, Vector2i p_size = Vector2i(256, 256));
 	static Ref<Image> get_filled_image(Vector2i p_size,
 			Color p_color = COLOR_BLACK,
@@ -31,6 +63,14 @@ public:
 	static Ref<Image> load_image(String p_file_name, int p_cache_mode = ResourceLoader::CACHE_MODE_IGNORE,
 			Vector2 p_r16_height_range = Vector2(0.f, 255.f), Vector2i p_r16_size = Vector2i(0, 0));
 	static Ref<Image> pack_image(const Ref<Image> p_src_rgb, const Ref<Image> p_src_r, bool p_invert_green_channel = false);
+	static void generate_mipmaps_rect(const Ref<Image> &p_image, Rect2i p_rect);
+	static int get_format_pixel_size(Image::Format p_format);
+	static int64_t get_image_data_size(int p_width, int p_height, Image::Format p_format, bool p_mipmaps);
+	static void scale_floats(const float *p_src, int p_count, float p_scale, float p_offset, float *r_dst);
+
+	// Control map operations
+	static void decode_controls(const uint32_t *p_src, int p_count, const ControlLanes &r_lanes);
+	static void encode_controls(const ControlLanes &p_lanes, int p_count, uint32_t *r_dst);
 
 protected:
 	static void _bind_methods();
@@ -52,6 +92,12 @@ T round_multiple(T p_value, T p_multiple) {
 	return static_cast<T>(std::round(static_cast<double>(p_value) / static_cast<double>(p_multiple)) * static_cast<double>(p_multiple));
 }
 
+// Integer division that rounds toward negative infinity, for mapping pixels to regions
+inline int floor_div(int p_num, int p_denom) {
+	int q = p_num / p_denom;
+	return (p_num % p_denom != 0 && (p_num < 0) != (p_denom < 0)) ? q - 1 : q;
+}
+
 // Returns the bilinearly interpolated value derived from parameters:
 // * 4 values to be interpolated
 // * Positioned at the 4 corners of the p_pos00 - p_pos11 rectangle
@@ -123,6 +169,9 @@ inline bool gd_is_hole(uint32_t pixel) { return is_hole(pixel); }
 inline bool gd_is_auto(uint32_t pixel) { return is_auto(pixel); }
 inline bool gd_is_nav(uint32_t pixel) { return is_nav(pixel); }
 
+// Reads bit p_index of a mask lane of ControlLanes
+inline bool get_mask_bit(const uint8_t *p_mask, int p_index) { return (p_mask[p_index >> 3] >> (p_index & 7)) & 1; }
+
 ///////////////////////////
 // Memory
 ///////////////////////////